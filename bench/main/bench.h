@@ -0,0 +1,38 @@
+#ifndef OAI_BENCH_H
+#define OAI_BENCH_H
+
+#include <stdint.h>
+
+// Monotonic time in microseconds.
+int64_t bench_now_us(void);
+
+// CPU cycle counter where there is one (the core's CCOUNT on a device, the
+// TSC on x86 hosts), 0 otherwise. Only differences are meaningful.
+uint64_t bench_cycles(void);
+
+// Prints one result line: "<suite> <name>: <value> <unit>".
+void bench_report(const char *suite, const char *name, double value,
+                  const char *unit);
+
+// Marks the run as failed; bench exits non-zero once all suites ran.
+void bench_fail(const char *suite, const char *reason);
+
+void bench_g711(void);
+void bench_jitter(void);
+void bench_output(void);
+void bench_capture(void);
+void bench_opus(void);
+void bench_srtp(void);
+void bench_resample(void);
+void bench_vad(void);
+void bench_events(void);
+void bench_outbound(void);
+void bench_signaling(void);
+void bench_reconnect(void);
+void bench_network(void);
+void bench_ptime(void);
+void bench_trace(void);
+void bench_latency(void);
+void bench_rtp(void);
+
+#endif  // OAI_BENCH_H
@@ -0,0 +1,252 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "audio_capture.h"
+#include "audio_device_sim.h"
+#include "bench.h"
+#include "g711.h"
+
+#define BENCH_CAPTURE_RATE 8000
+#define BENCH_CAPTURE_SECONDS 60
+#define BENCH_CAPTURE_REALTIME_US (500 * 1000)
+
+// Encodes every frame like the uplink does and checks that RTP timestamps
+// advance by exactly one frame.
+typedef struct {
+  bool started;
+  uint32_t next_timestamp;
+  uint32_t discontinuities;
+  uint8_t encoded[AUDIO_CAPTURE_MAX_FRAME];
+} bench_uplink_t;
+
+static void uplink_frame(const audio_frame_t *frame, void *user_data) {
+  bench_uplink_t *uplink = (bench_uplink_t *)user_data;
+  if (uplink->started && frame->rtp_timestamp != uplink->next_timestamp) {
+    uplink->discontinuities++;
+  }
+  uplink->started = true;
+  uplink->next_timestamp = frame->rtp_timestamp + frame->count;
+  g711_alaw_encode(frame->samples, uplink->encoded, frame->count);
+}
+
+static FILE *make_tone(size_t samples) {
+  FILE *file = tmpfile();
+  if (file == NULL) {
+    return NULL;
+  }
+  for (size_t i = 0; i < samples; i++) {
+    int16_t sample =
+        (int16_t)(8000 * sin(2 * M_PI * 440 * i / BENCH_CAPTURE_RATE));
+    fwrite(&sample, sizeof(sample), 1, file);
+  }
+  rewind(file);
+  return file;
+}
+
+// Reads a whole file as fast as the pipeline allows.
+static void run_throughput(uint32_t frame_ms) {
+  size_t samples = BENCH_CAPTURE_RATE * BENCH_CAPTURE_SECONDS;
+  FILE *file = make_tone(samples);
+  if (file == NULL) {
+    bench_fail("capture", "tmpfile");
+    return;
+  }
+
+  audio_sim_clock_t clock = {false, 0};
+  audio_sim_source_t source;
+  audio_input_device_t device;
+  audio_sim_source_init(&source, &clock, file, false, &device);
+
+  static audio_capture_t capture;
+  bench_uplink_t uplink = {};
+  audio_capture_open(&capture, &device, BENCH_CAPTURE_RATE, frame_ms,
+                     uplink_frame, &uplink);
+
+  int64_t start = bench_now_us();
+  while (audio_capture_step(&capture)) {
+  }
+  int64_t elapsed = bench_now_us() - start;
+  fclose(file);
+
+  char name[64];
+  snprintf(name, sizeof(name), "file.%lums.throughput",
+           (unsigned long)frame_ms);
+  bench_report("capture", name,
+               elapsed > 0 ? capture.stats.frames * 1e6 / elapsed : 0,
+               "frames/s");
+
+  if (capture.stats.frames != samples / capture.frame_samples ||
+      uplink.discontinuities != 0) {
+    bench_fail("capture", "frames or timestamps lost reading a file");
+  }
+}
+
+// Paces the file at the real sample rate and measures how evenly frames
+// come out.
+static void run_pacing(uint32_t frame_ms) {
+  FILE *file = make_tone(BENCH_CAPTURE_RATE);
+  if (file == NULL) {
+    bench_fail("capture", "tmpfile");
+    return;
+  }
+
+  audio_sim_clock_t clock = {true, 0};
+  audio_sim_source_t source;
+  audio_input_device_t device;
+  audio_sim_source_init(&source, &clock, file, true, &device);
+
+  static audio_capture_t capture;
+  bench_uplink_t uplink = {};
+  audio_capture_open(&capture, &device, BENCH_CAPTURE_RATE, frame_ms,
+                     uplink_frame, &uplink);
+
+  int64_t start = bench_now_us();
+  while (bench_now_us() - start < BENCH_CAPTURE_REALTIME_US) {
+    audio_capture_step(&capture);
+  }
+  fclose(file);
+
+  char name[64];
+  uint32_t intervals = capture.stats.frames > 1 ? capture.stats.frames - 1 : 1;
+  snprintf(name, sizeof(name), "realtime.%lums.interval_error_avg",
+           (unsigned long)frame_ms);
+  bench_report("capture", name,
+               (double)capture.stats.interval_error_total_us / intervals, "us");
+  snprintf(name, sizeof(name), "realtime.%lums.interval_error_max",
+           (unsigned long)frame_ms);
+  bench_report("capture", name, capture.stats.interval_error_max_us, "us");
+
+  if (uplink.discontinuities != 0) {
+    bench_fail("capture", "timestamps jumped with no device drop");
+  }
+}
+
+// A session with another ptime switches frame length on the open device;
+// timestamps must run on without a gap and every sample still counts.
+static void check_switch(void) {
+  size_t samples = BENCH_CAPTURE_RATE * 3;
+  FILE *file = make_tone(samples);
+  if (file == NULL) {
+    bench_fail("capture", "tmpfile");
+    return;
+  }
+  audio_sim_clock_t clock = {false, 0};
+  audio_sim_source_t source;
+  audio_input_device_t device;
+  audio_sim_source_init(&source, &clock, file, false, &device);
+
+  static audio_capture_t capture;
+  bench_uplink_t uplink = {};
+  audio_capture_open(&capture, &device, BENCH_CAPTURE_RATE, 20, uplink_frame,
+                     &uplink);
+  uint32_t first = capture.rtp_timestamp;
+  const uint32_t frame_ms[] = {20, 60, 10, 40};
+  size_t counted = 0;
+  bool sizes_ok = true;
+  for (size_t i = 0; i < 4; i++) {
+    if (!audio_capture_set_frame(&capture, frame_ms[i])) {
+      sizes_ok = false;
+    }
+    // Stops on a frame boundary, as the publisher does between frames.
+    uint32_t frames = capture.stats.frames;
+    while (capture.stats.frames - frames < 10 &&
+           audio_capture_step(&capture)) {
+    }
+    size_t frame = BENCH_CAPTURE_RATE * frame_ms[i] / 1000;
+    counted += (capture.stats.frames - frames) * frame;
+    sizes_ok = sizes_ok && capture.frame_samples == frame;
+  }
+  fclose(file);
+  if (!sizes_ok || uplink.discontinuities != 0 ||
+      uplink.next_timestamp != capture.rtp_timestamp ||
+      capture.rtp_timestamp - first != counted) {
+    bench_fail("capture", "ptime switch broke frames or timestamps");
+  }
+}
+
+// A device whose samples count up from 0, so each one says where on the
+// capture clock it was taken. Reads return at most `chunk` samples and every
+// `drop_every`-th read loses `gap` samples halfway through.
+typedef struct {
+  uint32_t next;
+  uint32_t dropped;
+  uint32_t reads;
+  size_t chunk;
+  uint32_t drop_every;
+  uint32_t gap;
+} ramp_source_t;
+
+static bool ramp_open(audio_input_device_t *device,
+                      const audio_buffer_config_t *config) {
+  return true;
+}
+
+static size_t ramp_read(audio_input_device_t *device, int16_t *samples,
+                        size_t count, uint32_t timeout_ms) {
+  ramp_source_t *ramp = (ramp_source_t *)device->ctx;
+  size_t got = count < ramp->chunk ? count : ramp->chunk;
+  bool drop = ++ramp->reads % ramp->drop_every == 0;
+  for (size_t i = 0; i < got; i++) {
+    if (drop && i == got / 2) {
+      ramp->next += ramp->gap;
+      ramp->dropped += ramp->gap;
+    }
+    samples[i] = (int16_t)ramp->next++;
+  }
+  return got;
+}
+
+static uint32_t ramp_dropped(audio_input_device_t *device) {
+  return ((ramp_source_t *)device->ctx)->dropped;
+}
+
+typedef struct {
+  uint32_t first;
+  uint32_t frames;
+  uint32_t misplaced;
+} ramp_check_t;
+
+static void ramp_frame(const audio_frame_t *frame, void *user_data) {
+  ramp_check_t *check = (ramp_check_t *)user_data;
+  check->frames++;
+  for (size_t i = 0; i < frame->count; i++) {
+    uint32_t taken = frame->rtp_timestamp - check->first + i;
+    if (frame->samples[i] != (int16_t)taken) {
+      check->misplaced++;
+      return;
+    }
+  }
+}
+
+// A drop in the middle of a frame: no frame may carry samples from both sides
+// of the gap, and each frame's timestamp is that of its first sample.
+static void check_drops(void) {
+  ramp_source_t ramp = {0, 0, 0, 48, 7, 33};
+  audio_input_device_t device = {"ramp", ramp_open, ramp_read, ramp_dropped,
+                                 NULL, &ramp};
+  static audio_capture_t capture;
+  ramp_check_t check = {};
+  audio_capture_open(&capture, &device, BENCH_CAPTURE_RATE, 20, ramp_frame,
+                     &check);
+  check.first = capture.rtp_timestamp;
+  for (int i = 0; i < 1000; i++) {
+    audio_capture_step(&capture);
+  }
+  if (check.misplaced != 0 || check.frames == 0 ||
+      capture.stats.dropped_samples != ramp.dropped ||
+      capture.rtp_timestamp - check.first != ramp.next - capture.filled) {
+    bench_fail("capture", "a frame cut by a drop kept the wrong timestamp");
+  }
+}
+
+void bench_capture(void) {
+  check_switch();
+  check_drops();
+  run_throughput(10);
+  run_throughput(20);
+  run_throughput(40);
+  run_throughput(60);
+  run_pacing(10);
+  run_pacing(20);
+  run_pacing(60);
+}
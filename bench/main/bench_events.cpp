@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "event_dispatch.h"
+
+#define BENCH_EVENTS_ROUNDS 2000
+#define BENCH_EVENTS_DELTAS 40
+#define BENCH_EVENTS_MAX_LINE 8192
+
+// One assistant turn as the API sends it, trimmed of long ids. The transcript
+// deltas dominate, as they do on a live session.
+static const char *kTurn[] = {
+    "{\"type\":\"input_audio_buffer.speech_started\",\"event_id\":\"event_A1\","
+    "\"audio_start_ms\":1240,\"item_id\":\"item_U1\"}",
+    "{\"type\":\"input_audio_buffer.speech_stopped\",\"event_id\":\"event_A2\","
+    "\"audio_end_ms\":2980,\"item_id\":\"item_U1\"}",
+    "{\"type\":\"input_audio_buffer.committed\",\"event_id\":\"event_A3\","
+    "\"previous_item_id\":null,\"item_id\":\"item_U1\"}",
+    "{\"type\":\"conversation.item.created\",\"event_id\":\"event_A4\","
+    "\"previous_item_id\":null,\"item\":{\"id\":\"item_U1\",\"object\":"
+    "\"realtime.item\",\"type\":\"message\",\"status\":\"completed\",\"role\":"
+    "\"user\",\"content\":[{\"type\":\"input_audio\",\"transcript\":null}]}}",
+    "{\"type\":\"response.created\",\"event_id\":\"event_A5\",\"response\":{"
+    "\"object\":\"realtime.response\",\"id\":\"resp_R1\",\"status\":"
+    "\"in_progress\",\"status_details\":null,\"output\":[],\"usage\":null}}",
+    "{\"type\":\"response.output_item.added\",\"event_id\":\"event_A6\","
+    "\"response_id\":\"resp_R1\",\"output_index\":0,\"item\":{\"id\":"
+    "\"item_A1\",\"object\":\"realtime.item\",\"type\":\"message\",\"status\":"
+    "\"in_progress\",\"role\":\"assistant\",\"content\":[]}}",
+    "{\"type\":\"response.content_part.added\",\"event_id\":\"event_A7\","
+    "\"response_id\":\"resp_R1\",\"item_id\":\"item_A1\",\"output_index\":0,"
+    "\"content_index\":0,\"part\":{\"type\":\"audio\",\"transcript\":\"\"}}",
+};
+
+static const char *kDelta =
+    "{\"type\":\"response.audio_transcript.delta\",\"event_id\":\"event_D\","
+    "\"response_id\":\"resp_R1\",\"item_id\":\"item_A1\",\"output_index\":0,"
+    "\"content_index\":0,\"delta\":\" word\"}";
+
+static const char *kTurnEnd[] = {
+    "{\"type\":\"response.audio_transcript.done\",\"event_id\":\"event_A8\","
+    "\"response_id\":\"resp_R1\",\"item_id\":\"item_A1\",\"output_index\":0,"
+    "\"content_index\":0,\"transcript\":\"Sure, the \\\"quick\\\" answer is "
+    "yes.\"}",
+    "{\"type\":\"response.done\",\"event_id\":\"event_A9\",\"response\":{"
+    "\"object\":\"realtime.response\",\"id\":\"resp_R1\",\"status\":"
+    "\"completed\",\"output\":[{\"id\":\"item_A1\",\"type\":\"message\","
+    "\"content\":[{\"type\":\"audio\",\"transcript\":\"Sure.\"}]}],\"usage\":"
+    "{\"total_tokens\":412,\"input_tokens\":300,\"output_tokens\":112}}}",
+};
+
+typedef struct {
+  uint32_t speech_started;
+  uint32_t items;
+  uint32_t transcripts;
+  bool item_id_ok;
+} bench_events_seen_t;
+
+static void on_speech_started(const event_message_t *event, void *user_data) {
+  ((bench_events_seen_t *)user_data)->speech_started++;
+}
+
+static void on_item_added(const event_message_t *event, void *user_data) {
+  bench_events_seen_t *seen = (bench_events_seen_t *)user_data;
+  json_value_t item, id;
+  seen->items++;
+  seen->item_id_ok = json_get(event->json, event->len, "item", &item) &&
+                     json_value_get(&item, "id", &id) &&
+                     json_value_equals(&id, "item_A1");
+}
+
+static void on_transcript(const event_message_t *event, void *user_data) {
+  ((bench_events_seen_t *)user_data)->transcripts++;
+}
+
+// The same routes the device registers, sorted by type.
+static const event_dispatch_route_t kRoutes[] = {
+    {"conversation.item.input_audio_transcription.completed", on_transcript},
+    {"error", on_transcript},
+    {"input_audio_buffer.speech_started", on_speech_started},
+    {"output_audio_buffer.cleared", on_speech_started},
+    {"response.audio_transcript.done", on_transcript},
+    {"response.cancelled", on_speech_started},
+    {"response.output_item.added", on_item_added},
+};
+
+static void check_scanner(void) {
+  const char *json =
+      " { \"a\" : [1, {\"b\": \"}\"}], \"type\" : \"x\\\"y\", \"n\": -42 } ";
+  json_value_t value;
+  int64_t n = 0;
+  if (!json_get(json, strlen(json), "type", &value) ||
+      value.kind != JSON_STRING || value.len != 4 ||
+      !json_get(json, strlen(json), "n", &value) ||
+      !json_value_to_int(&value, &n) || n != -42 ||
+      json_get(json, strlen(json), "missing", &value) ||
+      json_get("{\"type\":", 8, "type", &value)) {
+    bench_fail("events", "scanner returned a wrong member");
+  }
+}
+
+static void report(const char *name, event_dispatcher_t *dispatcher,
+                   uint32_t messages, int64_t elapsed) {
+  char label[64];
+  double seconds = elapsed > 0 ? elapsed / 1e6 : 1e-6;
+  snprintf(label, sizeof(label), "%s.messages", name);
+  bench_report("events", label, messages / seconds, "msg/s");
+  snprintf(label, sizeof(label), "%s.bytes", name);
+  bench_report("events", label, dispatcher->stats.bytes / seconds / 1e6,
+               "MB/s");
+}
+
+static void run_recorded_turns(void) {
+  bench_events_seen_t seen = {};
+  event_dispatcher_t dispatcher;
+  if (!event_dispatcher_init(&dispatcher, kRoutes,
+                             sizeof(kRoutes) / sizeof(kRoutes[0]), &seen)) {
+    bench_fail("events", "routes not sorted");
+    return;
+  }
+
+  uint32_t messages = 0;
+  int64_t start = bench_now_us();
+  for (int round = 0; round < BENCH_EVENTS_ROUNDS; round++) {
+    for (size_t i = 0; i < sizeof(kTurn) / sizeof(kTurn[0]); i++) {
+      event_dispatch(&dispatcher, kTurn[i], strlen(kTurn[i]));
+    }
+    for (int i = 0; i < BENCH_EVENTS_DELTAS; i++) {
+      event_dispatch(&dispatcher, kDelta, strlen(kDelta));
+    }
+    for (size_t i = 0; i < sizeof(kTurnEnd) / sizeof(kTurnEnd[0]); i++) {
+      event_dispatch(&dispatcher, kTurnEnd[i], strlen(kTurnEnd[i]));
+    }
+    messages += sizeof(kTurn) / sizeof(kTurn[0]) + BENCH_EVENTS_DELTAS +
+                sizeof(kTurnEnd) / sizeof(kTurnEnd[0]);
+  }
+  int64_t elapsed = bench_now_us() - start;
+  report("recorded", &dispatcher, messages, elapsed);
+
+  if (seen.speech_started != BENCH_EVENTS_ROUNDS ||
+      seen.items != BENCH_EVENTS_ROUNDS ||
+      seen.transcripts != BENCH_EVENTS_ROUNDS || !seen.item_id_ok ||
+      dispatcher.stats.malformed != 0) {
+    bench_fail("events", "events routed to the wrong handlers");
+  }
+}
+
+// A capture of a real session, one event per line.
+static void run_input(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    bench_fail("events", "cannot open BENCH_EVENTS_INPUT");
+    return;
+  }
+  static char lines[BENCH_EVENTS_MAX_LINE];
+  static char *text = NULL;
+  size_t used = 0;
+  size_t capacity = 0;
+  while (fgets(lines, sizeof(lines), file) != NULL) {
+    size_t len = strlen(lines);
+    if (used + len + 1 > capacity) {
+      capacity = (used + len + 1) * 2;
+      text = (char *)realloc(text, capacity);
+    }
+    memcpy(text + used, lines, len + 1);
+    used += len;
+  }
+  fclose(file);
+  if (text == NULL) {
+    return;
+  }
+
+  bench_events_seen_t seen = {};
+  event_dispatcher_t dispatcher;
+  event_dispatcher_init(&dispatcher, kRoutes,
+                        sizeof(kRoutes) / sizeof(kRoutes[0]), &seen);
+  uint32_t messages = 0;
+  int64_t start = bench_now_us();
+  for (int round = 0; round < 10; round++) {
+    const char *line = text;
+    while (*line != '\0') {
+      const char *end = strchr(line, '\n');
+      size_t len = end != NULL ? (size_t)(end - line) : strlen(line);
+      if (len > 0) {
+        event_dispatch(&dispatcher, line, len);
+        messages++;
+      }
+      line += end != NULL ? len + 1 : len;
+    }
+  }
+  int64_t elapsed = bench_now_us() - start;
+  report("input", &dispatcher, messages, elapsed);
+  bench_report("events", "input.malformed", dispatcher.stats.malformed,
+               "messages");
+  free(text);
+  text = NULL;
+}
+
+void bench_events(void) {
+  check_scanner();
+  run_recorded_turns();
+  const char *input = getenv("BENCH_EVENTS_INPUT");
+  if (input != NULL) {
+    run_input(input);
+  }
+}
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "g711.h"
+
+#define BENCH_G711_SAMPLES 4096
+#define BENCH_G711_ROUNDS 2000
+
+static int16_t pcm[BENCH_G711_SAMPLES];
+static int16_t decoded[BENCH_G711_SAMPLES];
+static uint8_t alaw[BENCH_G711_SAMPLES];
+static uint8_t reference[BENCH_G711_SAMPLES];
+
+static void fill_input(void) {
+  srand(711);
+  for (int i = 0; i < BENCH_G711_SAMPLES; i++) {
+    pcm[i] = (int16_t)(rand() - RAND_MAX / 2);
+  }
+}
+
+static double samples_per_sec(int64_t elapsed_us) {
+  if (elapsed_us <= 0) {
+    elapsed_us = 1;
+  }
+  return (double)BENCH_G711_SAMPLES * BENCH_G711_ROUNDS * 1e6 / elapsed_us;
+}
+
+void bench_g711(void) {
+  g711_init();
+  fill_input();
+
+  size_t count = 0;
+  const g711_kernel_t *kernels = g711_kernels(&count);
+
+  // The last kernel is always the portable table one; every other kernel has
+  // to match it byte for byte.
+  kernels[count - 1].encode(pcm, reference, BENCH_G711_SAMPLES);
+
+  for (size_t k = 0; k < count; k++) {
+    kernels[k].encode(pcm, alaw, BENCH_G711_SAMPLES);
+    if (memcmp(alaw, reference, sizeof(alaw)) != 0) {
+      bench_fail("g711", kernels[k].name);
+      continue;
+    }
+
+    int64_t start = bench_now_us();
+    for (int r = 0; r < BENCH_G711_ROUNDS; r++) {
+      kernels[k].encode(pcm, alaw, BENCH_G711_SAMPLES);
+    }
+    int64_t encode_us = bench_now_us() - start;
+
+    start = bench_now_us();
+    for (int r = 0; r < BENCH_G711_ROUNDS; r++) {
+      kernels[k].decode(alaw, decoded, BENCH_G711_SAMPLES);
+    }
+    int64_t decode_us = bench_now_us() - start;
+
+    char name[32];
+    snprintf(name, sizeof(name), "encode[%s]", kernels[k].name);
+    bench_report("g711", name, samples_per_sec(encode_us), "samples/s");
+    snprintf(name, sizeof(name), "decode[%s]", kernels[k].name);
+    bench_report("g711", name, samples_per_sec(decode_us), "samples/s");
+  }
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "jitter_buffer.h"
+
+#define BENCH_JITTER_PACKETS 1000
+#define BENCH_JITTER_FRAME_US 20000
+#define BENCH_JITTER_FRAME_BYTES 160  // 20ms of 8kHz A-law
+#define BENCH_JITTER_PLAYOUT_OFFSET_US 5000
+
+// A synthetic downlink: packets leave every 20ms and arrive with the given
+// disturbances applied. Playout pulls one frame every 20ms.
+typedef struct {
+  const char *name;
+  int jitter_ms;      // Uniform random extra delay per packet
+  int loss_every;     // Drop every Nth packet, 0 for none
+  int reorder_every;  // Swap packet N and N+1 every Nth packet, 0 for none
+  int late_index;     // Delay this packet by late_ms, -1 for none
+  int late_ms;
+} jitter_trace_t;
+
+typedef struct {
+  uint16_t seq;
+  int64_t arrival_us;
+} arrival_t;
+
+static const jitter_trace_t kTraces[] = {
+    {"steady", 2, 0, 0, -1, 0},
+    {"loss", 2, 25, 0, -1, 0},
+    {"reorder", 2, 0, 50, -1, 0},
+    {"late", 2, 0, 0, 500, 400},
+    {"bursty", 60, 0, 0, -1, 0},
+};
+
+static jitter_buffer_t jb;
+static arrival_t arrivals[BENCH_JITTER_PACKETS];
+
+static uint32_t lcg_state;
+static uint32_t lcg_next(void) {
+  lcg_state = lcg_state * 1664525 + 1013904223;
+  return lcg_state >> 8;
+}
+
+static int build_arrivals(const jitter_trace_t *trace, int *dropped) {
+  int count = 0;
+  *dropped = 0;
+  lcg_state = 42;
+
+  for (int i = 0; i < BENCH_JITTER_PACKETS; i++) {
+    int64_t arrival = (int64_t)i * BENCH_JITTER_FRAME_US;
+    if (trace->jitter_ms > 0) {
+      arrival += lcg_next() % (trace->jitter_ms * 1000);
+    }
+    if (trace->reorder_every && i % trace->reorder_every == 1) {
+      arrival += BENCH_JITTER_FRAME_US + 1000;  // Lands after packet i + 1
+    }
+    if (i == trace->late_index) {
+      arrival += trace->late_ms * 1000;
+    }
+    if (trace->loss_every && i % trace->loss_every == trace->loss_every / 2) {
+      (*dropped)++;
+      continue;
+    }
+    arrivals[count].seq = (uint16_t)(65000 + i);  // Exercise wraparound
+    arrivals[count].arrival_us = arrival;
+    count++;
+  }
+
+  // Insertion sort by arrival time; traces are nearly sorted already.
+  for (int i = 1; i < count; i++) {
+    arrival_t a = arrivals[i];
+    int j = i - 1;
+    while (j >= 0 && arrivals[j].arrival_us > a.arrival_us) {
+      arrivals[j + 1] = arrivals[j];
+      j--;
+    }
+    arrivals[j + 1] = a;
+  }
+  return count;
+}
+
+static void run_trace(const jitter_trace_t *trace,
+                      jitter_buffer_stats_t *stats, int *dropped) {
+  static uint8_t payload[JITTER_BUFFER_MAX_PAYLOAD];
+  int count = build_arrivals(trace, dropped);
+  jitter_buffer_init(&jb, 8000);
+  memset(payload, 0xD5, sizeof(payload));
+
+  int next = 0;
+  int64_t end = (int64_t)(BENCH_JITTER_PACKETS + 50) * BENCH_JITTER_FRAME_US;
+  for (int64_t now = BENCH_JITTER_PLAYOUT_OFFSET_US; now < end;
+       now += BENCH_JITTER_FRAME_US) {
+    while (next < count && arrivals[next].arrival_us <= now) {
+      uint16_t seq = arrivals[next].seq;
+      uint32_t timestamp = (uint16_t)(seq - 65000) * 160;
+      jitter_buffer_put(&jb, seq, timestamp, payload, BENCH_JITTER_FRAME_BYTES,
+                        arrivals[next].arrival_us);
+      next++;
+    }
+    size_t size = 0;
+    jitter_buffer_get(&jb, payload, &size);
+  }
+  jitter_buffer_get_stats(&jb, stats);
+}
+
+void bench_jitter(void) {
+  for (size_t t = 0; t < sizeof(kTraces) / sizeof(kTraces[0]); t++) {
+    const jitter_trace_t *trace = &kTraces[t];
+    jitter_buffer_stats_t stats;
+    int dropped = 0;
+
+    int64_t start = bench_now_us();
+    run_trace(trace, &stats, &dropped);
+    int64_t elapsed = bench_now_us() - start;
+
+    char name[48];
+    snprintf(name, sizeof(name), "%s.lost", trace->name);
+    bench_report("jitter", name, stats.lost, "frames");
+    snprintf(name, sizeof(name), "%s.late", trace->name);
+    bench_report("jitter", name, stats.late, "frames");
+    snprintf(name, sizeof(name), "%s.target", trace->name);
+    bench_report("jitter", name, stats.target, "frames");
+    snprintf(name, sizeof(name), "%s.jitter", trace->name);
+    bench_report("jitter", name, stats.jitter_ms, "ms");
+    snprintf(name, sizeof(name), "%s.throughput", trace->name);
+    bench_report("jitter", name,
+                 elapsed > 0 ? BENCH_JITTER_PACKETS * 1e6 / elapsed : 0,
+                 "frames/s");
+
+    // Every frame that never arrived or arrived too late is counted lost
+    // exactly once, so reordering within the target depth costs nothing.
+    if (stats.lost != (uint32_t)dropped + stats.late) {
+      bench_fail("jitter", trace->name);
+    }
+    if (trace->late_index >= 0 && stats.late != 1) {
+      bench_fail("jitter", trace->name);
+    }
+  }
+}
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "latency.h"
+
+#define BENCH_LATENCY_SAMPLES 200000
+
+static int compare_us(const void *a, const void *b) {
+  int64_t x = *(const int64_t *)a;
+  int64_t y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Records a long-tailed spread like network arrival times: mostly a few ms,
+// with rare spikes of hundreds. Checks the percentiles against exact ones.
+void bench_latency(void) {
+  static latency_histogram_t histogram;
+  static int64_t samples[BENCH_LATENCY_SAMPLES];
+  latency_histogram_reset(&histogram);
+
+  uint32_t lcg = 3;
+  for (int i = 0; i < BENCH_LATENCY_SAMPLES; i++) {
+    lcg = lcg * 1664525 + 1013904223;
+    int64_t us = 2000 + (lcg >> 8) % 8000;
+    if ((lcg & 0xff) == 0) {
+      us *= 40;
+    }
+    samples[i] = us;
+  }
+
+  int64_t start = bench_now_us();
+  for (int i = 0; i < BENCH_LATENCY_SAMPLES; i++) {
+    latency_histogram_record(&histogram, samples[i]);
+  }
+  int64_t elapsed = bench_now_us() - start;
+  bench_report("latency", "record", elapsed * 1000.0 / BENCH_LATENCY_SAMPLES,
+               "ns/sample");
+  bench_report("latency", "histogram_size", sizeof(histogram), "bytes");
+
+  qsort(samples, BENCH_LATENCY_SAMPLES, sizeof(samples[0]), compare_us);
+  const uint32_t percents[] = {50, 95, 99};
+  for (size_t i = 0; i < sizeof(percents) / sizeof(percents[0]); i++) {
+    int64_t exact =
+        samples[(BENCH_LATENCY_SAMPLES * percents[i] + 99) / 100 - 1];
+    int64_t estimate = latency_histogram_percentile(&histogram, percents[i]);
+    char name[32];
+    snprintf(name, sizeof(name), "p%lu.error", (unsigned long)percents[i]);
+    bench_report("latency", name, (estimate - exact) * 100.0 / exact, "%");
+    // The bucket's upper edge is reported, so never below and at most one
+    // sub-bucket above.
+    if (estimate < exact || estimate > exact * 5 / 4 + 1) {
+      bench_fail("latency", name);
+    }
+  }
+
+  char report[128];
+  if (latency_histogram_format(&histogram, "x", report, 16) != 0 ||
+      latency_histogram_format(&histogram, "x", report, sizeof(report)) == 0) {
+    bench_fail("latency", "format bounds");
+  }
+}
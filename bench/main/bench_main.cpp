@@ -0,0 +1,181 @@
+#include <esp_timer.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "media.h"
+
+#ifndef LINUX_BUILD
+#include <esp_cpu.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define BENCH_MAX_RESULTS 512
+#define BENCH_MAX_FAILURES 64
+
+// Everything reported is kept for the JSON summary. Suite, unit and reason
+// strings are literals; names are built on the caller's stack and copied.
+typedef struct {
+  const char *suite;
+  char name[64];
+  double value;
+  const char *unit;
+} bench_result_t;
+
+typedef struct {
+  const char *suite;
+  char reason[64];
+} bench_failure_t;
+
+static bench_result_t results[BENCH_MAX_RESULTS];
+static size_t result_count = 0;
+static bench_failure_t failed[BENCH_MAX_FAILURES];
+static int failures = 0;
+
+int64_t bench_now_us(void) {
+  return esp_timer_get_time();
+}
+
+uint64_t bench_cycles(void) {
+#ifndef LINUX_BUILD
+  return esp_cpu_get_cycle_count();
+#elif defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+void bench_report(const char *suite, const char *name, double value,
+                  const char *unit) {
+  printf("%s %s: %.2f %s\n", suite, name, value, unit);
+  if (result_count < BENCH_MAX_RESULTS) {
+    bench_result_t *result = &results[result_count++];
+    result->suite = suite;
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->value = value;
+    result->unit = unit;
+  }
+}
+
+void bench_fail(const char *suite, const char *reason) {
+  printf("%s FAILED: %s\n", suite, reason);
+  if (failures < BENCH_MAX_FAILURES) {
+    failed[failures].suite = suite;
+    snprintf(failed[failures].reason, sizeof(failed[failures].reason), "%s",
+             reason);
+  }
+  failures++;
+}
+
+static const struct {
+  const char *name;
+  void (*run)(void);
+} suites[] = {
+    {"g711", bench_g711},
+    {"jitter", bench_jitter},
+    {"output", bench_output},
+    {"capture", bench_capture},
+    {"opus", bench_opus},
+    {"resample", bench_resample},
+    {"srtp", bench_srtp},
+    {"vad", bench_vad},
+    {"events", bench_events},
+    {"outbound", bench_outbound},
+    {"signaling", bench_signaling},
+    {"reconnect", bench_reconnect},
+    {"network", bench_network},
+    {"ptime", bench_ptime},
+    {"trace", bench_trace},
+    {"latency", bench_latency},
+    {"rtp", bench_rtp},
+};
+
+// `only` is a comma-separated list of suite names, NULL for all of them.
+static bool suite_selected(const char *only, const char *name) {
+  if (only == NULL || only[0] == '\0') {
+    return true;
+  }
+  size_t len = strlen(name);
+  for (const char *p = only; p != NULL; p = strchr(p, ',')) {
+    if (*p == ',') {
+      p++;
+    }
+    if (strncmp(p, name, len) == 0 && (p[len] == ',' || p[len] == '\0')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// One object per run, so two runs can be diffed by tools/bench_compare.py.
+// The build settings that change what the suites measure go in with it.
+static void bench_write_json(FILE *out) {
+  fprintf(out,
+          "{\"config\":{\"target\":\"%s\",\"opus_sample_rate\":%d,"
+          "\"opus_encoder_bitrate\":%d,\"opus_encoder_complexity\":%d},",
+#ifdef LINUX_BUILD
+          "linux",
+#else
+          CONFIG_IDF_TARGET,
+#endif
+          OPUS_SAMPLE_RATE, OPUS_ENCODER_BITRATE, OPUS_ENCODER_COMPLEXITY);
+  fprintf(out, "\"results\":[");
+  for (size_t i = 0; i < result_count; i++) {
+    // JSON has no inf or nan, e.g. a rate over zero elapsed time.
+    char value[32];
+    if (isfinite(results[i].value)) {
+      snprintf(value, sizeof(value), "%.6g", results[i].value);
+    } else {
+      strcpy(value, "null");
+    }
+    fprintf(out, "%s{\"suite\":\"%s\",\"name\":\"%s\",\"value\":%s,"
+                 "\"unit\":\"%s\"}",
+            i > 0 ? "," : "", results[i].suite, results[i].name, value,
+            results[i].unit);
+  }
+  fprintf(out, "],\"failures\":[");
+  for (int i = 0; i < failures && i < BENCH_MAX_FAILURES; i++) {
+    fprintf(out, "%s{\"suite\":\"%s\",\"reason\":\"%s\"}", i > 0 ? "," : "",
+            failed[i].suite, failed[i].reason);
+  }
+  fprintf(out, "]}\n");
+}
+
+static int bench_run_all(const char *only) {
+  for (size_t i = 0; i < sizeof(suites) / sizeof(suites[0]); i++) {
+    if (suite_selected(only, suites[i].name)) {
+      suites[i].run();
+    }
+  }
+  return failures;
+}
+
+#ifndef LINUX_BUILD
+extern "C" void app_main(void) {
+  bench_run_all(NULL);
+  // The console is the only way out; the summary is a single line.
+  printf("bench json: ");
+  bench_write_json(stdout);
+}
+#else
+int main(void) {
+  bench_run_all(getenv("BENCH_SUITES"));
+  const char *path = getenv("BENCH_JSON");
+  if (path != NULL) {
+    FILE *out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (out == NULL) {
+      printf("bench: cannot write %s\n", path);
+      return 1;
+    }
+    bench_write_json(out);
+    if (out != stdout) {
+      fclose(out);
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
+#endif
@@ -0,0 +1,257 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "network_wait.h"
+#include "network_wake.h"
+
+// The network loop in virtual time against the fixed tick it replaced. The
+// publisher ends a pass every 20ms, late by up to a few ms of encode time,
+// and queues one uplink frame. Downlink packets arrive every 20ms with
+// network jitter while the model talks. Like libpeer, each loop pass sends
+// one queued uplink frame, then selects on the socket and reads one packet.
+// The event loop runs once on its timeouts alone and once with the
+// publisher waking the select, where a wake is read like a packet.
+
+#define BENCH_NETWORK_FRAME_US 20000
+#define BENCH_NETWORK_TICK_US 15000  // The old vTaskDelay
+#define BENCH_NETWORK_OLD_POLL_US 1000
+#define BENCH_NETWORK_PASS_US 50  // CPU time of one loop pass
+#define BENCH_NETWORK_FRAMES 1000  // 20s
+#define BENCH_NETWORK_ENCODE_JITTER_US 3000
+#define BENCH_NETWORK_ARRIVAL_JITTER_US 10000
+
+typedef struct {
+  int64_t uplink[BENCH_NETWORK_FRAMES];    // When each pass queued a frame
+  int64_t downlink[BENCH_NETWORK_FRAMES];  // When each packet arrived
+  size_t downlink_count;
+} traffic_t;
+
+typedef struct {
+  int64_t rx[BENCH_NETWORK_FRAMES];
+  int64_t tx[BENCH_NETWORK_FRAMES];
+  size_t rx_count;
+  size_t tx_count;
+  uint32_t passes;
+} outcome_t;
+
+static traffic_t traffic;
+static outcome_t outcome;
+
+static uint32_t lcg = 1;
+static uint32_t next_random(uint32_t range) {
+  lcg = lcg * 1664525 + 1013904223;
+  return (lcg >> 8) % range;
+}
+
+static void make_traffic(bool talking) {
+  lcg = 1;
+  int64_t arrival = 0;
+  traffic.downlink_count = 0;
+  for (size_t i = 0; i < BENCH_NETWORK_FRAMES; i++) {
+    traffic.uplink[i] = 3000 + (int64_t)i * BENCH_NETWORK_FRAME_US +
+                        next_random(BENCH_NETWORK_ENCODE_JITTER_US);
+    if (talking) {
+      int64_t at = 7000 + (int64_t)i * BENCH_NETWORK_FRAME_US +
+                   next_random(BENCH_NETWORK_ARRIVAL_JITTER_US);
+      arrival = at > arrival ? at : arrival;  // The socket keeps order
+      traffic.downlink[traffic.downlink_count++] = arrival;
+    }
+  }
+}
+
+static uint32_t passes_by(int64_t now, int64_t *last_pass_us) {
+  uint32_t passes = 0;
+  *last_pass_us = 0;
+  while (passes < BENCH_NETWORK_FRAMES && traffic.uplink[passes] <= now) {
+    *last_pass_us = traffic.uplink[passes++];
+  }
+  return passes;
+}
+
+// One loop pass starting at `now`: sends a queued frame, then blocks for at
+// most `wait_us` or until a packet, or with `woken` a wake, is in the socket.
+// Returns when it woke.
+static int64_t loop_pass(int64_t now, int64_t wait_us, bool woken) {
+  int64_t last_pass_us;
+  uint32_t passes = passes_by(now, &last_pass_us);
+  if (outcome.tx_count < passes) {
+    outcome.tx[outcome.tx_count] = now - traffic.uplink[outcome.tx_count];
+    outcome.tx_count++;
+  }
+  outcome.passes++;
+
+  int64_t wake = now + wait_us;
+  if (woken) {
+    // A frame still queued has its wake in the socket already.
+    int64_t signal = wake;
+    if (outcome.tx_count < passes) {
+      signal = now;
+    } else if (passes < BENCH_NETWORK_FRAMES) {
+      signal = traffic.uplink[passes];
+    }
+    wake = signal < wake ? signal : wake;
+  }
+  if (outcome.rx_count < traffic.downlink_count) {
+    int64_t arrival = traffic.downlink[outcome.rx_count];
+    if (arrival <= wake) {
+      wake = arrival > now ? arrival : now;
+      outcome.rx[outcome.rx_count++] = wake - arrival;
+    }
+  }
+  return wake + BENCH_NETWORK_PASS_US;
+}
+
+static void run_tick(void) {
+  int64_t end = traffic.uplink[BENCH_NETWORK_FRAMES - 1];
+  for (int64_t now = 0; now < end;) {
+    now = loop_pass(now, BENCH_NETWORK_OLD_POLL_US, false) +
+          BENCH_NETWORK_TICK_US;
+  }
+}
+
+static void run_event(bool woken) {
+  network_wait_t wait;
+  network_wait_init(&wait, BENCH_NETWORK_FRAME_US / 1000);
+  network_wait_set_woken(&wait, woken);
+  int64_t end = traffic.uplink[BENCH_NETWORK_FRAMES - 1];
+  for (int64_t now = 0; now < end;) {
+    int64_t last_pass_us;
+    uint32_t passes = passes_by(now, &last_pass_us);
+    uint32_t ms = network_wait_next(&wait, true, passes, last_pass_us, now);
+    int64_t woke = loop_pass(now, ms * 1000LL, woken);
+    network_wait_done(&wait, woke - now);
+    now = woke;
+  }
+}
+
+static int compare_us(const void *a, const void *b) {
+  int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static double percentile(int64_t *values, size_t count, uint32_t percent) {
+  if (count == 0) {
+    return 0;
+  }
+  qsort(values, count, sizeof(values[0]), compare_us);
+  return (double)values[(count - 1) * percent / 100];
+}
+
+// Reports one loop against one traffic pattern and returns its p99 receive
+// and send latency and its passes per second.
+static void report(const char *loop, const char *traffic_name,
+                   double *rx_p99, double *tx_p99, double *rate) {
+  char name[64];
+  double seconds = BENCH_NETWORK_FRAMES * (BENCH_NETWORK_FRAME_US / 1e6);
+  *rate = outcome.passes / seconds;
+  snprintf(name, sizeof(name), "%s.%s.loop_rate", loop, traffic_name);
+  bench_report("network", name, *rate, "Hz");
+  *tx_p99 = percentile(outcome.tx, outcome.tx_count, 99);
+  snprintf(name, sizeof(name), "%s.%s.send_p99", loop, traffic_name);
+  bench_report("network", name, *tx_p99 / 1000.0, "ms");
+  *rx_p99 = percentile(outcome.rx, outcome.rx_count, 99);
+  if (outcome.rx_count > 0) {
+    snprintf(name, sizeof(name), "%s.%s.receive_p99", loop, traffic_name);
+    bench_report("network", name, *rx_p99 / 1000.0, "ms");
+  }
+}
+
+static void run_traffic(bool talking) {
+  const char *traffic_name = talking ? "downlink" : "uplink_only";
+  make_traffic(talking);
+  double tick_rx, tick_tx, tick_rate;
+  outcome = {};
+  run_tick();
+  report("tick", traffic_name, &tick_rx, &tick_tx, &tick_rate);
+
+  double event_rx, event_tx, event_rate;
+  outcome = {};
+  run_event(false);
+  report("event", traffic_name, &event_rx, &event_tx, &event_rate);
+
+  // The run stops as the last pass ends, which may leave its frame and the
+  // packet after it unhandled.
+  if (outcome.tx_count + 1 < BENCH_NETWORK_FRAMES ||
+      outcome.rx_count + 1 < traffic.downlink_count) {
+    bench_fail("network", "event loop fell behind the traffic");
+  }
+  if (event_rx > tick_rx || event_tx > tick_tx) {
+    bench_fail("network", "event loop slower than the fixed tick");
+  }
+  // Packets wake the loop as they arrive, so only without downlink traffic
+  // must it wake less often than the tick did.
+  if (!talking && event_rate > tick_rate) {
+    bench_fail("network", "event loop wakes more than the fixed tick");
+  }
+
+  double woken_rx, woken_tx, woken_rate;
+  outcome = {};
+  run_event(true);
+  report("woken", traffic_name, &woken_rx, &woken_tx, &woken_rate);
+  if (outcome.tx_count + 1 < BENCH_NETWORK_FRAMES ||
+      outcome.rx_count + 1 < traffic.downlink_count) {
+    bench_fail("network", "woken loop fell behind the traffic");
+  }
+  if (woken_rx > event_rx || woken_tx > event_tx) {
+    bench_fail("network", "woken loop slower than its timeouts alone");
+  }
+}
+
+// A wake reaches a socket bound to the host candidate it was opened on, as
+// one STUN Binding Indication.
+static void check_wake(void) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in local = {};
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t local_len = sizeof(local);
+  if (fd < 0 || bind(fd, (struct sockaddr *)&local, sizeof(local)) != 0 ||
+      getsockname(fd, (struct sockaddr *)&local, &local_len) != 0) {
+    bench_fail("network", "no loopback socket to wake");
+    if (fd >= 0) {
+      close(fd);
+    }
+    return;
+  }
+  char sdp[256];
+  snprintf(sdp, sizeof(sdp),
+           "v=0\r\n"
+           "a=candidate:2 1 TCP 1015022079 127.0.0.1 9 typ host\r\n"
+           "a=candidate:1 1 UDP 2130706431 127.0.0.1 %u typ host\r\n",
+           ntohs(local.sin_port));
+
+  network_wake_t wake;
+  network_wake_init(&wake);
+  bool opened = network_wake_open(&wake, sdp);
+  network_wake_signal(&wake);
+
+  uint8_t message[64] = {};
+  ssize_t got = -1;
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(fd, &fds);
+  struct timeval timeout = {1, 0};
+  if (select(fd + 1, &fds, NULL, NULL, &timeout) == 1) {
+    got = recv(fd, message, sizeof(message), MSG_DONTWAIT);
+  }
+  if (!opened || wake.stats.sent != 1 || got != NETWORK_WAKE_BYTES ||
+      message[0] != 0x00 || message[1] != 0x11 || message[4] != 0x21 ||
+      message[5] != 0x12 || message[6] != 0xA4 || message[7] != 0x42) {
+    bench_fail("network", "wake did not reach the host candidate");
+  }
+  network_wake_close(&wake);
+  close(fd);
+}
+
+void bench_network(void) {
+  run_traffic(true);
+  run_traffic(false);
+  check_wake();
+}
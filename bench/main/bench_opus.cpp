@@ -0,0 +1,144 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "media.h"
+#include "opus_codec.h"
+
+#define BENCH_OPUS_FRAME_MS 20
+#define BENCH_OPUS_FRAMES 500  // 10s of speech-like audio
+#define BENCH_OPUS_MAX_FRAME (24000 * BENCH_OPUS_FRAME_MS / 1000)
+#define BENCH_OPUS_PCMA_BITRATE 64000
+
+// A vowel-ish tone with a slow amplitude envelope, so the encoder sees
+// something closer to speech than a steady sine.
+static void fill_voice(int16_t *samples, size_t count, uint32_t sample_rate,
+                       size_t offset) {
+  for (size_t i = 0; i < count; i++) {
+    double t = (double)(offset + i) / sample_rate;
+    double envelope = 0.5 + 0.5 * sin(2 * M_PI * 3 * t);
+    double voice = sin(2 * M_PI * 180 * t) + 0.5 * sin(2 * M_PI * 720 * t) +
+                   0.25 * sin(2 * M_PI * 2400 * t);
+    samples[i] = (int16_t)(6000 * envelope * voice);
+  }
+}
+
+static void run_encode(uint32_t sample_rate, int bitrate, int complexity) {
+  static opus_codec_encoder_t codec;
+  opus_codec_config_t config = {sample_rate, bitrate, complexity, 0};
+  if (!opus_codec_encoder_init(&codec, &config, NULL)) {
+    bench_fail("opus", "encoder init");
+    return;
+  }
+
+  size_t frame_samples = sample_rate * BENCH_OPUS_FRAME_MS / 1000;
+  static int16_t frames[BENCH_OPUS_FRAMES][BENCH_OPUS_MAX_FRAME];
+  for (size_t i = 0; i < BENCH_OPUS_FRAMES; i++) {
+    fill_voice(frames[i], frame_samples, sample_rate, i * frame_samples);
+  }
+
+  size_t bytes = 0;
+  int64_t start = bench_now_us();
+  for (size_t i = 0; i < BENCH_OPUS_FRAMES; i++) {
+    int size = opus_codec_encode(&codec, frames[i], frame_samples);
+    if (size < 0) {
+      bench_fail("opus", "encode");
+      break;
+    }
+    bytes += size;
+  }
+  int64_t elapsed = bench_now_us() - start;
+  opus_codec_encoder_free(&codec);
+
+  double seconds = BENCH_OPUS_FRAMES * BENCH_OPUS_FRAME_MS / 1000.0;
+  char name[64];
+  snprintf(name, sizeof(name), "encode.%lukhz.c%d.frame_time",
+           (unsigned long)(sample_rate / 1000), complexity);
+  bench_report("opus", name, (double)elapsed / BENCH_OPUS_FRAMES, "us");
+  snprintf(name, sizeof(name), "encode.%lukhz.c%d.bitrate",
+           (unsigned long)(sample_rate / 1000), complexity);
+  bench_report("opus", name, bytes * 8 / seconds / 1000, "kbit/s");
+  snprintf(name, sizeof(name), "encode.%lukhz.c%d.size_vs_pcma",
+           (unsigned long)(sample_rate / 1000), complexity);
+  bench_report("opus", name, bytes * 8 / seconds / BENCH_OPUS_PCMA_BITRATE,
+               "x");
+}
+
+// Decodes a stream encoded with in-band FEC three ways: every packet, every
+// packet rebuilt from its successor's FEC, and every packet concealed.
+static void run_decode(uint32_t sample_rate) {
+  static opus_codec_encoder_t encoder;
+  static opus_codec_decoder_t decoder;
+  static uint8_t packets[BENCH_OPUS_FRAMES][OPUS_CODEC_MAX_PACKET];
+  static size_t sizes[BENCH_OPUS_FRAMES];
+  static int16_t pcm[OPUS_CODEC_MAX_DECODE];
+
+  opus_codec_config_t config = {sample_rate, 24000, 0, 10};
+  if (!opus_codec_encoder_init(&encoder, &config, NULL) ||
+      !opus_codec_decoder_init(&decoder, sample_rate, 0, NULL)) {
+    bench_fail("opus", "codec init");
+    return;
+  }
+
+  size_t frame_samples = sample_rate * BENCH_OPUS_FRAME_MS / 1000;
+  for (size_t i = 0; i < BENCH_OPUS_FRAMES; i++) {
+    fill_voice(pcm, frame_samples, sample_rate, i * frame_samples);
+    int size = opus_codec_encode(&encoder, pcm, frame_samples);
+    if (size < 0) {
+      bench_fail("opus", "encode");
+      return;
+    }
+    memcpy(packets[i], encoder.packet, size);
+    sizes[i] = size;
+  }
+  opus_codec_encoder_free(&encoder);
+
+  const char *modes[] = {"packet", "fec", "plc"};
+  for (int mode = 0; mode < 3; mode++) {
+    int64_t start = bench_now_us();
+    for (size_t i = 0; i + 1 < BENCH_OPUS_FRAMES; i++) {
+      int decoded;
+      if (mode == 0) {
+        decoded = opus_codec_decode(&decoder, packets[i], sizes[i], pcm,
+                                    OPUS_CODEC_MAX_DECODE);
+      } else if (mode == 1) {
+        decoded = opus_codec_decode_fec(&decoder, packets[i + 1],
+                                        sizes[i + 1], pcm,
+                                        OPUS_CODEC_MAX_DECODE);
+      } else {
+        decoded = opus_codec_conceal(&decoder, pcm, OPUS_CODEC_MAX_DECODE);
+      }
+      if (decoded != (int)frame_samples) {
+        bench_fail("opus", "decode returned a short frame");
+        break;
+      }
+    }
+    int64_t elapsed = bench_now_us() - start;
+
+    char name[64];
+    snprintf(name, sizeof(name), "decode.%lukhz.%s.frame_time",
+             (unsigned long)(sample_rate / 1000), modes[mode]);
+    bench_report("opus", name, (double)elapsed / (BENCH_OPUS_FRAMES - 1),
+                 "us");
+  }
+  opus_codec_decoder_free(&decoder);
+}
+
+// Both supported rates at the configured bitrate, plus the configured
+// complexity if it is not one of the two always measured.
+void bench_opus(void) {
+  const uint32_t rates[] = {16000, 24000};
+  const int complexities[] = {0, 5};
+  for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+    for (size_t c = 0; c < sizeof(complexities) / sizeof(complexities[0]);
+         c++) {
+      run_encode(rates[r], OPUS_ENCODER_BITRATE, complexities[c]);
+    }
+    run_decode(rates[r]);
+  }
+  if (OPUS_ENCODER_COMPLEXITY != 0 && OPUS_ENCODER_COMPLEXITY != 5) {
+    run_encode(OPUS_SAMPLE_RATE, OPUS_ENCODER_BITRATE,
+               OPUS_ENCODER_COMPLEXITY);
+  }
+}
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "event_builder.h"
+#include "json_scan.h"
+
+#define BENCH_OUTBOUND_TICKS 20000
+
+// Stands in for the SCTP association: takes a varying number of messages per
+// tick and refuses the rest, and checks every message it gets.
+typedef struct {
+  uint32_t lcg;
+  int credit;
+  uint32_t received;
+  uint32_t invalid;
+} bench_transport_t;
+
+static bool transport_send(const char *data, size_t len, void *user_data) {
+  bench_transport_t *transport = (bench_transport_t *)user_data;
+  if (transport->credit == 0) {
+    return false;
+  }
+  transport->credit--;
+  json_value_t type;
+  if (!json_get(data, len, "type", &type) || type.kind != JSON_STRING) {
+    transport->invalid++;
+  }
+  transport->received++;
+  return true;
+}
+
+// Keeps what went out, so the checks below can compare the order the server
+// would see with the order events were queued in.
+#define BENCH_OUTBOUND_LOG 16
+
+typedef struct {
+  int credit;
+  size_t count;
+  char sent[BENCH_OUTBOUND_LOG][64];
+} order_transport_t;
+
+static bool order_send(const char *data, size_t len, void *user_data) {
+  order_transport_t *transport = (order_transport_t *)user_data;
+  if (transport->credit == 0 || transport->count == BENCH_OUTBOUND_LOG) {
+    return false;
+  }
+  transport->credit--;
+  // The type, and for session.update its voice, which tells the two apart.
+  json_value_t type = {};
+  json_value_t session;
+  json_value_t voice = {};
+  json_get(data, len, "type", &type);
+  if (json_get(data, len, "session", &session)) {
+    json_value_get(&session, "voice", &voice);
+  }
+  snprintf(transport->sent[transport->count++], 64, "%.*s%s%.*s",
+           (int)type.len, type.ptr, voice.len > 0 ? ":" : "", (int)voice.len,
+           voice.ptr);
+  return true;
+}
+
+static bool sent_in_order(order_transport_t *transport,
+                          const char *const *expected, size_t count) {
+  if (transport->count != count) {
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(transport->sent[i], expected[i]) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void check_order(void) {
+  static event_queue_t queue;
+  order_transport_t transport = {};
+  event_session_config_t first = {NULL, "alloy", 0};
+  event_session_config_t second = {NULL, "echo", 0};
+
+  // A later update must not overtake the events queued before it.
+  event_queue_init(&queue, order_send, &transport);
+  event_session_update(&queue, &first);
+  event_item_create(&queue, "user", "Hi");
+  event_response_create(&queue, NULL);
+  event_session_update(&queue, &second);
+  event_session_update(&queue, &second);
+  transport.credit = EVENT_QUEUE_SLOTS;
+  event_queue_flush(&queue);
+  const char *const updates[] = {"session.update:alloy",
+                                 "conversation.item.create",
+                                 "response.create", "session.update:echo"};
+  if (!sent_in_order(&transport, updates, 4)) {
+    bench_fail("outbound", "session.update coalesced out of order");
+  }
+
+  // The second cancel is for the response created in between.
+  transport = {};
+  event_queue_init(&queue, order_send, &transport);
+  event_response_cancel(&queue);
+  event_response_create(&queue, NULL);
+  event_response_cancel(&queue);
+  event_response_cancel(&queue);
+  transport.credit = EVENT_QUEUE_SLOTS;
+  event_queue_flush(&queue);
+  const char *const cancels[] = {"response.cancel", "response.create",
+                                 "response.cancel"};
+  if (!sent_in_order(&transport, cancels, 3)) {
+    bench_fail("outbound", "response.cancel dropped across a response");
+  }
+
+  // A full queue still takes an update that replaces its last event.
+  transport = {};
+  event_queue_init(&queue, order_send, &transport);
+  for (int i = 0; i < EVENT_QUEUE_SLOTS - 1; i++) {
+    event_response_create(&queue, NULL);
+  }
+  event_session_update(&queue, &first);
+  if (!event_session_update(&queue, &second) ||
+      event_response_create(&queue, NULL)) {
+    bench_fail("outbound", "full queue coalesced or overfilled wrongly");
+  }
+  transport.credit = EVENT_QUEUE_SLOTS;
+  event_queue_flush(&queue);
+  if (transport.count != EVENT_QUEUE_SLOTS ||
+      strcmp(transport.sent[EVENT_QUEUE_SLOTS - 1], "session.update:echo") !=
+          0) {
+    bench_fail("outbound", "full queue lost the newer session.update");
+  }
+}
+
+void bench_outbound(void) {
+  check_order();
+
+  static event_queue_t queue;
+  bench_transport_t transport = {1, 0, 0, 0};
+  event_queue_init(&queue, transport_send, &transport);
+
+  event_session_config_t session = {"Be brief.\nAnswer in \"English\".",
+                                    "alloy", 500};
+  uint32_t attempted = 0;
+  int64_t build_us = 0;
+  for (int tick = 0; tick < BENCH_OUTBOUND_TICKS; tick++) {
+    int64_t start = bench_now_us();
+    switch (tick % 4) {
+      case 0:
+        // Two updates in one tick go out as one.
+        event_session_update(&queue, &session);
+        event_session_update(&queue, &session);
+        attempted += 2;
+        break;
+      case 1:
+        event_item_create(&queue, "user", "What's the weather?");
+        event_response_create(&queue, NULL);
+        attempted += 2;
+        break;
+      case 2:
+        event_response_cancel(&queue);
+        event_response_cancel(&queue);
+        event_item_truncate(&queue, "item_A1", 1840);
+        attempted += 3;
+        break;
+      default:
+        break;
+    }
+    build_us += bench_now_us() - start;
+
+    transport.lcg = transport.lcg * 1664525 + 1013904223;
+    transport.credit = (transport.lcg >> 16) % 5;
+    event_queue_flush(&queue);
+  }
+  transport.credit = EVENT_QUEUE_SLOTS;
+  event_queue_flush(&queue);
+
+  event_queue_stats_t stats;
+  event_queue_get_stats(&queue, &stats);
+  bench_report("outbound", "build_time", build_us * 1000.0 / attempted,
+               "ns/event");
+  bench_report("outbound", "coalesced", stats.coalesced, "events");
+  bench_report("outbound", "stalls", stats.stalls, "flushes");
+  bench_report("outbound", "depth_max", stats.depth_max, "events");
+  bench_report("outbound", "rejected", stats.rejected, "events");
+
+  if (transport.invalid != 0 || stats.depth != 0 ||
+      transport.received != stats.sent ||
+      stats.sent + stats.coalesced + stats.rejected != attempted) {
+    bench_fail("outbound", "events lost or malformed");
+  }
+}
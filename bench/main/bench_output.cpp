@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "audio_device_sim.h"
+#include "audio_output.h"
+#include "bench.h"
+
+#define BENCH_OUTPUT_RATE 8000
+#define BENCH_OUTPUT_FRAME 160  // 20ms network frames
+#define BENCH_OUTPUT_FRAME_US 20000
+#define BENCH_OUTPUT_VIRTUAL_US (10 * 1000 * 1000)
+#define BENCH_OUTPUT_REALTIME_US (500 * 1000)
+#define BENCH_OUTPUT_RING 2048
+#define BENCH_OUTPUT_LEAD_US (100 * 1000)
+#define BENCH_OUTPUT_BACKLOG_US (200 * 1000)
+#define BENCH_OUTPUT_BARGE_INS 3
+#define BENCH_OUTPUT_BARGE_IN_EVERY_US (140 * 1000)
+
+// Pushes 20ms frames into the ring as they "arrive", with optional jitter.
+typedef struct {
+  audio_sim_clock_t *clock;
+  pcm_ring_t *ring;
+  audio_output_t *output;
+  int jitter_ms;
+  uint32_t lcg;
+  int64_t sent_us;
+  int64_t arrival_us;
+} bench_producer_t;
+
+static void producer_schedule(bench_producer_t *producer) {
+  producer->arrival_us = producer->sent_us;
+  if (producer->jitter_ms > 0) {
+    producer->lcg = producer->lcg * 1664525 + 1013904223;
+    producer->arrival_us += (producer->lcg >> 8) % (producer->jitter_ms * 1000);
+  }
+}
+
+static void producer_refill(size_t samples, void *user_data) {
+  bench_producer_t *producer = (bench_producer_t *)user_data;
+  int64_t now = audio_sim_clock_now(producer->clock);
+  while (producer->arrival_us <= now) {
+    size_t remaining = BENCH_OUTPUT_FRAME;
+    while (remaining > 0) {
+      size_t count = remaining;
+      int16_t *dst = pcm_ring_acquire_write(producer->ring, &count);
+      if (dst == NULL) {
+        audio_output_count_overrun(producer->output, remaining);
+        break;
+      }
+      memset(dst, 0x11, count * sizeof(int16_t));
+      pcm_ring_commit_write(producer->ring, count);
+      remaining -= count;
+    }
+    producer->sent_us += BENCH_OUTPUT_FRAME_US;
+    producer_schedule(producer);
+  }
+}
+
+static void run_profile(audio_profile_t profile, const char *profile_name,
+                        bool realtime, int jitter_ms) {
+  static int16_t storage[BENCH_OUTPUT_RING];
+  pcm_ring_t ring;
+  pcm_ring_init(&ring, storage, BENCH_OUTPUT_RING);
+
+  audio_sim_clock_t clock = {realtime, 0};
+  audio_sim_sink_t sink;
+  audio_output_device_t device;
+  audio_sim_sink_init(&sink, &clock, &device);
+
+  audio_output_t output;
+  bench_producer_t producer = {&clock, &ring, &output, jitter_ms, 7, 0, 0};
+  // Audio shows up once the engine is already idling, as it does on device.
+  producer.sent_us = audio_sim_clock_now(&clock) + BENCH_OUTPUT_LEAD_US;
+  producer_schedule(&producer);
+  audio_output_open(&output, &device, &ring, profile, BENCH_OUTPUT_RATE,
+                    producer_refill, &producer);
+
+  int64_t start = audio_sim_clock_now(&clock);
+  int64_t duration =
+      realtime ? BENCH_OUTPUT_REALTIME_US : BENCH_OUTPUT_VIRTUAL_US;
+  while (audio_sim_clock_now(&clock) - start < duration) {
+    if (device.wait_period(&device, AUDIO_OUTPUT_WAIT_MS)) {
+      audio_output_step(&output);
+    }
+  }
+
+  audio_output_stats_t stats;
+  audio_output_get_stats(&output, &stats);
+  double seconds = duration / 1e6;
+
+  char name[64];
+  const char *mode = realtime ? "realtime" : "virtual";
+  snprintf(name, sizeof(name), "%s.%s.jitter%d.underruns", profile_name, mode,
+           jitter_ms);
+  bench_report("output", name, stats.underruns, "periods");
+  snprintf(name, sizeof(name), "%s.%s.jitter%d.wakeups", profile_name, mode,
+           jitter_ms);
+  bench_report("output", name, sink.wakeups / seconds, "wakeups/s");
+  snprintf(name, sizeof(name), "%s.%s.device_latency", profile_name, mode);
+  bench_report("output", name,
+               output.config.period_samples * output.config.period_count *
+                   1000.0 / BENCH_OUTPUT_RATE,
+               "ms");
+  if (realtime) {
+    snprintf(name, sizeof(name), "%s.realtime.wake_error_avg", profile_name);
+    bench_report("output", name,
+                 sink.wakeups ? (double)sink.wake_error_total_us / sink.wakeups
+                              : 0,
+                 "us");
+    snprintf(name, sizeof(name), "%s.realtime.wake_error_max", profile_name);
+    bench_report("output", name, sink.wake_error_max_us, "us");
+  }
+
+  // The engine feeds a period on every completion event, silence included,
+  // so the device must never run dry and a clean feed must never underrun.
+  if (!realtime && stats.starved != 0) {
+    bench_fail("output", profile_name);
+  }
+  if (!realtime && jitter_ms == 0 && stats.underruns != 0) {
+    bench_fail("output", profile_name);
+  }
+}
+
+// Keeps the ring full as during a long answer, then barges in a few times
+// mid-period from the loop that waits on the device, the way a data channel
+// event lands while the engine sleeps.
+static void run_barge_in(audio_profile_t profile, const char *profile_name) {
+  static int16_t storage[BENCH_OUTPUT_RING];
+  pcm_ring_t ring;
+  pcm_ring_init(&ring, storage, BENCH_OUTPUT_RING);
+
+  audio_sim_clock_t clock = {true, 0};
+  audio_sim_sink_t sink;
+  audio_output_device_t device;
+  audio_sim_sink_init(&sink, &clock, &device);
+
+  audio_output_t output;
+  bench_producer_t producer = {&clock, &ring, &output, 0, 7, 0, 0};
+  // Frames "sent" in the past arrive at once and fill the ring.
+  producer.sent_us = audio_sim_clock_now(&clock) - BENCH_OUTPUT_BACKLOG_US;
+  producer_schedule(&producer);
+  audio_output_open(&output, &device, &ring, profile, BENCH_OUTPUT_RATE,
+                    producer_refill, &producer);
+
+  int64_t start = audio_sim_clock_now(&clock);
+  int requested = 0;
+  uint32_t played_before = 0;
+  while (audio_sim_clock_now(&clock) - start < BENCH_OUTPUT_REALTIME_US) {
+    int64_t due = start + (requested + 1) * BENCH_OUTPUT_BARGE_IN_EVERY_US +
+                  requested * 3000;
+    if (requested < BENCH_OUTPUT_BARGE_INS && audio_sim_clock_now(&clock) >= due) {
+      played_before = audio_output_played_samples(&output);
+      audio_output_flush(&output);
+      // Refill as if the backlog of a new answer had arrived.
+      producer.sent_us = audio_sim_clock_now(&clock) - BENCH_OUTPUT_BACKLOG_US;
+      producer_schedule(&producer);
+      requested++;
+    }
+    if (device.wait_period(&device, AUDIO_OUTPUT_WAIT_MS)) {
+      audio_output_step(&output);
+    }
+  }
+
+  audio_output_stats_t stats;
+  audio_output_get_stats(&output, &stats);
+  double period_ms = output.config.period_samples * 1000.0 / BENCH_OUTPUT_RATE;
+
+  char name[64];
+  snprintf(name, sizeof(name), "%s.barge_in.latency_max", profile_name);
+  bench_report("output", name, stats.flush_latency_max_us / 1000.0, "ms");
+  snprintf(name, sizeof(name), "%s.barge_in.period", profile_name);
+  bench_report("output", name, period_ms, "ms");
+  snprintf(name, sizeof(name), "%s.barge_in.dropped", profile_name);
+  bench_report("output", name,
+               stats.flushes ? stats.flushed_samples * 1000.0 /
+                                   BENCH_OUTPUT_RATE / stats.flushes
+                             : 0,
+               "ms/flush");
+
+  if (stats.flushes != BENCH_OUTPUT_BARGE_INS || stats.flushed_samples == 0) {
+    bench_fail("output", "barge-in flush not applied");
+  }
+  if (audio_output_played_samples(&output) < played_before) {
+    bench_fail("output", "played-out count went backwards");
+  }
+}
+
+void bench_output(void) {
+  const struct {
+    audio_profile_t profile;
+    const char *name;
+  } profiles[] = {
+      {AUDIO_PROFILE_LOW_LATENCY, "low_latency"},
+      {AUDIO_PROFILE_ROBUST, "robust"},
+  };
+
+  for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+    run_profile(profiles[i].profile, profiles[i].name, false, 0);
+    run_profile(profiles[i].profile, profiles[i].name, false, 40);
+    run_profile(profiles[i].profile, profiles[i].name, true, 0);
+    run_barge_in(profiles[i].profile, profiles[i].name);
+  }
+}
@@ -0,0 +1,130 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "media.h"
+#include "opus_codec.h"
+#include "ptime.h"
+
+// What each packetization time costs on the wire: packets per second, and
+// the share of the stream that is IP, UDP, RTP and SRTP headers. PCMA has a
+// fixed payload rate; Opus is encoded for real, since its per-packet TOC and
+// framing grow the payload of short packets too.
+
+#define BENCH_PTIME_SECONDS 10
+#define BENCH_PTIME_PCMA_BITRATE 64000
+
+static const uint32_t ptimes[] = {10, 20, 40, 60};
+
+// An offer shaped like libpeer's, audio between the session lines and the
+// data channel.
+static const char *bench_offer =
+    "v=0\r\n"
+    "o=- 1 1 IN IP4 0.0.0.0\r\n"
+    "s=-\r\n"
+    "t=0 0\r\n"
+    "a=group:BUNDLE 0 1\r\n"
+    "m=audio 9 UDP/TLS/RTP/SAVP 8\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=rtpmap:8 PCMA/8000\r\n"
+    "a=sendrecv\r\n"
+    "a=mid:0\r\n"
+    "m=application 50712 UDP/DTLS/SCTP webrtc-datachannel\r\n"
+    "a=mid:1\r\n";
+
+// Same signal as the opus suite.
+static void fill_voice(int16_t *samples, size_t count, uint32_t sample_rate,
+                       size_t offset) {
+  for (size_t i = 0; i < count; i++) {
+    double t = (double)(offset + i) / sample_rate;
+    double envelope = 0.5 + 0.5 * sin(2 * M_PI * 3 * t);
+    double voice = sin(2 * M_PI * 180 * t) + 0.5 * sin(2 * M_PI * 720 * t) +
+                   0.25 * sin(2 * M_PI * 2400 * t);
+    samples[i] = (int16_t)(6000 * envelope * voice);
+  }
+}
+
+// Payload bits per second Opus produces at `ptime_ms`, 0 on failure.
+static uint32_t opus_payload_bps(uint32_t ptime_ms) {
+  static opus_codec_encoder_t codec;
+  opus_codec_config_t config = {OPUS_SAMPLE_RATE, OPUS_ENCODER_BITRATE,
+                                OPUS_ENCODER_COMPLEXITY, 0};
+  if (!opus_codec_encoder_init(&codec, &config, NULL)) {
+    return 0;
+  }
+  static int16_t pcm[OPUS_CODEC_MAX_FRAME];
+  size_t frame_samples = OPUS_SAMPLE_RATE * ptime_ms / 1000;
+  size_t frames = BENCH_PTIME_SECONDS * 1000 / ptime_ms;
+  uint64_t bytes = 0;
+  for (size_t i = 0; i < frames; i++) {
+    fill_voice(pcm, frame_samples, OPUS_SAMPLE_RATE, i * frame_samples);
+    int size = opus_codec_encode(&codec, pcm, frame_samples);
+    if (size < 0) {
+      opus_codec_encoder_free(&codec);
+      return 0;
+    }
+    bytes += size;
+  }
+  opus_codec_encoder_free(&codec);
+  return (uint32_t)(bytes * 8 / BENCH_PTIME_SECONDS);
+}
+
+static void report_cost(const char *codec, uint32_t ptime_ms,
+                        const ptime_cost_t *cost) {
+  char name[64];
+  snprintf(name, sizeof(name), "%s.%lums.packet_rate", codec,
+           (unsigned long)ptime_ms);
+  bench_report("ptime", name, cost->packets_per_s, "Hz");
+  snprintf(name, sizeof(name), "%s.%lums.payload", codec,
+           (unsigned long)ptime_ms);
+  bench_report("ptime", name, cost->payload_bytes, "B");
+  snprintf(name, sizeof(name), "%s.%lums.header_overhead", codec,
+           (unsigned long)ptime_ms);
+  bench_report("ptime", name, cost->overhead_permille / 10.0, "%");
+  snprintf(name, sizeof(name), "%s.%lums.wire_rate", codec,
+           (unsigned long)ptime_ms);
+  bench_report("ptime", name, cost->wire_bps / 1000.0, "kbit/s");
+}
+
+static void run_codec(const char *codec, bool opus) {
+  uint32_t last_overhead = 1000;
+  for (size_t i = 0; i < sizeof(ptimes) / sizeof(ptimes[0]); i++) {
+    uint32_t payload_bps =
+        opus ? opus_payload_bps(ptimes[i]) : BENCH_PTIME_PCMA_BITRATE;
+    if (payload_bps == 0) {
+      bench_fail("ptime", "opus encode");
+      return;
+    }
+    ptime_cost_t cost;
+    ptime_cost(ptimes[i], payload_bps, &cost);
+    report_cost(codec, ptimes[i], &cost);
+    if (cost.overhead_permille >= last_overhead) {
+      bench_fail("ptime", "longer packets did not cut header overhead");
+    }
+    last_overhead = cost.overhead_permille;
+  }
+}
+
+// The offer must carry each ptime where the answerer looks for it.
+static void check_offer(void) {
+  static char offer[1024];
+  for (size_t i = 0; i < sizeof(ptimes) / sizeof(ptimes[0]); i++) {
+    size_t len = ptime_offer(bench_offer, ptimes[i], PTIME_MAX_MS, offer,
+                             sizeof(offer));
+    if (len != strlen(offer) || ptime_from_sdp(offer) != ptimes[i] ||
+        strstr(offer, "a=mid:0\r\na=ptime:") == NULL) {
+      bench_fail("ptime", "a=ptime missing from the offer's audio section");
+    }
+  }
+  if (ptime_from_sdp(bench_offer) != 0 ||
+      ptime_offer(bench_offer, 20, PTIME_MAX_MS, offer, 64) != 0) {
+    bench_fail("ptime", "offer rewrite overran or invented a ptime");
+  }
+}
+
+void bench_ptime(void) {
+  check_offer();
+  run_codec("pcma", false);
+  run_codec("opus", true);
+}
@@ -0,0 +1,96 @@
+#include <stdio.h>
+
+#include "bench.h"
+#include "reconnect.h"
+
+#define BENCH_RECONNECT_TICK_US (15 * 1000)  // Network loop interval
+#define BENCH_RECONNECT_SETUP_US (800 * 1000)  // Offer, answer, ICE, DTLS
+#define BENCH_RECONNECT_DEVICES 1000
+
+// Runs one device in virtual time through an outage of `outage_ms`: every
+// attempt made while the server is down is refused at once, the first one
+// after it connects once the session is set up.
+static void run_outage(uint32_t outage_ms) {
+  reconnect_t reconnect;
+  reconnect_init(&reconnect, RECONNECT_BASE_MS, RECONNECT_MAX_MS, 7);
+
+  int64_t now = 0;
+  int64_t down_until = 0;
+  int64_t connect_at = -1;
+  bool lost = false;
+  while (reconnect.stats.recoveries == 0 && now < 600LL * 1000 * 1000) {
+    if (reconnect_poll(&reconnect, now) == RECONNECT_START) {
+      if (now < down_until) {
+        reconnect_failed(&reconnect, now);
+      } else {
+        connect_at = now + BENCH_RECONNECT_SETUP_US;
+      }
+    }
+    if (connect_at >= 0 && now >= connect_at) {
+      reconnect_connected(&reconnect, now);
+      connect_at = -1;
+    }
+    if (!lost && reconnect.state == RECONNECT_CONNECTED) {
+      // The session drops as the server goes away.
+      lost = true;
+      down_until = now + (int64_t)outage_ms * 1000;
+      reconnect_failed(&reconnect, now);
+    }
+    now += BENCH_RECONNECT_TICK_US;
+  }
+
+  char name[64];
+  snprintf(name, sizeof(name), "outage%lums.recover",
+           (unsigned long)outage_ms);
+  bench_report("reconnect", name, reconnect.stats.recover_last_us / 1000.0,
+               "ms");
+  snprintf(name, sizeof(name), "outage%lums.attempts",
+           (unsigned long)outage_ms);
+  bench_report("reconnect", name, reconnect.stats.attempts, "sessions");
+
+  // Backing off must never cost more than one capped step past the outage.
+  int64_t bound = (int64_t)outage_ms * 1000 + RECONNECT_MAX_MS * 1000LL +
+                  BENCH_RECONNECT_SETUP_US + BENCH_RECONNECT_TICK_US;
+  if (reconnect.stats.recoveries != 1 ||
+      reconnect.stats.recover_last_us > bound) {
+    bench_fail("reconnect", "recovery slower than the backoff allows");
+  }
+}
+
+// Many devices losing the same server at once must not retry in lockstep.
+static void run_spread(void) {
+  for (uint32_t failure = 0; failure < 8; failure++) {
+    uint32_t step = RECONNECT_BASE_MS << failure;
+    if (step > RECONNECT_MAX_MS) {
+      step = RECONNECT_MAX_MS;
+    }
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    for (uint32_t device = 0; device < BENCH_RECONNECT_DEVICES; device++) {
+      reconnect_t reconnect;
+      reconnect_init(&reconnect, RECONNECT_BASE_MS, RECONNECT_MAX_MS,
+                     device * 2654435761u);
+      uint32_t delay = 0;
+      for (uint32_t i = 0; i <= failure; i++) {
+        delay = reconnect_failed(&reconnect, 1);
+      }
+      min = delay < min ? delay : min;
+      max = delay > max ? delay : max;
+    }
+    if (min < step / 2 || max > step || max - min < step / 4) {
+      bench_fail("reconnect", "backoff outside its step or not jittered");
+    }
+    if (failure == 0 || failure == 7) {
+      char name[64];
+      snprintf(name, sizeof(name), "failure%lu.spread", (unsigned long)failure);
+      bench_report("reconnect", name, max - min, "ms");
+    }
+  }
+}
+
+void bench_reconnect(void) {
+  run_outage(0);
+  run_outage(5 * 1000);
+  run_outage(60 * 1000);
+  run_spread();
+}
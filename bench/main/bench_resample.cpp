@@ -0,0 +1,151 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "resampler.h"
+
+#define BENCH_RESAMPLE_FRAME_MS 20
+#define BENCH_RESAMPLE_FRAMES 500  // 10s of audio per ratio
+#define BENCH_RESAMPLE_TONE_HZ 1000
+#define BENCH_RESAMPLE_AMPLITUDE 16000
+#define BENCH_RESAMPLE_MIN_SNR_DB 40
+
+static int16_t input[RESAMPLER_MAX_INPUT];
+static int16_t output[RESAMPLER_MAX_INPUT * RESAMPLER_MAX_RATIO + 1];
+
+static void fill_tone(int16_t *samples, size_t count, double hz,
+                      uint32_t rate, size_t offset) {
+  for (size_t i = 0; i < count; i++) {
+    samples[i] = (int16_t)(BENCH_RESAMPLE_AMPLITUDE *
+                           sin(2 * M_PI * hz * (double)(offset + i) / rate));
+  }
+}
+
+// Resamples a 1kHz tone and compares it with the tone generated directly at
+// the output rate, shifted by the filter delay. Aliases, images and
+// quantization all count as noise.
+static double tone_snr_db(resampler_t *resampler) {
+  size_t in_frame = resampler->in_rate * BENCH_RESAMPLE_FRAME_MS / 1000;
+  double delay = (resampler->up * resampler->taps - 1) / 2.0 /
+                 resampler->down;
+  double signal = 0, noise = 0;
+  size_t produced_total = 0;
+  resampler_reset(resampler);
+  for (size_t frame = 0; frame < 50; frame++) {
+    fill_tone(input, in_frame, BENCH_RESAMPLE_TONE_HZ, resampler->in_rate,
+              frame * in_frame);
+    size_t produced = resampler_process(resampler, input, in_frame, output);
+    // Skip the filter's start-up.
+    for (size_t i = 0; frame >= 2 && i < produced; i++) {
+      double t = (produced_total + i - delay) / resampler->out_rate;
+      double expected = BENCH_RESAMPLE_AMPLITUDE *
+                        sin(2 * M_PI * BENCH_RESAMPLE_TONE_HZ * t);
+      signal += expected * expected;
+      noise += (output[i] - expected) * (output[i] - expected);
+    }
+    produced_total += produced;
+  }
+  return 10 * log10(signal / (noise > 0 ? noise : 1));
+}
+
+// Going down, a tone between the two Nyquist frequencies must not fold back
+// into the output. Returns its attenuation.
+static double alias_rejection_db(resampler_t *resampler) {
+  size_t in_frame = resampler->in_rate * BENCH_RESAMPLE_FRAME_MS / 1000;
+  double hz = (resampler->in_rate + resampler->out_rate) / 4.0;
+  double in_power = 0, out_power = 0;
+  resampler_reset(resampler);
+  for (size_t frame = 0; frame < 50; frame++) {
+    fill_tone(input, in_frame, hz, resampler->in_rate, frame * in_frame);
+    size_t produced = resampler_process(resampler, input, in_frame, output);
+    if (frame < 2) {
+      continue;
+    }
+    for (size_t i = 0; i < in_frame; i++) {
+      in_power += (double)input[i] * input[i] / in_frame;
+    }
+    for (size_t i = 0; i < produced; i++) {
+      out_power += (double)output[i] * output[i] / produced;
+    }
+  }
+  return 10 * log10(in_power / (out_power > 0 ? out_power : 1));
+}
+
+static void run_ratio(uint32_t in_rate, uint32_t out_rate) {
+  static resampler_t resampler;
+  char name[64];
+  snprintf(name, sizeof(name), "%lu_to_%lu", (unsigned long)(in_rate / 1000),
+           (unsigned long)(out_rate / 1000));
+  if (!resampler_init(&resampler, in_rate, out_rate)) {
+    bench_fail("resample", name);
+    return;
+  }
+
+  size_t in_frame = in_rate * BENCH_RESAMPLE_FRAME_MS / 1000;
+  size_t out_frame = out_rate * BENCH_RESAMPLE_FRAME_MS / 1000;
+  fill_tone(input, in_frame, BENCH_RESAMPLE_TONE_HZ, in_rate, 0);
+
+  size_t produced = 0;
+  bool exact = true;
+  uint64_t cycles_start = bench_cycles();
+  int64_t start = bench_now_us();
+  for (int frame = 0; frame < BENCH_RESAMPLE_FRAMES; frame++) {
+    size_t count = resampler_process(&resampler, input, in_frame, output);
+    exact = exact && count == out_frame;
+    produced += count;
+  }
+  int64_t elapsed = bench_now_us() - start;
+  uint64_t cycles = bench_cycles() - cycles_start;
+
+  char metric[96];
+  snprintf(metric, sizeof(metric), "%s.sample_time", name);
+  bench_report("resample", metric, elapsed * 1000.0 / produced, "ns");
+  if (cycles > 0) {
+    snprintf(metric, sizeof(metric), "%s.sample_cycles", name);
+    bench_report("resample", metric, (double)cycles / produced,
+                 "cycles/sample");
+  }
+  snprintf(metric, sizeof(metric), "%s.frame_budget", name);
+  bench_report("resample", metric,
+               elapsed / 1000.0 / BENCH_RESAMPLE_FRAMES /
+                   BENCH_RESAMPLE_FRAME_MS * 100,
+               "%");
+  snprintf(metric, sizeof(metric), "%s.taps", name);
+  bench_report("resample", metric, resampler.taps, "taps");
+  snprintf(metric, sizeof(metric), "%s.delay", name);
+  bench_report("resample", metric,
+               resampler_delay(&resampler) * 1000.0 / out_rate, "ms");
+
+  double snr = tone_snr_db(&resampler);
+  snprintf(metric, sizeof(metric), "%s.tone_snr", name);
+  bench_report("resample", metric, snr, "dB");
+
+  if (out_rate < in_rate) {
+    double rejection = alias_rejection_db(&resampler);
+    snprintf(metric, sizeof(metric), "%s.alias_rejection", name);
+    bench_report("resample", metric, rejection, "dB");
+    if (rejection < BENCH_RESAMPLE_MIN_SNR_DB) {
+      bench_fail("resample", "aliasing above the output Nyquist");
+    }
+  }
+
+  if (!exact) {
+    bench_fail("resample", "20ms frame did not map to a whole output frame");
+  }
+  if (snr < BENCH_RESAMPLE_MIN_SNR_DB) {
+    bench_fail("resample", "1kHz tone SNR too low");
+  }
+}
+
+void bench_resample(void) {
+  const uint32_t rates[] = {8000, 16000, 24000, 48000};
+  const size_t count = sizeof(rates) / sizeof(rates[0]);
+  for (size_t i = 0; i < count; i++) {
+    for (size_t o = 0; o < count; o++) {
+      if (i != o) {
+        run_ratio(rates[i], rates[o]);
+      }
+    }
+  }
+}
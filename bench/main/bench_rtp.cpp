@@ -0,0 +1,139 @@
+#include <string.h>
+
+#include "bench.h"
+#include "rtp_stamp.h"
+
+// What stamping costs per outgoing packet, and checks that packets carry the
+// capture timestamps and marker bits they were pushed with: across frames
+// the VAD held back, a frame libpeer refused, identical silent frames, a new
+// peer connection, and with no stamp at all.
+
+#define BENCH_RTP_PACKETS 100000
+#define BENCH_RTP_PAYLOAD 160  // 20ms of PCMA
+#define BENCH_RTP_STEP 160
+#define BENCH_RTP_PT 8
+
+typedef struct {
+  uint8_t data[12 + BENCH_RTP_PAYLOAD];
+} packet_t;
+
+// A-law silence, the same bytes in every frame.
+static void make_packet(packet_t *packet, uint8_t payload_type, uint16_t seq) {
+  memset(packet->data, 0, 12);
+  packet->data[0] = 0x80;
+  packet->data[1] = payload_type;
+  packet->data[2] = (uint8_t)(seq >> 8);
+  packet->data[3] = (uint8_t)seq;
+  memset(packet->data + 12, 0xD5, BENCH_RTP_PAYLOAD);
+}
+
+static uint32_t packet_timestamp(const packet_t *packet) {
+  const uint8_t *p = packet->data;
+  return ((uint32_t)p[4] << 24) | (p[5] << 16) | (p[6] << 8) | p[7];
+}
+
+static bool packet_marker(const packet_t *packet) {
+  return (packet->data[1] & 0x80) != 0;
+}
+
+static void run_cost(void) {
+  static rtp_stamp_queue_t queue;
+  rtp_stamp_init(&queue, BENCH_RTP_PT, BENCH_RTP_STEP);
+  packet_t packet;
+  int64_t elapsed = 0;
+  uint32_t wrong = 0;
+  for (uint32_t i = 0; i < BENCH_RTP_PACKETS; i++) {
+    make_packet(&packet, BENCH_RTP_PT, (uint16_t)i);
+    int64_t start = bench_now_us();
+    rtp_stamp_push(&queue, i * BENCH_RTP_STEP, false);
+    rtp_stamp_apply(&queue, packet.data, sizeof(packet.data));
+    elapsed += bench_now_us() - start;
+    wrong += packet_timestamp(&packet) != i * BENCH_RTP_STEP;
+  }
+  bench_report("rtp", "stamp", elapsed * 1000.0 / BENCH_RTP_PACKETS, "ns");
+  if (wrong > 0 || queue.stats.applied != BENCH_RTP_PACKETS) {
+    bench_fail("rtp", "packets lost their stamps");
+  }
+}
+
+static void check_pairing(void) {
+  static rtp_stamp_queue_t queue;
+  rtp_stamp_init(&queue, BENCH_RTP_PT, BENCH_RTP_STEP);
+  // Frames 0-2 sent, 3-9 suppressed, 10 refused by libpeer, 11-12 sent; all
+  // queued before any is protected, as libpeer does. The sender marks what
+  // follows a gap: the first frame and, as 10 was refused, frame 11.
+  // Sequence numbers wrap on the way.
+  const uint32_t sent[] = {0, 1, 2, 11, 12};
+  const bool marked[] = {true, false, false, true, false};
+  for (uint32_t frame = 0; frame <= 12; frame++) {
+    if (frame >= 3 && frame <= 9) {
+      continue;
+    }
+    rtp_stamp_push(&queue, 1000 + frame * BENCH_RTP_STEP,
+                   frame == 0 || frame == 11);
+    if (frame == 10) {
+      rtp_stamp_cancel(&queue);
+    }
+  }
+  bool ok = true;
+  bool markers_ok = true;
+  for (size_t i = 0; i < 5; i++) {
+    packet_t packet;
+    make_packet(&packet, BENCH_RTP_PT, (uint16_t)(65534 + i));
+    rtp_stamp_apply(&queue, packet.data, sizeof(packet.data));
+    ok = ok && packet_timestamp(&packet) == 1000 + sent[i] * BENCH_RTP_STEP;
+    markers_ok = markers_ok && packet_marker(&packet) == marked[i];
+  }
+  if (!ok || queue.stats.applied != 5) {
+    bench_fail("rtp", "timestamps did not follow the capture clock");
+  }
+  if (!markers_ok) {
+    bench_fail("rtp", "marker bit not where the sender put it");
+  }
+
+  // No stamp: one step on from the last packet. Another payload type, e.g.
+  // RTCP or video: untouched.
+  packet_t packet;
+  make_packet(&packet, BENCH_RTP_PT, 3);
+  rtp_stamp_apply(&queue, packet.data, sizeof(packet.data));
+  if (packet_timestamp(&packet) != 1000 + 13 * BENCH_RTP_STEP) {
+    bench_fail("rtp", "unstamped packet not stepped from the last one");
+  }
+  make_packet(&packet, 96, 4);
+  rtp_stamp_apply(&queue, packet.data, sizeof(packet.data));
+  if (packet_timestamp(&packet) != 0) {
+    bench_fail("rtp", "stamped a packet of another payload type");
+  }
+}
+
+// Frames the old peer connection accepted but never sent must not shift the
+// new one's stamps, whatever its first sequence number.
+static void check_restart(void) {
+  static rtp_stamp_queue_t queue;
+  rtp_stamp_init(&queue, BENCH_RTP_PT, BENCH_RTP_STEP);
+  for (uint32_t frame = 0; frame < 4; frame++) {
+    rtp_stamp_push(&queue, frame * BENCH_RTP_STEP, frame == 0);
+  }
+  packet_t packet;
+  make_packet(&packet, BENCH_RTP_PT, 100);
+  rtp_stamp_apply(&queue, packet.data, sizeof(packet.data));
+
+  rtp_stamp_restart(&queue);
+  bool ok = true;
+  for (uint32_t frame = 10; frame < 10 + 2 * RTP_STAMP_QUEUE; frame++) {
+    rtp_stamp_push(&queue, frame * BENCH_RTP_STEP, frame == 10);
+    make_packet(&packet, BENCH_RTP_PT, (uint16_t)(40000 + frame));
+    rtp_stamp_apply(&queue, packet.data, sizeof(packet.data));
+    ok = ok && packet_timestamp(&packet) == frame * BENCH_RTP_STEP &&
+         packet_marker(&packet) == (frame == 10);
+  }
+  if (!ok || queue.stats.full != 0) {
+    bench_fail("rtp", "new peer connection took the old one's stamps");
+  }
+}
+
+void bench_rtp(void) {
+  run_cost();
+  check_pairing();
+  check_restart();
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "http_body.h"
+
+#define BENCH_SIGNALING_ROUNDS 2000
+#define BENCH_SIGNALING_CANDIDATES 80  // Outgrows the initial buffer
+#define BENCH_SIGNALING_INITIAL 4096
+#define BENCH_SIGNALING_LIMIT (32 * 1024)
+
+// An answer the size a server with many ICE candidates sends back.
+static size_t build_answer(char *answer, size_t size) {
+  size_t len = snprintf(
+      answer, size,
+      "v=0\r\no=- 4215775240449105457 2 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n"
+      "a=group:BUNDLE 0 1\r\nm=audio 9 UDP/TLS/RTP/SAVPF 8\r\n"
+      "c=IN IP4 0.0.0.0\r\na=ice-ufrag:Vbx7\r\n"
+      "a=ice-pwd:Lq5o3bWqeyk4GQVhUx5H8nZt\r\na=fingerprint:sha-256 "
+      "5C:A2:91:0A:6D:2F:75:00:A3:4B:9C:7F:10:BB:E4:11:0D:3A:77:62:8E:C1:"
+      "4F:02:AA:39:D6:58:13:E0:C9:20\r\na=setup:passive\r\na=mid:0\r\n");
+  for (int i = 0; i < BENCH_SIGNALING_CANDIDATES && len < size; i++) {
+    len += snprintf(answer + len, size - len,
+                    "a=candidate:%d 1 udp 2130706431 10.0.%d.%d %d typ host "
+                    "generation 0\r\n",
+                    i, i / 250, i % 250 + 1, 3478 + i);
+  }
+  return len;
+}
+
+// Feeds the answer the way the HTTP client hands it over: in pieces of
+// `piece` bytes, optionally after learning the length from the headers.
+static void run_pieces(const char *answer, size_t len, size_t piece,
+                       bool reserve) {
+  http_body_t body;
+  if (!http_body_init(&body, BENCH_SIGNALING_INITIAL, BENCH_SIGNALING_LIMIT)) {
+    bench_fail("signaling", "allocation failed");
+    return;
+  }
+
+  bool ok = true;
+  int64_t start = bench_now_us();
+  for (int round = 0; round < BENCH_SIGNALING_ROUNDS; round++) {
+    http_body_reset(&body);
+    if (reserve) {
+      http_body_reserve(&body, len);
+    }
+    for (size_t offset = 0; offset < len; offset += piece) {
+      size_t count = len - offset < piece ? len - offset : piece;
+      ok &= http_body_append(&body, answer + offset, count);
+    }
+  }
+  int64_t elapsed = bench_now_us() - start;
+
+  char name[64];
+  snprintf(name, sizeof(name), "piece%zu%s", piece,
+           reserve ? ".content_length" : ".chunked");
+  bench_report("signaling", name,
+               elapsed * 1000.0 / BENCH_SIGNALING_ROUNDS / len, "ns/byte");
+
+  if (!ok || body.len != len || memcmp(body.data, answer, len) != 0 ||
+      body.data[len] != '\0') {
+    bench_fail("signaling", "answer reassembled wrong");
+  }
+  http_body_free(&body);
+}
+
+void bench_signaling(void) {
+  static char answer[BENCH_SIGNALING_LIMIT];
+  size_t len = build_answer(answer, sizeof(answer));
+  bench_report("signaling", "answer_size", len, "bytes");
+
+  const size_t pieces[] = {1, 61, 512, 1460};
+  for (size_t i = 0; i < sizeof(pieces) / sizeof(pieces[0]); i++) {
+    run_pieces(answer, len, pieces[i], false);
+  }
+  run_pieces(answer, len, 1460, true);
+
+  // Anything past the limit is refused as a whole, not truncated silently.
+  http_body_t body;
+  http_body_init(&body, 64, 128);
+  http_body_append(&body, answer, 100);
+  if (http_body_append(&body, answer, 100) || !body.overflow ||
+      body.len != 100) {
+    bench_fail("signaling", "oversized answer accepted");
+  }
+  http_body_free(&body);
+}
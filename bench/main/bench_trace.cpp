@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "trace.h"
+
+// What one trace record costs next to the formatted log line it replaces on
+// a hot path, and a check that a dump holds the latest ring's worth in order.
+// The bench is built with OAI_TRACE, so TRACE records for real here.
+
+#define BENCH_TRACE_RECORDS 1000000
+#define BENCH_TRACE_DUMP_MAX \
+  (16 + 4 * 12 + 4 * TRACE_RING_RECORDS * sizeof(trace_record_t))
+
+typedef struct {
+  uint8_t data[BENCH_TRACE_DUMP_MAX];
+  size_t len;
+} dump_t;
+
+static dump_t dump;
+
+static void dump_write(const void *data, size_t size, void *ctx) {
+  dump_t *out = (dump_t *)ctx;
+  if (out->len + size <= sizeof(out->data)) {
+    memcpy(out->data + out->len, data, size);
+  }
+  out->len += size;
+}
+
+static uint32_t read_u32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void run_record(void) {
+  int64_t start = bench_now_us();
+  for (uint32_t i = 0; i < BENCH_TRACE_RECORDS; i++) {
+    TRACE(TRACE_DOWNLINK_RECEIVED, i, 160);
+  }
+  int64_t elapsed = bench_now_us() - start;
+  bench_report("trace", "record", elapsed * 1000.0 / BENCH_TRACE_RECORDS,
+               "ns");
+
+  // The per-packet debug line the decoder used to format.
+  static char line[96];
+  size_t written = 0;
+  start = bench_now_us();
+  for (uint32_t i = 0; i < BENCH_TRACE_RECORDS; i++) {
+    written +=
+        snprintf(line, sizeof(line), "oai_audio_decode: %llu, size: %d",
+                 (unsigned long long)(start + i), 160);
+  }
+  double formatted = (bench_now_us() - start) * 1000.0 / BENCH_TRACE_RECORDS;
+  bench_report("trace", "formatted_line", formatted, "ns");
+  if (written == 0) {
+    bench_fail("trace", "snprintf");
+  }
+  if (elapsed * 1000.0 / BENCH_TRACE_RECORDS >= formatted) {
+    bench_fail("trace", "a record costs as much as formatting a line");
+  }
+}
+
+// The last records written are in the dump, oldest first, all valid.
+static void check_dump(void) {
+  for (uint32_t i = 0; i < TRACE_RING_RECORDS; i++) {
+    TRACE(TRACE_UPLINK_SENT, i, ~i);
+  }
+  dump.len = 0;
+  int64_t start = bench_now_us();
+  trace_dump(dump_write, &dump);
+  bench_report("trace", "dump", bench_now_us() - start, "us");
+  bench_report("trace", "dump_size", dump.len, "B");
+
+  const uint8_t *p = dump.data;
+  if (dump.len > sizeof(dump.data) || memcmp(p, "OAIT", 4) != 0 ||
+      read_u32(p + 8) == 0) {
+    bench_fail("trace", "dump header");
+    return;
+  }
+  // Everything ran on one thread, so the first ring holds it all.
+  uint32_t first = read_u32(p + 16);
+  uint32_t count = read_u32(p + 20);
+  const uint8_t *records = p + 24;
+  bool ordered = count == TRACE_RING_RECORDS;
+  for (uint32_t i = 0; ordered && i < count; i++) {
+    const uint8_t *record = records + i * sizeof(trace_record_t);
+    uint16_t event = record[4] | (record[5] << 8);
+    uint16_t seq = record[6] | (record[7] << 8);
+    ordered = event == TRACE_UPLINK_SENT &&
+              seq == (uint16_t)(first + i) && read_u32(record + 8) == i &&
+              read_u32(record + 12) == ~i;
+  }
+  if (!ordered) {
+    bench_fail("trace", "dump lost or reordered the latest records");
+  }
+}
+
+void bench_trace(void) {
+  run_record();
+  check_dump();
+}
@@ -0,0 +1,179 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "audio_capture.h"
+#include "audio_device_sim.h"
+#include "bench.h"
+#include "vad.h"
+
+#define BENCH_VAD_RATE 8000
+#define BENCH_VAD_FRAME_MS 20
+#define BENCH_VAD_FRAME_BYTES 160  // A-law
+#define BENCH_VAD_CYCLES 6
+#define BENCH_VAD_NOISE_MS 3000
+#define BENCH_VAD_SPEECH_MS 1500
+#define BENCH_VAD_NOISE_AMPLITUDE 60
+#define BENCH_VAD_MIN_ACCURACY 0.95
+
+// Ground truth per frame, filled in while the input is generated.
+static bool truth[BENCH_VAD_CYCLES * (BENCH_VAD_NOISE_MS + BENCH_VAD_SPEECH_MS) /
+                  BENCH_VAD_FRAME_MS];
+
+// Background noise, then a burst of voiced sound, repeated. Frames count as
+// speech in the truth table for the burst plus the VAD's hangover.
+static FILE *make_conversation(void) {
+  FILE *file = tmpfile();
+  if (file == NULL) {
+    return NULL;
+  }
+  uint32_t lcg = 1;
+  size_t frame_samples = BENCH_VAD_RATE * BENCH_VAD_FRAME_MS / 1000;
+  size_t frame = 0;
+  int hangover_frames = VAD_HANGOVER_MS / BENCH_VAD_FRAME_MS;
+  int since_speech = hangover_frames + 1;
+
+  for (int cycle = 0; cycle < BENCH_VAD_CYCLES; cycle++) {
+    for (int part = 0; part < 2; part++) {
+      bool speech = part == 1;
+      int frames = (speech ? BENCH_VAD_SPEECH_MS : BENCH_VAD_NOISE_MS) /
+                   BENCH_VAD_FRAME_MS;
+      for (int f = 0; f < frames; f++, frame++) {
+        since_speech = speech ? 0 : since_speech + 1;
+        truth[frame] = since_speech <= hangover_frames;
+        for (size_t i = 0; i < frame_samples; i++) {
+          lcg = lcg * 1664525 + 1013904223;
+          double noise = (int)(lcg >> 16) % (2 * BENCH_VAD_NOISE_AMPLITUDE) -
+                         BENCH_VAD_NOISE_AMPLITUDE;
+          double t = (double)(frame * frame_samples + i) / BENCH_VAD_RATE;
+          double voice = 0;
+          if (speech) {
+            voice = 5000 * (0.6 + 0.4 * sin(2 * M_PI * 4 * t)) *
+                    (sin(2 * M_PI * 150 * t) + 0.5 * sin(2 * M_PI * 900 * t));
+          }
+          int16_t sample = (int16_t)(noise + voice);
+          fwrite(&sample, sizeof(sample), 1, file);
+        }
+      }
+    }
+  }
+  rewind(file);
+  return file;
+}
+
+typedef struct {
+  vad_t vad;
+  size_t frame;
+  uint32_t correct_speech;
+  uint32_t speech_frames;
+  uint32_t correct_silence;
+  uint32_t silence_frames;
+  uint32_t sent_bytes;
+  bool scored;
+} bench_vad_run_t;
+
+static void vad_frame(const audio_frame_t *frame, void *user_data) {
+  bench_vad_run_t *run = (bench_vad_run_t *)user_data;
+  if (vad_process(&run->vad, frame->samples, frame->count,
+                  BENCH_VAD_FRAME_BYTES)) {
+    run->sent_bytes += BENCH_VAD_FRAME_BYTES;
+  }
+  if (run->scored) {
+    if (truth[run->frame]) {
+      run->speech_frames++;
+      run->correct_speech += run->vad.speech;
+    } else {
+      run->silence_frames++;
+      run->correct_silence += !run->vad.speech;
+    }
+  }
+  run->frame++;
+}
+
+// Streams `file` through capture and the VAD, as fast as the file reads.
+static void run_file(FILE *file, vad_silence_mode_t mode, bench_vad_run_t *run,
+                     bool scored) {
+  audio_sim_clock_t clock = {false, 0};
+  audio_sim_source_t source;
+  audio_input_device_t device;
+  audio_sim_source_init(&source, &clock, file, false, &device);
+
+  static audio_capture_t capture;
+  vad_init(&run->vad, mode, BENCH_VAD_FRAME_MS);
+  run->scored = scored;
+  audio_capture_open(&capture, &device, BENCH_VAD_RATE, BENCH_VAD_FRAME_MS,
+                     vad_frame, run);
+  while (audio_capture_step(&capture)) {
+  }
+}
+
+static void report_saving(const char *mode_name, bench_vad_run_t *run) {
+  char name[64];
+  uint32_t total = run->sent_bytes + run->vad.stats.bytes_saved;
+  snprintf(name, sizeof(name), "%s.bytes_saved", mode_name);
+  bench_report("vad", name, run->vad.stats.bytes_saved, "bytes");
+  snprintf(name, sizeof(name), "%s.saved_ratio", mode_name);
+  bench_report("vad", name,
+               total ? (double)run->vad.stats.bytes_saved / total : 0, "x");
+}
+
+void bench_vad(void) {
+  const struct {
+    vad_silence_mode_t mode;
+    const char *name;
+  } modes[] = {
+      {VAD_SILENCE_COMFORT, "comfort"},
+      {VAD_SILENCE_DROP, "drop"},
+  };
+
+  for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+    FILE *file = make_conversation();
+    if (file == NULL) {
+      bench_fail("vad", "tmpfile");
+      return;
+    }
+    bench_vad_run_t run = {};
+    int64_t start = bench_now_us();
+    run_file(file, modes[m].mode, &run, true);
+    int64_t elapsed = bench_now_us() - start;
+    fclose(file);
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s.speech_detected", modes[m].name);
+    bench_report("vad", name, (double)run.correct_speech / run.speech_frames,
+                 "x");
+    snprintf(name, sizeof(name), "%s.silence_detected", modes[m].name);
+    bench_report("vad", name, (double)run.correct_silence / run.silence_frames,
+                 "x");
+    snprintf(name, sizeof(name), "%s.pipeline_frame_time", modes[m].name);
+    bench_report("vad", name, run.frame ? (double)elapsed / run.frame : 0,
+                 "us");
+    report_saving(modes[m].name, &run);
+
+    if ((double)run.correct_speech / run.speech_frames <
+            BENCH_VAD_MIN_ACCURACY ||
+        (double)run.correct_silence / run.silence_frames <
+            BENCH_VAD_MIN_ACCURACY) {
+      bench_fail("vad", "speech/silence decisions below accuracy target");
+    }
+  }
+
+  // A real recording, raw 16-bit mono at 8kHz, has no truth table; report
+  // what the VAD would have saved on it.
+  const char *input = getenv("BENCH_VAD_INPUT");
+  if (input != NULL) {
+    FILE *file = fopen(input, "rb");
+    if (file == NULL) {
+      bench_fail("vad", "cannot open BENCH_VAD_INPUT");
+      return;
+    }
+    bench_vad_run_t run = {};
+    run_file(file, VAD_SILENCE_DROP, &run, false);
+    fclose(file);
+    bench_report("vad", "input.speech_frames", run.vad.stats.speech_frames,
+                 "frames");
+    bench_report("vad", "input.transitions", run.vad.stats.transitions,
+                 "transitions");
+    report_saving("input", &run);
+  }
+}
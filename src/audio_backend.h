@@ -0,0 +1,19 @@
+#ifndef OAI_AUDIO_BACKEND_H
+#define OAI_AUDIO_BACKEND_H
+
+#include "audio_device.h"
+
+// The devices the media pipeline runs on. Each target links exactly one
+// backend: audio_i2s.cpp on the board, audio_host.cpp on linux.
+
+// Board: DAC on I2S_NUM_1, woken by the driver's TX_DONE events.
+// Host: plays against a simulated clock and writes what it played to
+// OAI_AUDIO_OUTPUT, WAV if the name ends in .wav, raw PCM otherwise.
+void audio_backend_output_init(audio_output_device_t *device);
+
+// Board: microphone ADC on I2S_NUM_0. Reads block on the DMA, RX_Q_OVF events
+// count periods the driver dropped because the reader fell behind.
+// Host: loops OAI_AUDIO_INPUT (WAV or raw 16-bit mono PCM), silence if unset.
+void audio_backend_input_init(audio_input_device_t *device);
+
+#endif  // OAI_AUDIO_BACKEND_H
@@ -0,0 +1,117 @@
+#include "audio_capture.h"
+
+#include <esp_timer.h>
+#include <string.h>
+
+bool audio_capture_open(audio_capture_t *capture, audio_input_device_t *device,
+                        uint32_t sample_rate, uint32_t frame_ms,
+                        audio_capture_frame_fn on_frame, void *user_data) {
+  size_t frame_samples = sample_rate * frame_ms / 1000;
+  if (frame_samples == 0 || frame_samples > AUDIO_CAPTURE_MAX_FRAME) {
+    return false;
+  }
+
+  capture->device = device;
+  capture->frame_samples = frame_samples;
+  capture->frame_us = (int64_t)frame_ms * 1000;
+  capture->on_frame = on_frame;
+  capture->user_data = user_data;
+  capture->filled = 0;
+  // RFC 3550 wants a random initial timestamp; the boot clock is enough.
+  capture->rtp_timestamp = (uint32_t)esp_timer_get_time();
+  capture->dropped_seen = 0;
+  capture->last_frame_us = 0;
+  capture->running = false;
+  memset(&capture->stats, 0, sizeof(capture->stats));
+
+  // I2S DMA buffers hold at most 1024 frames, so a 40 or 60ms frame is
+  // gathered from 20ms periods; the buffering stays at a fixed number of
+  // frames either way.
+  uint32_t periods = (frame_ms + AUDIO_CAPTURE_MAX_PERIOD_MS - 1) /
+                     AUDIO_CAPTURE_MAX_PERIOD_MS;
+  capture->config.sample_rate = sample_rate;
+  capture->config.period_samples = frame_samples / periods;
+  capture->config.period_count = AUDIO_CAPTURE_DEVICE_PERIODS * periods;
+  return device->open(device, &capture->config);
+}
+
+bool audio_capture_set_frame(audio_capture_t *capture, uint32_t frame_ms) {
+  size_t frame_samples = capture->config.sample_rate * frame_ms / 1000;
+  if (frame_samples == 0 || frame_samples > AUDIO_CAPTURE_MAX_FRAME) {
+    return false;
+  }
+  capture->rtp_timestamp += capture->filled;
+  capture->filled = 0;
+  capture->frame_samples = frame_samples;
+  capture->frame_us = (int64_t)frame_ms * 1000;
+  capture->last_frame_us = 0;
+  return true;
+}
+
+static void emit_frame(audio_capture_t *capture) {
+  int64_t now = esp_timer_get_time();
+  if (capture->last_frame_us != 0) {
+    int64_t error = now - capture->last_frame_us - capture->frame_us;
+    if (error < 0) {
+      error = -error;
+    }
+    capture->stats.interval_error_total_us += error;
+    if (error > capture->stats.interval_error_max_us) {
+      capture->stats.interval_error_max_us = error;
+    }
+  }
+  capture->last_frame_us = now;
+
+  audio_frame_t frame = {capture->frame, capture->frame_samples,
+                         capture->rtp_timestamp, now};
+  capture->on_frame(&frame, capture->user_data);
+
+  capture->rtp_timestamp += capture->frame_samples;
+  capture->filled = 0;
+  capture->stats.frames++;
+}
+
+bool audio_capture_step(audio_capture_t *capture) {
+  audio_input_device_t *device = capture->device;
+  size_t wanted = capture->frame_samples - capture->filled;
+  size_t got = device->read(device, capture->frame + capture->filled, wanted,
+                            AUDIO_CAPTURE_WAIT_MS);
+
+  // Samples the device dropped still took time on the capture clock, so the
+  // RTP timestamp skips over them and the receiver sees a gap, not drift.
+  // The gap lies somewhere before the end of this read, so the frame being
+  // filled, this read included, no longer matches its timestamp: it is
+  // discarded and the next frame starts after the gap.
+  if (device->dropped != NULL) {
+    uint32_t dropped = device->dropped(device) - capture->dropped_seen;
+    if (dropped != 0) {
+      size_t partial = capture->filled + got;
+      capture->rtp_timestamp += partial + dropped;
+      capture->filled = 0;
+      capture->stats.dropped_samples += dropped;
+      capture->stats.discarded_samples += partial;
+      capture->dropped_seen += dropped;
+      return got == wanted;
+    }
+  }
+
+  if (got == 0) {
+    return false;
+  }
+  capture->filled += got;
+  if (capture->filled == capture->frame_samples) {
+    emit_frame(capture);
+  }
+  return got == wanted;
+}
+
+void audio_capture_run(audio_capture_t *capture) {
+  capture->running = true;
+  while (capture->running) {
+    audio_capture_step(capture);
+  }
+}
+
+void audio_capture_stop(audio_capture_t *capture) {
+  capture->running = false;
+}
@@ -0,0 +1,69 @@
+#ifndef OAI_AUDIO_CAPTURE_H
+#define OAI_AUDIO_CAPTURE_H
+
+#include <atomic>
+
+#include "audio_device.h"
+
+#define AUDIO_CAPTURE_WAIT_MS 100
+#define AUDIO_CAPTURE_MAX_FRAME 2880  // 60ms at 48kHz
+#define AUDIO_CAPTURE_MAX_PERIOD_MS 20  // Longer frames span several periods
+#define AUDIO_CAPTURE_DEVICE_PERIODS 4  // Frames of device buffering
+
+// One fixed-size frame of microphone audio.
+typedef struct {
+  const int16_t *samples;
+  size_t count;
+  uint32_t rtp_timestamp;  // Of samples[0] in sample_rate units
+  int64_t capture_us;      // When the last sample of the frame was read
+} audio_frame_t;
+
+typedef void (*audio_capture_frame_fn)(const audio_frame_t *frame,
+                                       void *user_data);
+
+typedef struct {
+  uint32_t frames;
+  uint32_t dropped_samples;      // Lost by the device before we read them
+  uint32_t discarded_samples;    // Read, but in a frame a drop cut through
+  int64_t interval_error_max_us;  // Worst deviation from the frame period
+  int64_t interval_error_total_us;
+} audio_capture_stats_t;
+
+// Cuts the device's sample stream into 10-60ms frames with RTP timestamps,
+// paced by the device's own blocking reads.
+typedef struct {
+  audio_input_device_t *device;
+  audio_buffer_config_t config;
+  size_t frame_samples;
+  int64_t frame_us;
+  audio_capture_frame_fn on_frame;
+  void *user_data;
+
+  int16_t frame[AUDIO_CAPTURE_MAX_FRAME];
+  size_t filled;
+  uint32_t rtp_timestamp;
+  uint32_t dropped_seen;
+  int64_t last_frame_us;
+
+  std::atomic<bool> running;
+  audio_capture_stats_t stats;
+} audio_capture_t;
+
+bool audio_capture_open(audio_capture_t *capture, audio_input_device_t *device,
+                        uint32_t sample_rate, uint32_t frame_ms,
+                        audio_capture_frame_fn on_frame, void *user_data);
+
+// Changes the frame length from the next frame on, keeping the device as it
+// was opened. A partly filled frame is dropped; its samples still advance
+// the timestamps.
+bool audio_capture_set_frame(audio_capture_t *capture, uint32_t frame_ms);
+
+// Reads once from the device and emits a frame if one completed. Returns
+// false if the device timed out or ran out of input.
+bool audio_capture_step(audio_capture_t *capture);
+
+// Loops on audio_capture_step until audio_capture_stop or end of input.
+void audio_capture_run(audio_capture_t *capture);
+void audio_capture_stop(audio_capture_t *capture);
+
+#endif  // OAI_AUDIO_CAPTURE_H
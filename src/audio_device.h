@@ -0,0 +1,59 @@
+#ifndef OAI_AUDIO_DEVICE_H
+#define OAI_AUDIO_DEVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Buffering profiles for audio devices. Low latency keeps ~30ms queued in the
+// device, robust keeps ~120ms to ride out scheduling hiccups.
+typedef enum {
+  AUDIO_PROFILE_LOW_LATENCY,
+  AUDIO_PROFILE_ROBUST,
+} audio_profile_t;
+
+typedef struct {
+  uint32_t sample_rate;
+  size_t period_samples;  // Samples per device buffer and completion event
+  size_t period_count;    // Device buffers queued at most
+} audio_buffer_config_t;
+
+void audio_profile_config(audio_profile_t profile, uint32_t sample_rate,
+                          audio_buffer_config_t *config);
+
+// A playback device consuming fixed-size periods. `wait_period` blocks until
+// the device has finished with a buffer, so callers are woken by the device
+// clock instead of polling.
+typedef struct audio_output_device {
+  const char *name;
+  bool (*open)(struct audio_output_device *device,
+               const audio_buffer_config_t *config);
+  // Returns true once at least one period can be written without blocking,
+  // false on timeout.
+  bool (*wait_period)(struct audio_output_device *device, uint32_t timeout_ms);
+  // Queues `count` samples, at most one period. Returns samples accepted.
+  size_t (*write)(struct audio_output_device *device, const int16_t *samples,
+                  size_t count);
+  // Drops everything queued in the device, e.g. on barge-in.
+  void (*flush)(struct audio_output_device *device);
+  void (*close)(struct audio_output_device *device);
+  // Number of times the device ran dry before the next period arrived.
+  uint32_t (*starved)(struct audio_output_device *device);
+  void *ctx;
+} audio_output_device_t;
+
+// A capture device. `read` blocks until the device clock has produced the
+// samples, which is what paces the uplink.
+typedef struct audio_input_device {
+  const char *name;
+  bool (*open)(struct audio_input_device *device,
+               const audio_buffer_config_t *config);
+  // Returns the samples read, fewer only on timeout or end of input.
+  size_t (*read)(struct audio_input_device *device, int16_t *samples,
+                 size_t count, uint32_t timeout_ms);
+  // Samples dropped so far because nobody read them in time.
+  uint32_t (*dropped)(struct audio_input_device *device);
+  void (*close)(struct audio_input_device *device);
+  void *ctx;
+} audio_input_device_t;
+
+#endif  // OAI_AUDIO_DEVICE_H
@@ -0,0 +1,289 @@
+#include "audio_device_sim.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <string.h>
+#include <unistd.h>
+
+#define WAV_HEADER_BYTES 44
+#define WAV_FORMAT_PCM 1
+#define WAV_SIZE_UNKNOWN 0xFFFFFFFF
+
+static const char *TAG = "audio_sim";
+
+int64_t audio_sim_clock_now(audio_sim_clock_t *clock) {
+  return clock->realtime ? esp_timer_get_time() : clock->now_us;
+}
+
+void audio_sim_clock_sleep_until(audio_sim_clock_t *clock, int64_t when_us) {
+  if (!clock->realtime) {
+    if (when_us > clock->now_us) {
+      clock->now_us = when_us;
+    }
+    return;
+  }
+  int64_t delay = when_us - esp_timer_get_time();
+  if (delay > 0) {
+    usleep((useconds_t)delay);
+  }
+}
+
+static void wav_put16(uint8_t *p, uint16_t value) {
+  p[0] = value & 0xff;
+  p[1] = value >> 8;
+}
+
+static void wav_put32(uint8_t *p, uint32_t value) {
+  wav_put16(p, value & 0xffff);
+  wav_put16(p + 2, value >> 16);
+}
+
+static uint16_t wav_get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+static uint32_t wav_get32(const uint8_t *p) {
+  return wav_get16(p) | ((uint32_t)wav_get16(p + 2) << 16);
+}
+
+// Canonical 44-byte header for 16-bit mono PCM. Streaming readers take
+// WAV_SIZE_UNKNOWN as "until end of file", so a run that is killed before
+// the sink closes still leaves a playable file.
+static void wav_write_header(FILE *file, uint32_t sample_rate,
+                             uint32_t data_bytes) {
+  uint8_t header[WAV_HEADER_BYTES];
+  memcpy(header, "RIFF", 4);
+  wav_put32(header + 4, data_bytes == WAV_SIZE_UNKNOWN
+                            ? WAV_SIZE_UNKNOWN
+                            : data_bytes + WAV_HEADER_BYTES - 8);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  wav_put32(header + 16, 16);
+  wav_put16(header + 20, WAV_FORMAT_PCM);
+  wav_put16(header + 22, 1);
+  wav_put32(header + 24, sample_rate);
+  wav_put32(header + 28, sample_rate * sizeof(int16_t));
+  wav_put16(header + 32, sizeof(int16_t));
+  wav_put16(header + 34, 16);
+  memcpy(header + 36, "data", 4);
+  wav_put32(header + 40, data_bytes);
+  fwrite(header, 1, sizeof(header), file);
+}
+
+// Leaves `file` at the first sample. Files without a RIFF header, and pipes,
+// which cannot be rewound after peeking, are taken as raw PCM.
+static bool wav_skip_header(FILE *file, uint32_t sample_rate, long *offset) {
+  uint8_t header[12];
+  *offset = 0;
+  if (ftell(file) < 0) {
+    return true;
+  }
+  rewind(file);
+  if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+      memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+    rewind(file);
+    return true;
+  }
+
+  bool format_ok = false;
+  uint8_t chunk[8];
+  while (fread(chunk, 1, sizeof(chunk), file) == sizeof(chunk)) {
+    uint32_t size = wav_get32(chunk + 4);
+    if (memcmp(chunk, "data", 4) == 0) {
+      *offset = ftell(file);
+      return format_ok;
+    }
+    if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+      uint8_t fmt[16];
+      if (fread(fmt, 1, sizeof(fmt), file) != sizeof(fmt)) {
+        break;
+      }
+      size -= sizeof(fmt);
+      if (wav_get16(fmt) != WAV_FORMAT_PCM || wav_get16(fmt + 2) != 1 ||
+          wav_get16(fmt + 14) != 16) {
+        ESP_LOGE(TAG, "WAV input must be 16-bit mono PCM");
+        return false;
+      }
+      if (wav_get32(fmt + 4) != sample_rate) {
+        ESP_LOGW(TAG, "WAV input is %lu Hz, playing it at %lu Hz",
+                 (unsigned long)wav_get32(fmt + 4),
+                 (unsigned long)sample_rate);
+      }
+      format_ok = true;
+    }
+    // Chunks are padded to an even size.
+    if (fseek(file, size + (size & 1), SEEK_CUR) != 0) {
+      break;
+    }
+  }
+  ESP_LOGE(TAG, "WAV input has no data chunk");
+  return false;
+}
+
+// Sample index the simulated DMA is playing at `now_us`.
+static uint64_t sink_position(audio_sim_sink_t *sink, int64_t now_us) {
+  return (uint64_t)(now_us - sink->start_us) * sink->config.sample_rate /
+         1000000;
+}
+
+static bool sim_open(audio_output_device_t *device,
+                     const audio_buffer_config_t *config) {
+  audio_sim_sink_t *sink = (audio_sim_sink_t *)device->ctx;
+  sink->config = *config;
+  sink->start_us = audio_sim_clock_now(sink->clock);
+  sink->queued_end = 0;
+  if (sink->file != NULL && sink->wav && sink->file_bytes == 0) {
+    wav_write_header(sink->file, config->sample_rate, WAV_SIZE_UNKNOWN);
+  }
+  return true;
+}
+
+static bool sim_wait_period(audio_output_device_t *device,
+                            uint32_t timeout_ms) {
+  audio_sim_sink_t *sink = (audio_sim_sink_t *)device->ctx;
+  size_t limit = sink->config.period_samples * (sink->config.period_count - 1);
+  int64_t now = audio_sim_clock_now(sink->clock);
+  if (sink->queued_end <= sink_position(sink, now) + limit) {
+    return true;
+  }
+
+  // Room opens up when the device has played down to `limit` queued samples,
+  // which is exactly when real hardware would raise its completion event.
+  uint64_t target = sink->queued_end - limit;
+  int64_t wake = sink->start_us +
+                 (int64_t)((target * 1000000 + sink->config.sample_rate - 1) /
+                           sink->config.sample_rate);
+  if (wake - now > (int64_t)timeout_ms * 1000) {
+    audio_sim_clock_sleep_until(sink->clock, now + (int64_t)timeout_ms * 1000);
+    return false;
+  }
+  audio_sim_clock_sleep_until(sink->clock, wake);
+
+  int64_t error = audio_sim_clock_now(sink->clock) - wake;
+  sink->wakeups++;
+  sink->wake_error_total_us += error;
+  if (error > sink->wake_error_max_us) {
+    sink->wake_error_max_us = error;
+  }
+  return true;
+}
+
+static size_t sim_write(audio_output_device_t *device, const int16_t *samples,
+                        size_t count) {
+  audio_sim_sink_t *sink = (audio_sim_sink_t *)device->ctx;
+  uint64_t position = sink_position(sink, audio_sim_clock_now(sink->clock));
+  if (sink->queued_end < position) {
+    if (sink->played > 0) {
+      sink->starved++;
+    }
+    sink->queued_end = position;
+  }
+  sink->queued_end += count;
+  sink->played += count;
+  if (sink->file != NULL) {
+    // Flushed per period so the recording survives the process being killed.
+    fwrite(samples, sizeof(int16_t), count, sink->file);
+    fflush(sink->file);
+    sink->file_bytes += count * sizeof(int16_t);
+  }
+  return count;
+}
+
+static void sim_flush(audio_output_device_t *device) {
+  audio_sim_sink_t *sink = (audio_sim_sink_t *)device->ctx;
+  sink->queued_end = sink_position(sink, audio_sim_clock_now(sink->clock));
+}
+
+static void sim_close(audio_output_device_t *device) {
+  audio_sim_sink_t *sink = (audio_sim_sink_t *)device->ctx;
+  if (sink->file != NULL && sink->wav) {
+    rewind(sink->file);
+    wav_write_header(sink->file, sink->config.sample_rate, sink->file_bytes);
+    fseek(sink->file, 0, SEEK_END);
+    fflush(sink->file);
+  }
+}
+
+static uint32_t sim_starved(audio_output_device_t *device) {
+  return ((audio_sim_sink_t *)device->ctx)->starved;
+}
+
+void audio_sim_sink_init(audio_sim_sink_t *sink, audio_sim_clock_t *clock,
+                         audio_output_device_t *device) {
+  memset(sink, 0, sizeof(*sink));
+  sink->clock = clock;
+
+  device->name = "sim-sink";
+  device->open = sim_open;
+  device->wait_period = sim_wait_period;
+  device->write = sim_write;
+  device->flush = sim_flush;
+  device->close = sim_close;
+  device->starved = sim_starved;
+  device->ctx = sink;
+}
+
+void audio_sim_sink_record(audio_sim_sink_t *sink, FILE *file, bool wav) {
+  sink->file = file;
+  sink->wav = wav;
+  sink->file_bytes = 0;
+}
+
+static bool source_open(audio_input_device_t *device,
+                        const audio_buffer_config_t *config) {
+  audio_sim_source_t *source = (audio_sim_source_t *)device->ctx;
+  source->config = *config;
+  source->start_us = audio_sim_clock_now(source->clock);
+  source->produced = 0;
+  return source->file != NULL &&
+         wav_skip_header(source->file, config->sample_rate,
+                         &source->data_offset);
+}
+
+static size_t source_read(audio_input_device_t *device, int16_t *samples,
+                          size_t count, uint32_t timeout_ms) {
+  audio_sim_source_t *source = (audio_sim_source_t *)device->ctx;
+
+  // The last requested sample exists once the clock has reached it.
+  uint64_t end = source->produced + count;
+  int64_t ready = source->start_us +
+                  (int64_t)(end * 1000000 / source->config.sample_rate);
+  int64_t now = audio_sim_clock_now(source->clock);
+  if (ready - now > (int64_t)timeout_ms * 1000) {
+    audio_sim_clock_sleep_until(source->clock, now + (int64_t)timeout_ms * 1000);
+    return 0;
+  }
+  audio_sim_clock_sleep_until(source->clock, ready);
+
+  size_t got = fread(samples, sizeof(int16_t), count, source->file);
+  while (got < count && source->loop) {
+    fseek(source->file, source->data_offset, SEEK_SET);
+    size_t more =
+        fread(samples + got, sizeof(int16_t), count - got, source->file);
+    if (more == 0) {
+      break;
+    }
+    got += more;
+  }
+  source->produced += got;
+  return got;
+}
+
+static uint32_t source_dropped(audio_input_device_t *device) {
+  return 0;
+}
+
+static void source_close(audio_input_device_t *device) {
+}
+
+void audio_sim_source_init(audio_sim_source_t *source, audio_sim_clock_t *clock,
+                           FILE *file, bool loop, audio_input_device_t *device) {
+  memset(source, 0, sizeof(*source));
+  source->clock = clock;
+  source->file = file;
+  source->loop = loop;
+
+  device->name = "sim-source";
+  device->open = source_open;
+  device->read = source_read;
+  device->dropped = source_dropped;
+  device->close = source_close;
+  device->ctx = source;
+}
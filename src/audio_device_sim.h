@@ -0,0 +1,60 @@
+#ifndef OAI_AUDIO_DEVICE_SIM_H
+#define OAI_AUDIO_DEVICE_SIM_H
+
+#include <stdio.h>
+
+#include "audio_device.h"
+
+// Clock driving simulated devices. In virtual mode waiting advances `now_us`
+// instantly, which makes timing tests deterministic and fast; in realtime
+// mode waits sleep on the wall clock.
+typedef struct {
+  bool realtime;
+  int64_t now_us;
+} audio_sim_clock_t;
+
+int64_t audio_sim_clock_now(audio_sim_clock_t *clock);
+void audio_sim_clock_sleep_until(audio_sim_clock_t *clock, int64_t when_us);
+
+// Output device that plays samples at exactly `sample_rate` against the clock,
+// like DMA would, and records when it went dry and how late wakeups were.
+typedef struct {
+  audio_sim_clock_t *clock;
+  audio_buffer_config_t config;
+  int64_t start_us;
+  uint64_t queued_end;  // Device sample index where queued audio ends
+  uint64_t played;      // Samples written in total
+  uint32_t starved;
+  uint32_t wakeups;
+  int64_t wake_error_total_us;
+  int64_t wake_error_max_us;
+  FILE *file;  // Receives every written sample, NULL to discard
+  bool wav;
+  uint32_t file_bytes;  // PCM bytes written to `file`
+} audio_sim_sink_t;
+
+void audio_sim_sink_init(audio_sim_sink_t *sink, audio_sim_clock_t *clock,
+                         audio_output_device_t *device);
+
+// Records everything written to the sink into `file`, as 16-bit mono PCM or
+// behind a WAV header whose sizes are filled in when the device closes.
+// Call before the device is opened.
+void audio_sim_sink_record(audio_sim_sink_t *sink, FILE *file, bool wav);
+
+// Input device reading 16-bit mono PCM from a file and handing it out no
+// faster than `sample_rate` against the clock, like a microphone would. The
+// file may be raw or WAV; a WAV header is skipped and checked on open.
+typedef struct {
+  audio_sim_clock_t *clock;
+  FILE *file;
+  bool loop;  // Rewind at end of file instead of ending the input
+  long data_offset;  // Where samples start, past any WAV header
+  audio_buffer_config_t config;
+  int64_t start_us;
+  uint64_t produced;  // Samples handed out in total
+} audio_sim_source_t;
+
+void audio_sim_source_init(audio_sim_source_t *source, audio_sim_clock_t *clock,
+                           FILE *file, bool loop, audio_input_device_t *device);
+
+#endif  // OAI_AUDIO_DEVICE_SIM_H
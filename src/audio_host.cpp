@@ -0,0 +1,109 @@
+#include <esp_log.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mutex>
+
+#include "audio_backend.h"
+#include "audio_device_sim.h"
+#include "main.h"
+
+// Silence, forever, when no input file is given.
+#define AUDIO_HOST_DEFAULT_INPUT "/dev/zero"
+// OAI_AUDIO_INPUT value that feeds playback back into the microphone.
+#define AUDIO_HOST_LOOPBACK "loopback"
+
+// Each direction keeps its own clock: in virtual time the capture and
+// playback loops run on different tasks and must not advance each other.
+static audio_sim_clock_t input_clock;
+static audio_sim_clock_t output_clock;
+static audio_sim_source_t source;
+static audio_sim_sink_t sink;
+
+// OAI_AUDIO_REALTIME=0 runs both devices on virtual time: capture hands out
+// audio as fast as the pipeline takes it and playback never sleeps, which
+// is what a profiler wants to see. Anything else paces them like hardware.
+static bool audio_host_realtime(void) {
+  const char *value = getenv("OAI_AUDIO_REALTIME");
+  return value == NULL || strcmp(value, "0") != 0;
+}
+
+// In loopback mode the sink records into a pipe the source reads from, like
+// a speaker right next to the microphone. Audio is picked up when the engine
+// writes it rather than when it would have left the speaker, so a round trip
+// measured through it leaves out the device queue. The two devices are
+// brought up from different tasks; whichever comes first makes the pipe.
+static FILE *loopback_ends[2];
+
+static bool audio_host_loopback(void) {
+  const char *input = getenv("OAI_AUDIO_INPUT");
+  if (input == NULL || strcmp(input, AUDIO_HOST_LOOPBACK) != 0) {
+    return false;
+  }
+  static std::once_flag created;
+  std::call_once(created, [] {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      ESP_LOGE(LOG_TAG, "Failed to create the audio loopback pipe");
+      return;
+    }
+    loopback_ends[0] = fdopen(fds[0], "rb");
+    loopback_ends[1] = fdopen(fds[1], "wb");
+  });
+  return true;
+}
+
+static bool ends_with(const char *s, const char *suffix) {
+  size_t len = strlen(s), suffix_len = strlen(suffix);
+  return len >= suffix_len && strcmp(s + len - suffix_len, suffix) == 0;
+}
+
+void audio_backend_output_init(audio_output_device_t *device) {
+  output_clock.realtime = audio_host_realtime();
+  output_clock.now_us = 0;
+  audio_sim_sink_init(&sink, &output_clock, device);
+  device->name = "host-output";
+
+  if (audio_host_loopback()) {
+    audio_sim_sink_record(&sink, loopback_ends[1], false);
+    ESP_LOGI(LOG_TAG, "Audio output looped back into the input");
+    return;
+  }
+  const char *path = getenv("OAI_AUDIO_OUTPUT");
+  if (path == NULL) {
+    return;
+  }
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    ESP_LOGE(LOG_TAG, "Failed to open %s, discarding audio output", path);
+    return;
+  }
+  audio_sim_sink_record(&sink, file, ends_with(path, ".wav"));
+  ESP_LOGI(LOG_TAG, "Recording audio output to %s", path);
+}
+
+void audio_backend_input_init(audio_input_device_t *device) {
+  input_clock.realtime = audio_host_realtime();
+  input_clock.now_us = 0;
+
+  if (audio_host_loopback()) {
+    audio_sim_source_init(&source, &input_clock, loopback_ends[0], false,
+                          device);
+    device->name = "host-loopback";
+    return;
+  }
+  const char *path = getenv("OAI_AUDIO_INPUT");
+  if (path == NULL) {
+    path = AUDIO_HOST_DEFAULT_INPUT;
+  }
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    // The device then fails to open, same as a missing microphone.
+    ESP_LOGE(LOG_TAG, "Failed to open audio input %s", path);
+  }
+  audio_sim_source_init(&source, &input_clock, file, true, device);
+  device->name = "host-input";
+  ESP_LOGI(LOG_TAG, "Audio input from %s (%s)", path,
+           input_clock.realtime ? "realtime" : "as fast as possible");
+}
@@ -0,0 +1,223 @@
+#include "audio_backend.h"
+
+#include <driver/i2s.h>
+#include <esp_log.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "main.h"
+
+#define MCLK_PIN 0
+#define ADC_BCLK_PIN 4
+#define ADC_LRCLK_PIN 5
+#define ADC_DATA_PIN 6
+#define I2S_INPUT_PORT I2S_NUM_0
+
+#define DAC_BCLK_PIN 15
+#define DAC_LRCLK_PIN 16
+#define DAC_DATA_PIN 7
+#define I2S_OUTPUT_PORT I2S_NUM_1
+
+typedef struct {
+  QueueHandle_t events;
+  audio_buffer_config_t config;
+  size_t free_periods;     // DMA buffers known to be free
+  size_t pending_samples;  // Written but not yet a whole period
+  uint32_t starved;
+} i2s_output_t;
+
+static i2s_output_t i2s_output;
+
+static bool i2s_output_open(audio_output_device_t *device,
+                            const audio_buffer_config_t *config) {
+  i2s_output_t *out = (i2s_output_t *)device->ctx;
+  out->config = *config;
+
+  i2s_config_t i2s_config_out = {
+      .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
+      .sample_rate = config->sample_rate,
+      .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+      .channel_format = I2S_CHANNEL_FMT_ONLY_RIGHT,
+      .communication_format = I2S_COMM_FORMAT_STAND_MSB,
+      .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+      .dma_buf_count = (int)config->period_count,
+      .dma_buf_len = (int)config->period_samples,
+      .use_apll = false,
+      .tx_desc_auto_clear = true,
+      .fixed_mclk = 0,
+  };
+  if (i2s_driver_install(I2S_OUTPUT_PORT, &i2s_config_out,
+                         (int)config->period_count * 2,
+                         &out->events) != ESP_OK) {
+    ESP_LOGE(LOG_TAG, "Failed to configure I2S driver for audio output");
+    return false;
+  }
+
+  i2s_pin_config_t pin_config_out = {
+      .bck_io_num = DAC_BCLK_PIN,
+      .ws_io_num = DAC_LRCLK_PIN,
+      .data_out_num = DAC_DATA_PIN,
+      .data_in_num = I2S_PIN_NO_CHANGE,
+  };
+  if (i2s_set_pin(I2S_OUTPUT_PORT, &pin_config_out) != ESP_OK) {
+    ESP_LOGE(LOG_TAG, "Failed to set I2S pins for audio output");
+    return false;
+  }
+  i2s_zero_dma_buffer(I2S_OUTPUT_PORT);
+
+  out->free_periods = config->period_count;
+  out->pending_samples = 0;
+  return true;
+}
+
+// Every TX_DONE event frees one DMA buffer. TX_Q_OVF means the driver had to
+// recycle a buffer nobody refilled, i.e. the DMA played out everything.
+static bool i2s_output_wait_period(audio_output_device_t *device,
+                                   uint32_t timeout_ms) {
+  i2s_output_t *out = (i2s_output_t *)device->ctx;
+  if (out->free_periods > 0) {
+    return true;
+  }
+
+  i2s_event_t event;
+  while (xQueueReceive(out->events, &event, pdMS_TO_TICKS(timeout_ms)) ==
+         pdTRUE) {
+    if (event.type == I2S_EVENT_TX_Q_OVF) {
+      out->starved++;
+      out->free_periods = out->config.period_count;
+      return true;
+    }
+    if (event.type == I2S_EVENT_TX_DONE) {
+      out->free_periods++;
+      return true;
+    }
+  }
+  return false;
+}
+
+static size_t i2s_output_write(audio_output_device_t *device,
+                               const int16_t *samples, size_t count) {
+  i2s_output_t *out = (i2s_output_t *)device->ctx;
+  size_t period_ms =
+      out->config.period_samples * 1000 / out->config.sample_rate;
+
+  size_t bytes_written = 0;
+  i2s_write(I2S_OUTPUT_PORT, samples, count * sizeof(int16_t), &bytes_written,
+            pdMS_TO_TICKS(period_ms));
+
+  out->pending_samples += bytes_written / sizeof(int16_t);
+  while (out->pending_samples >= out->config.period_samples &&
+         out->free_periods > 0) {
+    out->pending_samples -= out->config.period_samples;
+    out->free_periods--;
+  }
+  return bytes_written / sizeof(int16_t);
+}
+
+static void i2s_output_flush(audio_output_device_t *device) {
+  i2s_output_t *out = (i2s_output_t *)device->ctx;
+  i2s_zero_dma_buffer(I2S_OUTPUT_PORT);
+  xQueueReset(out->events);
+  out->free_periods = out->config.period_count;
+  out->pending_samples = 0;
+}
+
+static void i2s_output_close(audio_output_device_t *device) {
+  i2s_driver_uninstall(I2S_OUTPUT_PORT);
+}
+
+static uint32_t i2s_output_starved(audio_output_device_t *device) {
+  return ((i2s_output_t *)device->ctx)->starved;
+}
+
+void audio_backend_output_init(audio_output_device_t *device) {
+  memset(&i2s_output, 0, sizeof(i2s_output));
+  device->name = "i2s-dac";
+  device->open = i2s_output_open;
+  device->wait_period = i2s_output_wait_period;
+  device->write = i2s_output_write;
+  device->flush = i2s_output_flush;
+  device->close = i2s_output_close;
+  device->starved = i2s_output_starved;
+  device->ctx = &i2s_output;
+}
+
+typedef struct {
+  QueueHandle_t events;
+  audio_buffer_config_t config;
+  uint32_t dropped;
+} i2s_input_t;
+
+static i2s_input_t i2s_input;
+
+static bool i2s_input_open(audio_input_device_t *device,
+                           const audio_buffer_config_t *config) {
+  i2s_input_t *in = (i2s_input_t *)device->ctx;
+  in->config = *config;
+
+  i2s_config_t i2s_config_in = {
+      .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
+      .sample_rate = config->sample_rate,
+      .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+      .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+      .communication_format = I2S_COMM_FORMAT_I2S_MSB,
+      .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+      .dma_buf_count = (int)config->period_count,
+      .dma_buf_len = (int)config->period_samples,
+      .use_apll = 1,
+  };
+  if (i2s_driver_install(I2S_INPUT_PORT, &i2s_config_in,
+                         (int)config->period_count * 2,
+                         &in->events) != ESP_OK) {
+    ESP_LOGE(LOG_TAG, "Failed to configure I2S driver for audio input");
+    return false;
+  }
+
+  i2s_pin_config_t pin_config_in = {
+      .mck_io_num = MCLK_PIN,
+      .bck_io_num = ADC_BCLK_PIN,
+      .ws_io_num = ADC_LRCLK_PIN,
+      .data_out_num = I2S_PIN_NO_CHANGE,
+      .data_in_num = ADC_DATA_PIN,
+  };
+  if (i2s_set_pin(I2S_INPUT_PORT, &pin_config_in) != ESP_OK) {
+    ESP_LOGE(LOG_TAG, "Failed to set I2S pins for audio input");
+    return false;
+  }
+  return true;
+}
+
+static size_t i2s_input_read(audio_input_device_t *device, int16_t *samples,
+                             size_t count, uint32_t timeout_ms) {
+  i2s_input_t *in = (i2s_input_t *)device->ctx;
+  size_t bytes_read = 0;
+  i2s_read(I2S_INPUT_PORT, samples, count * sizeof(int16_t), &bytes_read,
+           pdMS_TO_TICKS(timeout_ms));
+
+  i2s_event_t event;
+  while (xQueueReceive(in->events, &event, 0) == pdTRUE) {
+    if (event.type == I2S_EVENT_RX_Q_OVF) {
+      in->dropped += in->config.period_samples;
+    }
+  }
+  return bytes_read / sizeof(int16_t);
+}
+
+static uint32_t i2s_input_dropped(audio_input_device_t *device) {
+  return ((i2s_input_t *)device->ctx)->dropped;
+}
+
+static void i2s_input_close(audio_input_device_t *device) {
+  i2s_driver_uninstall(I2S_INPUT_PORT);
+}
+
+void audio_backend_input_init(audio_input_device_t *device) {
+  memset(&i2s_input, 0, sizeof(i2s_input));
+  device->name = "i2s-adc";
+  device->open = i2s_input_open;
+  device->read = i2s_input_read;
+  device->dropped = i2s_input_dropped;
+  device->close = i2s_input_close;
+  device->ctx = &i2s_input;
+}
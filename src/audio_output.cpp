@@ -0,0 +1,180 @@
+#include "audio_output.h"
+
+#include <esp_timer.h>
+#include <string.h>
+
+static const int16_t kSilence[AUDIO_OUTPUT_MAX_PERIOD] = {0};
+
+void audio_profile_config(audio_profile_t profile, uint32_t sample_rate,
+                          audio_buffer_config_t *config) {
+  config->sample_rate = sample_rate;
+  switch (profile) {
+    case AUDIO_PROFILE_ROBUST:
+      config->period_samples = sample_rate / 50;  // 20ms
+      config->period_count = 6;
+      break;
+    case AUDIO_PROFILE_LOW_LATENCY:
+    default:
+      config->period_samples = sample_rate / 100;  // 10ms
+      config->period_count = 3;
+      break;
+  }
+}
+
+bool audio_output_open(audio_output_t *output, audio_output_device_t *device,
+                       pcm_ring_t *ring, audio_profile_t profile,
+                       uint32_t sample_rate, audio_output_refill_fn refill,
+                       void *user_data) {
+  output->device = device;
+  output->ring = ring;
+  output->refill = refill;
+  output->user_data = user_data;
+  output->active = false;
+  output->running = false;
+  output->periods = 0;
+  output->underruns = 0;
+  output->overruns = 0;
+  memset(output->period_audio, 0, sizeof(output->period_audio));
+  output->written_samples = 0;
+  output->played_samples = 0;
+  output->flush_pending = false;
+  output->flush_requested_us = 0;
+  output->flushes = 0;
+  output->flushed_samples = 0;
+  output->flush_latency_last_us = 0;
+  output->flush_latency_max_us = 0;
+
+  audio_profile_config(profile, sample_rate, &output->config);
+  if (output->config.period_samples > AUDIO_OUTPUT_MAX_PERIOD ||
+      output->config.period_count > AUDIO_OUTPUT_MAX_PERIODS) {
+    return false;
+  }
+  return device->open(device, &output->config);
+}
+
+// Writes `count` samples, waiting out partial writes from the device.
+static void write_all(audio_output_t *output, const int16_t *samples,
+                      size_t count) {
+  while (count > 0) {
+    size_t written = output->device->write(output->device, samples, count);
+    if (written == 0) {
+      return;
+    }
+    samples += written;
+    count -= written;
+  }
+}
+
+static size_t queued_audio(audio_output_t *output) {
+  size_t queued = 0;
+  for (size_t i = 0; i < output->config.period_count; i++) {
+    queued += output->period_audio[i];
+  }
+  return queued;
+}
+
+// Runs on the engine task, which owns the read side of the ring. The refill
+// callback writes on this task too, so draining the ring here cannot race it.
+static void handle_flush(audio_output_t *output) {
+  size_t dropped = pcm_ring_available(output->ring);
+  size_t count = dropped;
+  while (count > 0 && pcm_ring_acquire_read(output->ring, &count) != NULL) {
+    pcm_ring_commit_read(output->ring, count);
+    count = pcm_ring_available(output->ring);
+  }
+  output->device->flush(output->device);
+
+  dropped += queued_audio(output);
+  output->written_samples -= queued_audio(output);
+  memset(output->period_audio, 0, sizeof(output->period_audio));
+  output->played_samples = output->written_samples;
+  output->active = false;
+
+  int64_t latency = esp_timer_get_time() - output->flush_requested_us;
+  output->flush_latency_last_us = latency;
+  if (latency > output->flush_latency_max_us) {
+    output->flush_latency_max_us = latency;
+  }
+  output->flushed_samples += dropped;
+  output->flushes++;
+}
+
+void audio_output_step(audio_output_t *output) {
+  if (output->flush_pending.exchange(false)) {
+    handle_flush(output);
+  }
+
+  size_t period = output->config.period_samples;
+  if (output->refill != NULL) {
+    output->refill(period, output->user_data);
+  }
+
+  // The ring may wrap inside the period, so take it in up to two pieces.
+  size_t remaining = period;
+  for (int piece = 0; piece < 2 && remaining > 0; piece++) {
+    size_t count = remaining;
+    const int16_t *samples = pcm_ring_acquire_read(output->ring, &count);
+    if (samples == NULL) {
+      break;
+    }
+    write_all(output, samples, count);
+    pcm_ring_commit_read(output->ring, count);
+    remaining -= count;
+  }
+
+  // A short period mid-stream is an underrun; silence while idle is not.
+  bool had_audio = remaining < period;
+  if (remaining > 0 && (output->active || had_audio)) {
+    output->underruns++;
+  }
+  if (remaining > 0) {
+    write_all(output, kSilence, remaining);
+  }
+  output->active = had_audio;
+
+  size_t slot = output->periods % output->config.period_count;
+  output->period_audio[slot] = period - remaining;
+  output->written_samples += period - remaining;
+  output->played_samples = output->written_samples - queued_audio(output);
+  output->periods++;
+}
+
+void audio_output_run(audio_output_t *output) {
+  output->running = true;
+  while (output->running) {
+    if (output->device->wait_period(output->device, AUDIO_OUTPUT_WAIT_MS)) {
+      audio_output_step(output);
+    }
+  }
+}
+
+void audio_output_stop(audio_output_t *output) {
+  output->running = false;
+}
+
+void audio_output_flush(audio_output_t *output) {
+  output->flush_requested_us = esp_timer_get_time();
+  output->flush_pending = true;
+}
+
+uint32_t audio_output_played_samples(audio_output_t *output) {
+  return output->played_samples;
+}
+
+void audio_output_count_overrun(audio_output_t *output, size_t samples) {
+  output->overruns += samples;
+}
+
+void audio_output_get_stats(audio_output_t *output,
+                            audio_output_stats_t *stats) {
+  stats->periods = output->periods;
+  stats->underruns = output->underruns;
+  stats->overruns = output->overruns;
+  stats->starved = output->device->starved != NULL
+                       ? output->device->starved(output->device)
+                       : 0;
+  stats->flushes = output->flushes;
+  stats->flushed_samples = output->flushed_samples;
+  stats->flush_latency_last_us = output->flush_latency_last_us;
+  stats->flush_latency_max_us = output->flush_latency_max_us;
+}
@@ -0,0 +1,82 @@
+#ifndef OAI_AUDIO_OUTPUT_H
+#define OAI_AUDIO_OUTPUT_H
+
+#include <atomic>
+
+#include "audio_device.h"
+#include "pcm_ring.h"
+
+#define AUDIO_OUTPUT_WAIT_MS 100
+#define AUDIO_OUTPUT_MAX_PERIOD 960  // 20ms at 48kHz
+#define AUDIO_OUTPUT_MAX_PERIODS 8    // Device buffers tracked for played-out
+
+typedef struct {
+  uint32_t periods;    // Periods handed to the device
+  uint32_t underruns;  // Periods that needed audio the ring could not supply
+  uint32_t overruns;   // Samples dropped because the ring was full
+  uint32_t starved;    // Times the device itself ran dry
+  uint32_t flushes;
+  uint32_t flushed_samples;  // Queued audio dropped by flushes
+  int64_t flush_latency_last_us;  // Flush request to device silenced
+  int64_t flush_latency_max_us;
+} audio_output_stats_t;
+
+// Called before each period so the playout stage can top the ring up to at
+// least `samples`. May leave it short; the engine pads with silence.
+typedef void (*audio_output_refill_fn)(size_t samples, void *user_data);
+
+// Moves audio from a PCM ring to an output device one period at a time,
+// woken by the device's buffer-completion events.
+typedef struct {
+  audio_output_device_t *device;
+  pcm_ring_t *ring;
+  audio_output_refill_fn refill;
+  void *user_data;
+  audio_buffer_config_t config;
+
+  bool active;  // The previous period carried audio
+  // Audio samples in each of the last period_count periods, i.e. what is
+  // still queued in the device rather than played.
+  size_t period_audio[AUDIO_OUTPUT_MAX_PERIODS];
+  uint32_t written_samples;
+  std::atomic<uint32_t> played_samples;
+
+  std::atomic<bool> running;
+  std::atomic<bool> flush_pending;
+  std::atomic<int64_t> flush_requested_us;
+  std::atomic<uint32_t> periods;
+  std::atomic<uint32_t> underruns;
+  std::atomic<uint32_t> overruns;
+  std::atomic<uint32_t> flushes;
+  std::atomic<uint32_t> flushed_samples;
+  std::atomic<int64_t> flush_latency_last_us;
+  std::atomic<int64_t> flush_latency_max_us;
+} audio_output_t;
+
+bool audio_output_open(audio_output_t *output, audio_output_device_t *device,
+                       pcm_ring_t *ring, audio_profile_t profile,
+                       uint32_t sample_rate, audio_output_refill_fn refill,
+                       void *user_data);
+
+// Writes one period to the device. The device must have room for it.
+void audio_output_step(audio_output_t *output);
+
+// Loops on device completion events until audio_output_stop.
+void audio_output_run(audio_output_t *output);
+void audio_output_stop(audio_output_t *output);
+
+// Drops everything queued in the ring and the device, e.g. when the user
+// barges in. Safe from any task; the engine acts on it before its next
+// period, so sound stops within one period.
+void audio_output_flush(audio_output_t *output);
+
+// Ring audio (not padding silence) the device has played out so far.
+uint32_t audio_output_played_samples(audio_output_t *output);
+
+// Producers call this when the ring had no room for `samples`.
+void audio_output_count_overrun(audio_output_t *output, size_t samples);
+
+void audio_output_get_stats(audio_output_t *output,
+                            audio_output_stats_t *stats);
+
+#endif  // OAI_AUDIO_OUTPUT_H
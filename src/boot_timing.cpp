@@ -0,0 +1,45 @@
+#include "boot_timing.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include <atomic>
+
+#include "main.h"
+
+static std::atomic<int64_t> phase_us[BOOT_PHASE_COUNT];
+
+static const char *const phase_names[BOOT_PHASE_COUNT] = {
+    "app start",  "peer ready", "audio ready", "peer created",
+    "network ready", "offer sent", "answer",   "connected",
+    "first audio",
+};
+
+bool boot_mark(boot_phase_t phase) {
+  int64_t expected = 0;
+  return phase_us[phase].compare_exchange_strong(expected,
+                                                 esp_timer_get_time());
+}
+
+int64_t boot_phase_us(boot_phase_t phase) {
+  return phase_us[phase];
+}
+
+void boot_log(void) {
+  int64_t previous = 0;
+  for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    int64_t at = phase_us[i];
+    if (at == 0) {
+      continue;
+    }
+    // A phase that finished while another was still running shows +0.
+    int64_t delta = at > previous ? at - previous : 0;
+    ESP_LOGI(LOG_TAG, "boot: %-13s at %6lld ms (+%lld ms)", phase_names[i],
+             (long long)(at / 1000), (long long)(delta / 1000));
+    previous = at > previous ? at : previous;
+  }
+  if (phase_us[BOOT_PHASE_FIRST_AUDIO] != 0) {
+    ESP_LOGI(LOG_TAG, "boot: time-to-first-audio %lld ms",
+             (long long)(phase_us[BOOT_PHASE_FIRST_AUDIO] / 1000));
+  }
+}
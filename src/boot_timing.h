@@ -0,0 +1,32 @@
+#ifndef OAI_BOOT_TIMING_H
+#define OAI_BOOT_TIMING_H
+
+#include <stdint.h>
+
+// Startup milestones, in the order they are normally reached. Phases that
+// run in parallel may be marked out of order.
+typedef enum {
+  BOOT_PHASE_APP_START,
+  BOOT_PHASE_PEER_READY,     // peer_init done
+  BOOT_PHASE_AUDIO_READY,    // I2S, rings and codecs up
+  BOOT_PHASE_PEER_CREATED,   // First peer connection, DTLS identity included
+  BOOT_PHASE_NETWORK_READY,  // IP address assigned
+  BOOT_PHASE_OFFER_SENT,
+  BOOT_PHASE_ANSWER,
+  BOOT_PHASE_CONNECTED,
+  BOOT_PHASE_FIRST_AUDIO,  // First downlink audio packet
+  BOOT_PHASE_COUNT,
+} boot_phase_t;
+
+// Records the time since boot the first time a phase is reached; later
+// calls, e.g. from a reconnect, are ignored. Returns true on the first call.
+bool boot_mark(boot_phase_t phase);
+
+// Time since boot at which `phase` was reached, 0 if not yet.
+int64_t boot_phase_us(boot_phase_t phase);
+
+// Logs every phase reached so far with its time since boot and since the
+// previous phase.
+void boot_log(void);
+
+#endif  // OAI_BOOT_TIMING_H
@@ -0,0 +1,248 @@
+#include "dtls_identity.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <mbedtls/rsa.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef LINUX_BUILD
+#include "nvs.h"
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "main.h"
+
+#define DTLS_IDENTITY_MAGIC 0x31495444  // "DTI1"
+#define DTLS_IDENTITY_STATE_DIR "openai-realtime-embedded"
+#define DTLS_IDENTITY_FILE "dtls_identity.bin"
+#define DTLS_IDENTITY_NVS_NAMESPACE "dtls"
+#define DTLS_IDENTITY_NVS_KEY "identity"
+
+// Uses are stored ahead in batches of this many, so flash is not written on
+// every session. A restart counts the rest of a batch as used.
+#define DTLS_IDENTITY_USE_BATCH 10
+
+// N, P, Q, D and E, each big-endian at a fixed width for the key size.
+#define DTLS_IDENTITY_MAX_KEY \
+  (DTLS_IDENTITY_MAX_BITS / 8 * 2 + DTLS_IDENTITY_MAX_BITS / 16 * 2 + 4)
+
+typedef struct {
+  uint32_t magic;
+  uint32_t bits;
+  int32_t exponent;
+  uint32_t uses;  // Stored uses, up to a batch ahead of `uses` below
+  uint8_t key[DTLS_IDENTITY_MAX_KEY];
+} dtls_identity_blob_t;
+
+static dtls_identity_blob_t identity;
+static bool identity_loaded = false;
+static uint32_t uses = 0;
+
+static size_t blob_size(uint32_t bits) {
+  return offsetof(dtls_identity_blob_t, key) + bits / 8 * 2 + bits / 16 * 2 + 4;
+}
+
+#ifndef LINUX_BUILD
+// The blob holds the private key in the clear, so it only goes to NVS when
+// NVS is encrypted (opt-in, see sdkconfig.nvs_encryption).
+#ifdef CONFIG_NVS_ENCRYPTION
+static bool identity_read(void) {
+  nvs_handle_t handle;
+  if (nvs_open(DTLS_IDENTITY_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+    return false;
+  }
+  size_t size = sizeof(identity);
+  bool ok = nvs_get_blob(handle, DTLS_IDENTITY_NVS_KEY, &identity, &size) ==
+                ESP_OK &&
+            size >= offsetof(dtls_identity_blob_t, key) &&
+            identity.bits <= DTLS_IDENTITY_MAX_BITS &&
+            size == blob_size(identity.bits);
+  nvs_close(handle);
+  return ok;
+}
+
+static void identity_write(void) {
+  nvs_handle_t handle;
+  if (nvs_open(DTLS_IDENTITY_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+    ESP_LOGW(LOG_TAG, "DTLS identity not cached, NVS unavailable");
+    return;
+  }
+  if (nvs_set_blob(handle, DTLS_IDENTITY_NVS_KEY, &identity,
+                   blob_size(identity.bits)) != ESP_OK ||
+      nvs_commit(handle) != ESP_OK) {
+    ESP_LOGW(LOG_TAG, "Failed to store DTLS identity");
+  }
+  nvs_close(handle);
+}
+#else
+static bool identity_read(void) {
+  return false;
+}
+
+static void identity_write(void) {
+  ESP_LOGI(LOG_TAG, "DTLS identity not cached, NVS is not encrypted");
+}
+#endif
+#else
+// $XDG_STATE_HOME/openai-realtime-embedded, or the same under ~/.local/state,
+// private to the user. False if there is nowhere to keep it.
+static bool identity_path(char *path, size_t size) {
+  const char *state = getenv("XDG_STATE_HOME");
+  const char *home = getenv("HOME");
+  char dir[256];
+  int len;
+  if (state != NULL && state[0] == '/') {
+    mkdir(state, 0700);
+    len = snprintf(dir, sizeof(dir), "%s/" DTLS_IDENTITY_STATE_DIR, state);
+  } else if (home != NULL && home[0] == '/') {
+    snprintf(dir, sizeof(dir), "%s/.local", home);
+    mkdir(dir, 0700);
+    snprintf(dir, sizeof(dir), "%s/.local/state", home);
+    mkdir(dir, 0700);
+    len = snprintf(dir, sizeof(dir), "%s/.local/state/" DTLS_IDENTITY_STATE_DIR,
+                   home);
+  } else {
+    return false;
+  }
+  if (len < 0 || (size_t)len >= sizeof(dir) ||
+      (mkdir(dir, 0700) != 0 && errno != EEXIST)) {
+    return false;
+  }
+  len = snprintf(path, size, "%s/" DTLS_IDENTITY_FILE, dir);
+  return len > 0 && (size_t)len < size;
+}
+
+static bool identity_read(void) {
+  char path[512];
+  if (!identity_path(path, sizeof(path))) {
+    return false;
+  }
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return false;
+  }
+  size_t size = fread(&identity, 1, sizeof(identity), file);
+  fclose(file);
+  return size >= offsetof(dtls_identity_blob_t, key) &&
+         identity.bits <= DTLS_IDENTITY_MAX_BITS &&
+         size == blob_size(identity.bits);
+}
+
+// Written beside the old file and renamed over it, readable by the owner
+// only from the moment it exists.
+static void identity_write(void) {
+  char path[512];
+  char temp[520];
+  if (!identity_path(path, sizeof(path))) {
+    ESP_LOGW(LOG_TAG, "DTLS identity not cached, no state directory");
+    return;
+  }
+  snprintf(temp, sizeof(temp), "%s.tmp", path);
+  int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  size_t size = blob_size(identity.bits);
+  bool ok = fd >= 0 && fchmod(fd, 0600) == 0 &&
+            write(fd, &identity, size) == (ssize_t)size;
+  if (fd >= 0) {
+    ok = close(fd) == 0 && ok;
+  }
+  if (!ok || rename(temp, path) != 0) {
+    ESP_LOGW(LOG_TAG, "Failed to store DTLS identity in %s", path);
+    unlink(temp);
+  }
+}
+#endif
+
+// Stores the identity if `uses` ran past what is stored.
+static void identity_reserve(void) {
+  if (uses <= identity.uses) {
+    return;
+  }
+  identity.uses = uses + DTLS_IDENTITY_USE_BATCH - 1;
+  if (identity.uses > DTLS_IDENTITY_ROTATE_AFTER) {
+    identity.uses = DTLS_IDENTITY_ROTATE_AFTER;
+  }
+  identity_write();
+}
+
+// Field pointers into identity.key for a key of identity.bits.
+typedef struct {
+  uint8_t *n, *p, *q, *d, *e;
+  size_t n_len, half_len;
+} key_fields_t;
+
+static key_fields_t key_fields(void) {
+  key_fields_t fields;
+  fields.n_len = identity.bits / 8;
+  fields.half_len = identity.bits / 16;
+  fields.n = identity.key;
+  fields.p = fields.n + fields.n_len;
+  fields.q = fields.p + fields.half_len;
+  fields.d = fields.q + fields.half_len;
+  fields.e = fields.d + fields.n_len;
+  return fields;
+}
+
+static bool identity_import(mbedtls_rsa_context *ctx) {
+  key_fields_t f = key_fields();
+  return mbedtls_rsa_import_raw(ctx, f.n, f.n_len, f.p, f.half_len, f.q,
+                                f.half_len, f.d, f.n_len, f.e, 4) == 0 &&
+         mbedtls_rsa_complete(ctx) == 0 && mbedtls_rsa_check_privkey(ctx) == 0;
+}
+
+static bool identity_export(const mbedtls_rsa_context *ctx) {
+  key_fields_t f = key_fields();
+  return mbedtls_rsa_export_raw(ctx, f.n, f.n_len, f.p, f.half_len, f.q,
+                                f.half_len, f.d, f.n_len, f.e, 4) == 0;
+}
+
+extern "C" int __real_mbedtls_rsa_gen_key(
+    mbedtls_rsa_context *ctx, int (*f_rng)(void *, unsigned char *, size_t),
+    void *p_rng, unsigned int nbits, int exponent);
+
+extern "C" int __wrap_mbedtls_rsa_gen_key(
+    mbedtls_rsa_context *ctx, int (*f_rng)(void *, unsigned char *, size_t),
+    void *p_rng, unsigned int nbits, int exponent) {
+  int64_t start = esp_timer_get_time();
+  if (!identity_loaded) {
+    identity_loaded = identity_read() && identity.magic == DTLS_IDENTITY_MAGIC;
+    uses = identity.uses;
+  }
+
+  if (identity_loaded && identity.bits == nbits &&
+      identity.exponent == exponent && uses < DTLS_IDENTITY_ROTATE_AFTER &&
+      identity_import(ctx)) {
+    uses++;
+    identity_reserve();
+    ESP_LOGI(LOG_TAG, "DTLS key loaded from cache in %lld ms (use %lu/%d)",
+             (long long)((esp_timer_get_time() - start) / 1000),
+             (unsigned long)uses, DTLS_IDENTITY_ROTATE_AFTER);
+    return 0;
+  }
+
+  int ret = __real_mbedtls_rsa_gen_key(ctx, f_rng, p_rng, nbits, exponent);
+  ESP_LOGI(LOG_TAG, "DTLS key generated in %lld ms%s",
+           (long long)((esp_timer_get_time() - start) / 1000),
+           identity_loaded ? ", cached key rotated" : "");
+  if (ret != 0 || nbits > DTLS_IDENTITY_MAX_BITS) {
+    identity_loaded = false;
+    return ret;
+  }
+
+  identity.magic = DTLS_IDENTITY_MAGIC;
+  identity.bits = nbits;
+  identity.exponent = exponent;
+  identity.uses = 0;
+  uses = 1;
+  identity_loaded = identity_export(ctx);
+  if (identity_loaded) {
+    identity_reserve();
+  }
+  return ret;
+}
@@ -0,0 +1,18 @@
+#ifndef OAI_DTLS_IDENTITY_H
+#define OAI_DTLS_IDENTITY_H
+
+// libpeer generates a fresh RSA key for the DTLS certificate in every
+// peer_connection_create, which costs seconds of mbedTLS work on an ESP32.
+// mbedtls_rsa_gen_key is wrapped at link time (-Wl,--wrap) so the key is
+// generated once, stored and reloaded afterwards: in encrypted NVS on the
+// device, or a file only the user can read under $XDG_STATE_HOME on linux.
+// The certificate itself is still self-signed per session, which is cheap.
+
+// Sessions served by one key before a new one is generated.
+#ifndef DTLS_IDENTITY_ROTATE_AFTER
+#define DTLS_IDENTITY_ROTATE_AFTER 50
+#endif
+
+#define DTLS_IDENTITY_MAX_BITS 2048
+
+#endif  // OAI_DTLS_IDENTITY_H
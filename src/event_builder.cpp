@@ -0,0 +1,225 @@
+#include "event_builder.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define EVENT_RING_SLOTS (EVENT_QUEUE_SLOTS + 1)
+
+void event_queue_init(event_queue_t *queue, event_send_fn send,
+                      void *user_data) {
+  memset(queue, 0, sizeof(*queue));
+  queue->send = send;
+  queue->user_data = user_data;
+}
+
+static event_slot_t *slot_at(event_queue_t *queue, size_t index) {
+  return &queue->slots[(queue->head + index) % EVENT_RING_SLOTS];
+}
+
+// Serialization happens in place in the slot, so a builder is just a few
+// appends with no intermediate buffers.
+typedef struct {
+  event_slot_t *slot;
+  bool overflow;
+} event_writer_t;
+
+static void append(event_writer_t *writer, const char *format, ...) {
+  if (writer->overflow) {
+    return;
+  }
+  size_t room = EVENT_SLOT_SIZE - writer->slot->len;
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(writer->slot->data + writer->slot->len, room, format,
+                          args);
+  va_end(args);
+  if (written < 0 || (size_t)written >= room) {
+    writer->overflow = true;
+    return;
+  }
+  writer->slot->len += written;
+}
+
+static void append_raw(event_writer_t *writer, const char *data, size_t len) {
+  if (writer->overflow || writer->slot->len + len >= EVENT_SLOT_SIZE) {
+    writer->overflow = true;
+    return;
+  }
+  memcpy(writer->slot->data + writer->slot->len, data, len);
+  writer->slot->len += len;
+}
+
+// Copies runs of plain characters at once and escapes the rest.
+static void append_string(event_writer_t *writer, const char *text) {
+  append_raw(writer, "\"", 1);
+  const char *run = text;
+  for (const char *p = text; *p != '\0'; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c != '"' && c != '\\' && c >= 0x20) {
+      continue;
+    }
+    append_raw(writer, run, p - run);
+    if (c == '"' || c == '\\') {
+      char escaped[2] = {'\\', (char)c};
+      append_raw(writer, escaped, 2);
+    } else if (c == '\n') {
+      append_raw(writer, "\\n", 2);
+    } else {
+      append(writer, "\\u%04x", c);
+    }
+    run = p + 1;
+  }
+  append_raw(writer, run, strlen(run));
+  append_raw(writer, "\"", 1);
+}
+
+// The last queued event if it is of `kind` and unsent, the only one a new
+// event may replace without overtaking anything queued in between.
+static event_slot_t *unsent_tail(event_queue_t *queue, event_kind_t kind) {
+  if (queue->count == 0) {
+    return NULL;
+  }
+  event_slot_t *slot = slot_at(queue, queue->count - 1);
+  return slot->kind == kind ? slot : NULL;
+}
+
+// Builds into the spare slot past the tail; commit decides whether it fits.
+static void begin(event_queue_t *queue, event_kind_t kind,
+                  event_writer_t *writer) {
+  writer->slot = slot_at(queue, queue->count);
+  writer->slot->kind = kind;
+  writer->slot->len = 0;
+  writer->overflow = false;
+}
+
+static bool commit(event_queue_t *queue, event_writer_t *writer) {
+  if (writer->overflow || queue->count == EVENT_QUEUE_SLOTS) {
+    queue->stats.rejected++;
+    return false;
+  }
+  queue->count++;
+  queue->stats.queued++;
+  if (queue->count > queue->stats.depth_max) {
+    queue->stats.depth_max = queue->count;
+  }
+  return true;
+}
+
+size_t event_queue_flush(event_queue_t *queue) {
+  while (queue->count > 0) {
+    event_slot_t *slot = slot_at(queue, 0);
+    if (!queue->send(slot->data, slot->len, queue->user_data)) {
+      queue->stats.stalls++;
+      break;
+    }
+    queue->head = (queue->head + 1) % EVENT_RING_SLOTS;
+    queue->count--;
+    queue->stats.sent++;
+  }
+  return queue->count;
+}
+
+void event_queue_get_stats(const event_queue_t *queue,
+                           event_queue_stats_t *stats) {
+  *stats = queue->stats;
+  stats->depth = queue->count;
+}
+
+bool event_session_update(event_queue_t *queue,
+                          const event_session_config_t *config) {
+  event_writer_t writer;
+  begin(queue, EVENT_SESSION_UPDATE, &writer);
+  append(&writer, "{\"type\":\"session.update\",\"session\":{");
+  const char *separator = "";
+  if (config->instructions != NULL) {
+    append(&writer, "\"instructions\":");
+    append_string(&writer, config->instructions);
+    separator = ",";
+  }
+  if (config->voice != NULL) {
+    append(&writer, "%s\"voice\":", separator);
+    append_string(&writer, config->voice);
+    separator = ",";
+  }
+  if (config->vad_silence_ms > 0) {
+    append(&writer,
+           "%s\"turn_detection\":{\"type\":\"server_vad\","
+           "\"silence_duration_ms\":%d}",
+           separator, config->vad_silence_ms);
+  }
+  append(&writer, "}}");
+
+  // Replace an unsent update in place rather than sending both, even with
+  // the queue full. The new one was written to the spare slot, so copy it
+  // over the old.
+  event_slot_t *pending = unsent_tail(queue, EVENT_SESSION_UPDATE);
+  if (pending != NULL && !writer.overflow) {
+    memcpy(pending->data, writer.slot->data, writer.slot->len);
+    pending->len = writer.slot->len;
+    queue->stats.coalesced++;
+    return true;
+  }
+  return commit(queue, &writer);
+}
+
+bool event_item_create(event_queue_t *queue, const char *role,
+                       const char *text) {
+  event_writer_t writer;
+  begin(queue, EVENT_ITEM_CREATE, &writer);
+  append(&writer,
+         "{\"type\":\"conversation.item.create\",\"item\":{\"type\":"
+         "\"message\",\"role\":");
+  append_string(&writer, role);
+  append(&writer, ",\"content\":[{\"type\":\"input_text\",\"text\":");
+  append_string(&writer, text);
+  append(&writer, "}]}}");
+  return commit(queue, &writer);
+}
+
+bool event_item_truncate(event_queue_t *queue, const char *item_id,
+                         uint32_t audio_end_ms) {
+  event_writer_t writer;
+  begin(queue, EVENT_ITEM_TRUNCATE, &writer);
+  append(&writer, "{\"type\":\"conversation.item.truncate\",\"item_id\":");
+  append_string(&writer, item_id);
+  append(&writer, ",\"content_index\":0,\"audio_end_ms\":%lu}",
+         (unsigned long)audio_end_ms);
+  return commit(queue, &writer);
+}
+
+bool event_response_create(event_queue_t *queue, const char *instructions) {
+  event_writer_t writer;
+  begin(queue, EVENT_RESPONSE_CREATE, &writer);
+  append(&writer,
+         "{\"type\":\"response.create\",\"response\":{\"modalities\":"
+         "[\"audio\",\"text\"]");
+  if (instructions != NULL) {
+    append(&writer, ",\"instructions\":");
+    append_string(&writer, instructions);
+  }
+  append(&writer, "}}");
+  return commit(queue, &writer);
+}
+
+bool event_response_cancel(event_queue_t *queue) {
+  // A cancel right before this one covers it. One with a response.create
+  // queued after it does not, as that response still has to be cancelled.
+  if (unsent_tail(queue, EVENT_RESPONSE_CANCEL) != NULL) {
+    queue->stats.coalesced++;
+    return true;
+  }
+  event_writer_t writer;
+  begin(queue, EVENT_RESPONSE_CANCEL, &writer);
+  append(&writer, "{\"type\":\"response.cancel\"}");
+  return commit(queue, &writer);
+}
+
+bool event_latency_report(event_queue_t *queue, const char *report) {
+  event_writer_t writer;
+  begin(queue, EVENT_LATENCY_REPORT, &writer);
+  append(&writer, "{\"type\":\"oai.latency.report\",\"latency\":");
+  append_raw(&writer, report, strlen(report));
+  append_raw(&writer, "}", 1);
+  return commit(queue, &writer);
+}
@@ -0,0 +1,96 @@
+#ifndef OAI_EVENT_BUILDER_H
+#define OAI_EVENT_BUILDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EVENT_QUEUE_SLOTS 8
+#define EVENT_SLOT_SIZE 1024  // Largest serialized event
+
+typedef enum {
+  EVENT_SESSION_UPDATE,
+  EVENT_ITEM_CREATE,
+  EVENT_ITEM_TRUNCATE,
+  EVENT_RESPONSE_CREATE,
+  EVENT_RESPONSE_CANCEL,
+  EVENT_LATENCY_REPORT,
+} event_kind_t;
+
+typedef struct {
+  event_kind_t kind;
+  uint16_t len;
+  char data[EVENT_SLOT_SIZE];
+} event_slot_t;
+
+// Returns false when the transport cannot take the message right now; it is
+// retried on the next flush.
+typedef bool (*event_send_fn)(const char *data, size_t len, void *user_data);
+
+typedef struct {
+  uint32_t depth;      // Events waiting right now
+  uint32_t depth_max;  // Highest depth seen
+  uint32_t queued;
+  uint32_t sent;
+  uint32_t coalesced;  // Superseded or duplicate events folded into one
+  uint32_t rejected;   // Pool full, or the event did not fit a slot
+  uint32_t stalls;     // Flushes cut short by transport backpressure
+} event_queue_stats_t;
+
+// Outbound Realtime API events, serialized straight into a fixed pool of
+// slots and sent in order by event_queue_flush once per network loop tick.
+// An event is coalesced only with the one queued right before it, where the
+// API allows it: a newer session.update replaces an unsent one and repeated
+// response.cancel collapse. With anything in between both are sent, so
+// coalescing never changes the order the server sees. Each event stays its
+// own data channel message, as the API wants.
+// Not thread safe; use from the network task.
+typedef struct {
+  // One more than the queue holds, so an event can always be built before
+  // we know whether it coalesces.
+  event_slot_t slots[EVENT_QUEUE_SLOTS + 1];
+  size_t head;
+  size_t count;
+  event_send_fn send;
+  void *user_data;
+  event_queue_stats_t stats;
+} event_queue_t;
+
+void event_queue_init(event_queue_t *queue, event_send_fn send,
+                      void *user_data);
+
+// Sends queued events until the transport pushes back. Returns the number
+// still waiting.
+size_t event_queue_flush(event_queue_t *queue);
+
+void event_queue_get_stats(const event_queue_t *queue,
+                           event_queue_stats_t *stats);
+
+// Builders. NULL or 0 leaves a field out so the server keeps its value.
+// Each returns false if the event was rejected.
+
+typedef struct {
+  const char *instructions;
+  const char *voice;
+  int vad_silence_ms;  // server_vad silence_duration_ms
+} event_session_config_t;
+
+bool event_session_update(event_queue_t *queue,
+                          const event_session_config_t *config);
+
+// A text message from `role` ("user" or "system").
+bool event_item_create(event_queue_t *queue, const char *role,
+                       const char *text);
+
+bool event_item_truncate(event_queue_t *queue, const char *item_id,
+                         uint32_t audio_end_ms);
+
+// Asks for a spoken answer, optionally with per-response instructions.
+bool event_response_create(event_queue_t *queue, const char *instructions);
+
+bool event_response_cancel(event_queue_t *queue);
+
+// Answers a local oai.latency.get with `report`, a JSON object copied as is.
+// Not a Realtime API event; only a local peer asks for it.
+bool event_latency_report(event_queue_t *queue, const char *report);
+
+#endif  // OAI_EVENT_BUILDER_H
@@ -0,0 +1,58 @@
+#include "event_dispatch.h"
+
+#include <string.h>
+
+bool event_dispatcher_init(event_dispatcher_t *dispatcher,
+                           const event_dispatch_route_t *routes, size_t count,
+                           void *user_data) {
+  memset(dispatcher, 0, sizeof(*dispatcher));
+  dispatcher->routes = routes;
+  dispatcher->count = count;
+  dispatcher->user_data = user_data;
+  for (size_t i = 1; i < count; i++) {
+    if (strcmp(routes[i - 1].type, routes[i].type) >= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// strcmp of a length-delimited string against a terminated one.
+static int compare_type(const json_value_t *type, const char *name) {
+  int result = strncmp(type->ptr, name, type->len);
+  if (result != 0) {
+    return result;
+  }
+  return name[type->len] == '\0' ? 0 : -1;
+}
+
+bool event_dispatch(event_dispatcher_t *dispatcher, const char *json,
+                    size_t len) {
+  dispatcher->stats.bytes += len;
+
+  event_message_t event = {json, len, {}};
+  if (!json_get(json, len, "type", &event.type) ||
+      event.type.kind != JSON_STRING) {
+    dispatcher->stats.malformed++;
+    return false;
+  }
+
+  size_t low = 0;
+  size_t high = dispatcher->count;
+  while (low < high) {
+    size_t mid = (low + high) / 2;
+    int order = compare_type(&event.type, dispatcher->routes[mid].type);
+    if (order == 0) {
+      dispatcher->routes[mid].handler(&event, dispatcher->user_data);
+      dispatcher->stats.dispatched++;
+      return true;
+    }
+    if (order < 0) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  dispatcher->stats.unknown++;
+  return false;
+}
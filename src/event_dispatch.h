@@ -0,0 +1,47 @@
+#ifndef OAI_EVENT_DISPATCH_H
+#define OAI_EVENT_DISPATCH_H
+
+#include "json_scan.h"
+
+// One Realtime API event as received, with its `type` already located.
+typedef struct {
+  const char *json;
+  size_t len;
+  json_value_t type;
+} event_message_t;
+
+typedef void (*event_handler_fn)(const event_message_t *event,
+                                 void *user_data);
+
+typedef struct {
+  const char *type;
+  event_handler_fn handler;
+} event_dispatch_route_t;
+
+typedef struct {
+  uint32_t dispatched;
+  uint32_t unknown;    // Well-formed events nobody registered for
+  uint32_t malformed;  // Not a JSON object with a string `type`
+  uint32_t bytes;
+} event_dispatch_stats_t;
+
+// Routes events to handlers by `type` through a static table sorted by type,
+// found by binary search. `type` comes first in the API's events, so an event
+// nobody handles costs a few dozen bytes of scanning and one lookup.
+typedef struct {
+  const event_dispatch_route_t *routes;
+  size_t count;
+  void *user_data;
+  event_dispatch_stats_t stats;
+} event_dispatcher_t;
+
+// Returns false if `routes` is not sorted by type.
+bool event_dispatcher_init(event_dispatcher_t *dispatcher,
+                           const event_dispatch_route_t *routes, size_t count,
+                           void *user_data);
+
+// Returns true if a handler ran.
+bool event_dispatch(event_dispatcher_t *dispatcher, const char *json,
+                    size_t len);
+
+#endif  // OAI_EVENT_DISPATCH_H
@@ -0,0 +1,187 @@
+#include "g711.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define G711_SEGMENTS 8
+#define G711_MAGNITUDES 4096  // 13-bit linear input, sign removed
+
+// Upper bound of each A-law segment, in 13-bit linear units.
+static const int16_t kSegmentEnd[G711_SEGMENTS] = {
+    0x1f, 0x3f, 0x7f, 0xff, 0x1ff, 0x3ff, 0x7ff, 0xfff};
+
+// Segment and quantization bits for every magnitude, before the sign mask.
+static uint8_t encode_table[G711_MAGNITUDES];
+// Linear value for every A-law byte with the playback gain already applied.
+static int16_t decode_table[256];
+
+static int alaw_to_linear(uint8_t alaw) {
+  alaw ^= 0x55;
+  int value = (alaw & 0x0F) << 4;
+  int seg = (alaw & 0x70) >> 4;
+  if (seg == 0) {
+    value += 8;
+  } else {
+    value += 0x108;
+    value <<= seg - 1;
+  }
+  return (alaw & 0x80) ? value : -value;
+}
+
+void g711_alaw_set_decode_gain(int gain_q8) {
+  for (int i = 0; i < 256; i++) {
+    int value = (alaw_to_linear((uint8_t)i) * gain_q8 + 128) >> 8;
+    if (value > INT16_MAX) {
+      value = INT16_MAX;
+    } else if (value < INT16_MIN) {
+      value = INT16_MIN;
+    }
+    decode_table[i] = (int16_t)value;
+  }
+}
+
+void g711_init(void) {
+  for (int mag = 0; mag < G711_MAGNITUDES; mag++) {
+    int seg = 0;
+    while (mag > kSegmentEnd[seg]) {
+      seg++;
+    }
+    int quant = (mag >> (seg < 2 ? 1 : seg)) & 0x0F;
+    encode_table[mag] = (uint8_t)((seg << 4) | quant);
+  }
+  g711_alaw_set_decode_gain(G711_GAIN_UNITY);
+}
+
+// The sign of the 13-bit value picks the mask; for negative input `lin ^ sign`
+// is `-lin - 1`, the magnitude the segment table expects.
+static inline uint8_t encode_one(int16_t pcm) {
+  int lin = pcm >> 3;
+  int sign = lin >> 31;
+  return encode_table[lin ^ sign] ^ (uint8_t)(0xD5 ^ (sign & 0x80));
+}
+
+static void encode_table_kernel(const int16_t *pcm, uint8_t *alaw, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    alaw[i] = encode_one(pcm[i]);
+    alaw[i + 1] = encode_one(pcm[i + 1]);
+    alaw[i + 2] = encode_one(pcm[i + 2]);
+    alaw[i + 3] = encode_one(pcm[i + 3]);
+  }
+  for (; i < n; i++) {
+    alaw[i] = encode_one(pcm[i]);
+  }
+}
+
+// Decoding is a byte-indexed gather, which none of the SIMD units below can do
+// faster than the table, so every kernel shares this loop.
+static void decode_table_kernel(const uint8_t *alaw, int16_t *pcm, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    pcm[i] = decode_table[alaw[i]];
+    pcm[i + 1] = decode_table[alaw[i + 1]];
+    pcm[i + 2] = decode_table[alaw[i + 2]];
+    pcm[i + 3] = decode_table[alaw[i + 3]];
+  }
+  for (; i < n; i++) {
+    pcm[i] = decode_table[alaw[i]];
+  }
+}
+
+#if defined(__SSE2__)
+// SSE2 has no per-lane shift, so the segment is read from the exponent of the
+// magnitude converted to float, and the quantization bits come from scaling
+// that float by 2^-shift. Both steps are exact for 12-bit integers.
+static inline __m128i segment_quant4_sse2(__m128i mag) {
+  __m128 magf = _mm_cvtepi32_ps(mag);
+  __m128i seg = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(magf), 23),
+                              _mm_set1_epi32(127 + 4));
+  seg = _mm_andnot_si128(_mm_srai_epi32(seg, 31), seg);
+  __m128i shift = _mm_sub_epi32(seg, _mm_cmpeq_epi32(seg, _mm_setzero_si128()));
+  __m128 scale = _mm_castsi128_ps(
+      _mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(127), shift), 23));
+  __m128i quant = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(magf, scale)),
+                                _mm_set1_epi32(0x0F));
+  return _mm_or_si128(_mm_slli_epi32(seg, 4), quant);
+}
+
+static inline __m128i encode8_sse2(__m128i x) {
+  __m128i lin = _mm_srai_epi16(x, 3);
+  __m128i sign = _mm_srai_epi16(lin, 15);
+  __m128i mag = _mm_xor_si128(lin, sign);
+  __m128i mask = _mm_xor_si128(_mm_set1_epi16(0xD5),
+                               _mm_and_si128(sign, _mm_set1_epi16(0x80)));
+
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = segment_quant4_sse2(_mm_unpacklo_epi16(mag, zero));
+  __m128i hi = segment_quant4_sse2(_mm_unpackhi_epi16(mag, zero));
+  return _mm_xor_si128(_mm_packs_epi32(lo, hi), mask);
+}
+
+static void encode_sse2(const int16_t *pcm, uint8_t *alaw, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i lo = encode8_sse2(_mm_loadu_si128((const __m128i *)(pcm + i)));
+    __m128i hi = encode8_sse2(_mm_loadu_si128((const __m128i *)(pcm + i + 8)));
+    _mm_storeu_si128((__m128i *)(alaw + i), _mm_packus_epi16(lo, hi));
+  }
+  encode_table_kernel(pcm + i, alaw + i, n - i);
+}
+#elif defined(__ARM_NEON)
+static inline uint8x8_t encode8_neon(int16x8_t x) {
+  int16x8_t lin = vshrq_n_s16(x, 3);
+  int16x8_t sign = vshrq_n_s16(lin, 15);
+  uint16x8_t mag = vreinterpretq_u16_s16(veorq_s16(lin, sign));
+  uint16x8_t mask =
+      veorq_u16(vdupq_n_u16(0xD5),
+                vandq_u16(vreinterpretq_u16_s16(sign), vdupq_n_u16(0x80)));
+
+  uint16x8_t seg = vdupq_n_u16(0);
+  for (int k = 0; k < G711_SEGMENTS - 1; k++) {
+    seg = vsubq_u16(seg, vcgtq_u16(mag, vdupq_n_u16(kSegmentEnd[k])));
+  }
+  int16x8_t shift = vnegq_s16(
+      vreinterpretq_s16_u16(vmaxq_u16(seg, vdupq_n_u16(1))));
+  uint16x8_t quant = vandq_u16(vshlq_u16(mag, shift), vdupq_n_u16(0x0F));
+
+  uint16x8_t aval = vorrq_u16(vshlq_n_u16(seg, 4), quant);
+  return vmovn_u16(veorq_u16(aval, mask));
+}
+
+static void encode_neon(const int16_t *pcm, uint8_t *alaw, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x8_t lo = encode8_neon(vld1q_s16(pcm + i));
+    uint8x8_t hi = encode8_neon(vld1q_s16(pcm + i + 8));
+    vst1q_u8(alaw + i, vcombine_u8(lo, hi));
+  }
+  encode_table_kernel(pcm + i, alaw + i, n - i);
+}
+#endif
+
+// The ESP32-S3 PIE unit has no gather and no per-lane variable shift, so on
+// device the table kernel is the fastest option and is used directly.
+static const g711_kernel_t kKernels[] = {
+#if defined(__SSE2__)
+    {"sse2", encode_sse2, decode_table_kernel},
+#elif defined(__ARM_NEON)
+    {"neon", encode_neon, decode_table_kernel},
+#endif
+    {"table", encode_table_kernel, decode_table_kernel},
+};
+
+void g711_alaw_encode(const int16_t *pcm, uint8_t *alaw, size_t n) {
+  kKernels[0].encode(pcm, alaw, n);
+}
+
+void g711_alaw_decode(const uint8_t *alaw, int16_t *pcm, size_t n) {
+  kKernels[0].decode(alaw, pcm, n);
+}
+
+const g711_kernel_t *g711_kernels(size_t *count) {
+  *count = sizeof(kKernels) / sizeof(kKernels[0]);
+  return kKernels;
+}
@@ -0,0 +1,35 @@
+#ifndef OAI_G711_H
+#define OAI_G711_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Gains are Q8 fixed point: 256 is unity, 384 is 1.5x.
+#define G711_GAIN_UNITY 256
+
+typedef void (*g711_encode_fn)(const int16_t *pcm, uint8_t *alaw, size_t n);
+typedef void (*g711_decode_fn)(const uint8_t *alaw, int16_t *pcm, size_t n);
+
+// One implementation of the block encode/decode loops. Every kernel is
+// bit-exact with every other one; they only differ in speed.
+typedef struct {
+  const char *name;
+  g711_encode_fn encode;
+  g711_decode_fn decode;
+} g711_kernel_t;
+
+// Builds the lookup tables. Must run once before any encode/decode.
+void g711_init(void);
+
+// Rebuilds the decode table with `gain_q8` folded in, so applying gain costs
+// nothing per sample. Results saturate to the int16 range.
+void g711_alaw_set_decode_gain(int gain_q8);
+
+// Block A-law encode/decode using the fastest kernel for this target.
+void g711_alaw_encode(const int16_t *pcm, uint8_t *alaw, size_t n);
+void g711_alaw_decode(const uint8_t *alaw, int16_t *pcm, size_t n);
+
+// All kernels compiled into this build, fastest first. Used by the benchmark.
+const g711_kernel_t *g711_kernels(size_t *count);
+
+#endif  // OAI_G711_H
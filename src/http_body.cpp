@@ -0,0 +1,61 @@
+#include "http_body.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool http_body_init(http_body_t *body, size_t initial, size_t limit) {
+  body->data = (char *)malloc(initial + 1);
+  body->capacity = body->data != NULL ? initial : 0;
+  body->limit = limit;
+  http_body_reset(body);
+  return body->data != NULL;
+}
+
+void http_body_reset(http_body_t *body) {
+  body->len = 0;
+  body->overflow = false;
+  if (body->data != NULL) {
+    body->data[0] = '\0';
+  }
+}
+
+bool http_body_reserve(http_body_t *body, size_t len) {
+  if (len <= body->capacity) {
+    return true;
+  }
+  if (len > body->limit) {
+    return false;
+  }
+  size_t capacity = body->capacity > 0 ? body->capacity : 256;
+  while (capacity < len) {
+    capacity *= 2;
+  }
+  if (capacity > body->limit) {
+    capacity = body->limit;
+  }
+  char *data = (char *)realloc(body->data, capacity + 1);
+  if (data == NULL) {
+    return false;
+  }
+  body->data = data;
+  body->capacity = capacity;
+  return true;
+}
+
+bool http_body_append(http_body_t *body, const char *data, size_t len) {
+  if (body->overflow || !http_body_reserve(body, body->len + len)) {
+    body->overflow = true;
+    return false;
+  }
+  memcpy(body->data + body->len, data, len);
+  body->len += len;
+  body->data[body->len] = '\0';
+  return true;
+}
+
+void http_body_free(http_body_t *body) {
+  free(body->data);
+  body->data = NULL;
+  body->capacity = 0;
+  body->len = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef OAI_HTTP_BODY_H
+#define OAI_HTTP_BODY_H
+
+#include <stddef.h>
+
+// Accumulates a response body that arrives in pieces, e.g. chunked transfer
+// encoding or an SDP answer larger than one receive buffer. The buffer grows
+// by doubling up to `limit` and is kept NUL-terminated.
+typedef struct {
+  char *data;
+  size_t len;
+  size_t capacity;
+  size_t limit;   // Largest body accepted, excluding the terminator
+  bool overflow;  // Something was dropped because of `limit`
+} http_body_t;
+
+// Allocates `initial` bytes up front. Returns false if that fails.
+bool http_body_init(http_body_t *body, size_t initial, size_t limit);
+
+// Empties the body for the next response, keeping the allocation.
+void http_body_reset(http_body_t *body);
+
+// Grows the buffer ahead of time when the length is announced.
+bool http_body_reserve(http_body_t *body, size_t len);
+
+// Returns false, and sets `overflow`, if the piece does not fit.
+bool http_body_append(http_body_t *body, const char *data, size_t len);
+
+void http_body_free(http_body_t *body);
+
+#endif  // OAI_HTTP_BODY_H
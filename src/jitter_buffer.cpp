@@ -0,0 +1,190 @@
+#include "jitter_buffer.h"
+
+#include <string.h>
+
+#define JITTER_BUFFER_MASK (JITTER_BUFFER_SLOTS - 1)
+// Depth above target that is tolerated before frames are trimmed.
+#define JITTER_BUFFER_TRIM_SLACK 2
+// Target depth covers this many mean deviations of interarrival jitter.
+#define JITTER_BUFFER_JITTER_SPAN 3
+
+static int16_t seq_diff(uint16_t a, uint16_t b) {
+  return (int16_t)(a - b);
+}
+
+static bool slot_holds(const jitter_buffer_t *jb, uint16_t seq) {
+  const jitter_buffer_slot_t *slot = &jb->slots[seq & JITTER_BUFFER_MASK];
+  return slot->used && slot->seq == seq;
+}
+
+void jitter_buffer_init(jitter_buffer_t *jb, uint32_t clock_rate) {
+  memset(jb, 0, sizeof(*jb));
+  jb->clock_rate = clock_rate;
+  jb->frame_duration = clock_rate / 50;  // 20ms until packets tell otherwise
+  jb->target = JITTER_BUFFER_MIN_DEPTH;
+}
+
+void jitter_buffer_flush(jitter_buffer_t *jb) {
+  for (int i = 0; i < JITTER_BUFFER_SLOTS; i++) {
+    jb->slots[i].used = false;
+  }
+  jb->depth = 0;
+  jb->playing = false;
+  jb->positioned = false;
+}
+
+// Updates the RFC 3550 interarrival jitter and derives the target depth from
+// it, so a steady network keeps latency low and a bursty one buffers more.
+static void update_jitter(jitter_buffer_t *jb, uint16_t seq, uint32_t timestamp,
+                          int64_t arrival_us) {
+  int64_t arrival = arrival_us * jb->clock_rate / 1000000;
+  int64_t transit = arrival - (int64_t)timestamp;
+
+  if (jb->have_last) {
+    int64_t d = transit - jb->last_transit;
+    if (d < 0) {
+      d = -d;
+    }
+    // A talk spurt starting after silence is not jitter; cap its influence.
+    if (d > jb->clock_rate) {
+      d = jb->clock_rate;
+    }
+    jb->jitter_q4 += (uint32_t)d - ((jb->jitter_q4 + 8) >> 4);
+
+    uint32_t step = timestamp - jb->last_timestamp;
+    if (seq_diff(seq, jb->last_seq) == 1 && step > 0 &&
+        step <= jb->clock_rate / 10) {
+      jb->frame_duration = step;
+    }
+  }
+  jb->have_last = true;
+  jb->last_seq = seq;
+  jb->last_timestamp = timestamp;
+  jb->last_transit = transit;
+
+  uint32_t span = (jb->jitter_q4 >> 4) * JITTER_BUFFER_JITTER_SPAN;
+  int target = 1 + (int)((span + jb->frame_duration - 1) / jb->frame_duration);
+  if (target < JITTER_BUFFER_MIN_DEPTH) {
+    target = JITTER_BUFFER_MIN_DEPTH;
+  } else if (target > JITTER_BUFFER_MAX_DEPTH) {
+    target = JITTER_BUFFER_MAX_DEPTH;
+  }
+  jb->target = target;
+}
+
+bool jitter_buffer_put(jitter_buffer_t *jb, uint16_t seq, uint32_t timestamp,
+                       const uint8_t *payload, size_t size,
+                       int64_t arrival_us) {
+  if (size > JITTER_BUFFER_MAX_PAYLOAD) {
+    return false;
+  }
+
+  if (jb->positioned) {
+    int16_t ahead = seq_diff(seq, jb->next_seq);
+    if (ahead < 0) {
+      jb->stats.late++;
+      return false;
+    }
+    if (ahead >= JITTER_BUFFER_SLOTS) {
+      // The sender jumped far ahead, e.g. after a restart. Start over.
+      jitter_buffer_flush(jb);
+    }
+  }
+  if (!jb->positioned && (jb->depth == 0 || seq_diff(seq, jb->next_seq) < 0)) {
+    jb->next_seq = seq;
+  }
+
+  jitter_buffer_slot_t *slot = &jb->slots[seq & JITTER_BUFFER_MASK];
+  if (slot->used) {
+    if (slot->seq == seq) {
+      jb->stats.duplicate++;
+      return false;
+    }
+    // A stale frame from a full window ago; replace it.
+    jb->stats.trimmed++;
+    jb->depth--;
+  }
+
+  slot->seq = seq;
+  slot->timestamp = timestamp;
+  slot->size = (uint16_t)size;
+  slot->used = true;
+  slot->arrival_us = arrival_us;
+  memcpy(slot->payload, payload, size);
+  jb->depth++;
+  jb->stats.received++;
+
+  update_jitter(jb, seq, timestamp, arrival_us);
+  return true;
+}
+
+jitter_buffer_result_t jitter_buffer_get(jitter_buffer_t *jb, uint8_t *payload,
+                                         size_t *size) {
+  if (!jb->playing) {
+    if (jb->depth < jb->target) {
+      return JITTER_BUFFER_EMPTY;
+    }
+    // Resuming after an underrun: frames that never showed up while we were
+    // rebuffering are lost, skip straight to the oldest buffered one.
+    while (!slot_holds(jb, jb->next_seq)) {
+      jb->next_seq++;
+      if (jb->positioned) {
+        jb->stats.lost++;
+      }
+    }
+    jb->playing = true;
+    jb->positioned = true;
+  }
+
+  if (jb->depth == 0) {
+    jb->playing = false;
+    jb->stats.underruns++;
+    return JITTER_BUFFER_EMPTY;
+  }
+
+  // Latency crept above target, e.g. after a burst. Skip one frame per call
+  // until it is back within slack.
+  if (jb->depth > jb->target + JITTER_BUFFER_TRIM_SLACK) {
+    if (slot_holds(jb, jb->next_seq)) {
+      jb->slots[jb->next_seq & JITTER_BUFFER_MASK].used = false;
+      jb->depth--;
+      jb->stats.trimmed++;
+    } else {
+      jb->stats.lost++;
+    }
+    jb->next_seq++;
+  }
+
+  jitter_buffer_slot_t *slot = &jb->slots[jb->next_seq & JITTER_BUFFER_MASK];
+  if (!slot_holds(jb, jb->next_seq++)) {
+    jb->stats.lost++;
+    return JITTER_BUFFER_LOST;
+  }
+
+  memcpy(payload, slot->payload, slot->size);
+  *size = slot->size;
+  jb->last_arrival_us = slot->arrival_us;
+  slot->used = false;
+  jb->depth--;
+  return JITTER_BUFFER_FRAME;
+}
+
+bool jitter_buffer_peek(const jitter_buffer_t *jb, uint8_t *payload,
+                        size_t *size) {
+  if (!jb->playing || !slot_holds(jb, jb->next_seq)) {
+    return false;
+  }
+  const jitter_buffer_slot_t *slot =
+      &jb->slots[jb->next_seq & JITTER_BUFFER_MASK];
+  memcpy(payload, slot->payload, slot->size);
+  *size = slot->size;
+  return true;
+}
+
+void jitter_buffer_get_stats(const jitter_buffer_t *jb,
+                             jitter_buffer_stats_t *stats) {
+  *stats = jb->stats;
+  stats->depth = jb->depth;
+  stats->target = jb->target;
+  stats->jitter_ms = (jb->jitter_q4 >> 4) * 1000 / jb->clock_rate;
+}
@@ -0,0 +1,89 @@
+#ifndef OAI_JITTER_BUFFER_H
+#define OAI_JITTER_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JITTER_BUFFER_SLOTS 64  // Power of two
+#define JITTER_BUFFER_MAX_PAYLOAD 512
+#define JITTER_BUFFER_MIN_DEPTH 1   // frames
+#define JITTER_BUFFER_MAX_DEPTH 25  // frames, 500ms of 20ms packets
+
+// Downlink jitter buffer keyed on RTP sequence numbers. Stores encoded
+// payloads so the playout side can decode, conceal or run FEC itself.
+// Not thread safe; callers serialize put and get.
+
+typedef enum {
+  JITTER_BUFFER_FRAME,  // The next frame was copied out
+  JITTER_BUFFER_LOST,   // The next frame is missing and must be concealed
+  JITTER_BUFFER_EMPTY,  // Nothing to play yet, output silence
+} jitter_buffer_result_t;
+
+typedef struct {
+  uint16_t seq;
+  uint32_t timestamp;
+  uint16_t size;
+  bool used;
+  int64_t arrival_us;
+  uint8_t payload[JITTER_BUFFER_MAX_PAYLOAD];
+} jitter_buffer_slot_t;
+
+typedef struct {
+  int depth;   // Frames currently buffered
+  int target;  // Frames buffered before playout starts
+  uint32_t jitter_ms;
+  uint32_t received;
+  uint32_t lost;       // Frames concealed because they never arrived
+  uint32_t late;       // Frames that arrived after their playout time
+  uint32_t duplicate;  // Frames received twice
+  uint32_t trimmed;    // Frames dropped to bring latency back to target
+  uint32_t underruns;  // Times playout ran dry and had to rebuffer
+} jitter_buffer_stats_t;
+
+typedef struct {
+  jitter_buffer_slot_t slots[JITTER_BUFFER_SLOTS];
+  uint32_t clock_rate;
+  bool playing;
+  bool positioned;    // next_seq follows playout rather than arrivals
+  uint16_t next_seq;  // Next frame to play, or lowest seen while buffering
+  int depth;
+  int target;
+
+  // Interarrival jitter as in RFC 3550, in timestamp units scaled by 16.
+  bool have_last;
+  uint16_t last_seq;
+  uint32_t last_timestamp;
+  int64_t last_transit;
+  uint32_t jitter_q4;
+  uint32_t frame_duration;  // Timestamp units per frame
+  int64_t last_arrival_us;  // Arrival of the frame last returned by get
+
+  jitter_buffer_stats_t stats;
+} jitter_buffer_t;
+
+void jitter_buffer_init(jitter_buffer_t *jb, uint32_t clock_rate);
+
+// Drops every buffered frame and goes back to buffering. Counters survive.
+void jitter_buffer_flush(jitter_buffer_t *jb);
+
+// Returns false if the frame was dropped (late, duplicate or too large).
+// `arrival_us` is a monotonic clock, it only needs to be consistent.
+bool jitter_buffer_put(jitter_buffer_t *jb, uint16_t seq, uint32_t timestamp,
+                       const uint8_t *payload, size_t size, int64_t arrival_us);
+
+// Called once per frame period by the playout side. On JITTER_BUFFER_FRAME
+// the payload is copied to `payload` (JITTER_BUFFER_MAX_PAYLOAD bytes) and
+// its length stored in `size`.
+jitter_buffer_result_t jitter_buffer_get(jitter_buffer_t *jb, uint8_t *payload,
+                                         size_t *size);
+
+// Copies the frame that will be played next without consuming it. Used after
+// JITTER_BUFFER_LOST to recover the lost frame from in-band FEC. Returns false
+// if that frame has not arrived either.
+bool jitter_buffer_peek(const jitter_buffer_t *jb, uint8_t *payload,
+                        size_t *size);
+
+void jitter_buffer_get_stats(const jitter_buffer_t *jb,
+                             jitter_buffer_stats_t *stats);
+
+#endif  // OAI_JITTER_BUFFER_H
@@ -0,0 +1,191 @@
+#include "json_scan.h"
+
+#include <string.h>
+
+static const char *skip_space(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+    p++;
+  }
+  return p;
+}
+
+// Returns the closing quote of the string starting after `p`'s opening quote.
+static const char *string_end(const char *p, const char *end) {
+  while (p < end) {
+    if (*p == '\\') {
+      p += 2;
+      continue;
+    }
+    if (*p == '"') {
+      return p;
+    }
+    p++;
+  }
+  return NULL;
+}
+
+// Parses the value at `p` and returns the first byte after it.
+static const char *scan_value(const char *p, const char *end,
+                              json_value_t *value) {
+  if (p >= end) {
+    return NULL;
+  }
+  const char *start = p;
+  switch (*p) {
+    case '"': {
+      const char *close = string_end(p + 1, end);
+      if (close == NULL) {
+        return NULL;
+      }
+      value->ptr = p + 1;
+      value->len = close - (p + 1);
+      value->kind = JSON_STRING;
+      return close + 1;
+    }
+    case '{':
+    case '[': {
+      int depth = 0;
+      while (p < end) {
+        char c = *p;
+        if (c == '"') {
+          p = string_end(p + 1, end);
+          if (p == NULL) {
+            return NULL;
+          }
+        } else if (c == '{' || c == '[') {
+          depth++;
+        } else if (c == '}' || c == ']') {
+          if (--depth == 0) {
+            value->ptr = start;
+            value->len = p + 1 - start;
+            value->kind = *start == '{' ? JSON_OBJECT : JSON_ARRAY;
+            return p + 1;
+          }
+        }
+        p++;
+      }
+      return NULL;
+    }
+    default: {
+      while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' &&
+             *p != '\t' && *p != '\n' && *p != '\r') {
+        p++;
+      }
+      if (p == start) {
+        return NULL;
+      }
+      value->ptr = start;
+      value->len = p - start;
+      value->kind = (*start == '-' || (*start >= '0' && *start <= '9'))
+                        ? JSON_NUMBER
+                        : JSON_LITERAL;
+      return p;
+    }
+  }
+}
+
+static bool key_equals(const char *key, size_t key_len, const char *wanted) {
+  return strncmp(key, wanted, key_len) == 0 && wanted[key_len] == '\0';
+}
+
+int json_get_members(const char *json, size_t len, const char *const *keys,
+                     json_value_t *values, size_t count) {
+  const char *p = json;
+  const char *end = json + len;
+  p = skip_space(p, end);
+  if (p >= end || *p != '{') {
+    return -1;
+  }
+  p = skip_space(p + 1, end);
+
+  size_t found = 0;
+  uint32_t found_mask = 0;
+  if (p < end && *p == '}') {
+    return 0;
+  }
+  while (p < end) {
+    if (*p != '"') {
+      return -1;
+    }
+    const char *key = p + 1;
+    const char *key_close = string_end(key, end);
+    if (key_close == NULL) {
+      return -1;
+    }
+    p = skip_space(key_close + 1, end);
+    if (p >= end || *p != ':') {
+      return -1;
+    }
+    p = skip_space(p + 1, end);
+
+    json_value_t value;
+    p = scan_value(p, end, &value);
+    if (p == NULL) {
+      return -1;
+    }
+    for (size_t i = 0; i < count && i < 32; i++) {
+      if (!(found_mask & (1u << i)) &&
+          key_equals(key, key_close - key, keys[i])) {
+        values[i] = value;
+        found_mask |= 1u << i;
+        if (++found == count) {
+          return (int)found;
+        }
+        break;
+      }
+    }
+
+    p = skip_space(p, end);
+    if (p < end && *p == ',') {
+      p = skip_space(p + 1, end);
+      continue;
+    }
+    if (p < end && *p == '}') {
+      return (int)found;
+    }
+    return -1;
+  }
+  return -1;
+}
+
+bool json_get(const char *json, size_t len, const char *key,
+              json_value_t *value) {
+  return json_get_members(json, len, &key, value, 1) == 1;
+}
+
+bool json_value_get(const json_value_t *object, const char *key,
+                    json_value_t *value) {
+  return object->kind == JSON_OBJECT &&
+         json_get(object->ptr, object->len, key, value);
+}
+
+bool json_value_equals(const json_value_t *value, const char *str) {
+  return value->kind == JSON_STRING && key_equals(value->ptr, value->len, str);
+}
+
+bool json_value_copy(const json_value_t *value, char *out, size_t size) {
+  if (value->len >= size) {
+    return false;
+  }
+  memcpy(out, value->ptr, value->len);
+  out[value->len] = '\0';
+  return true;
+}
+
+bool json_value_to_int(const json_value_t *value, int64_t *out) {
+  if (value->kind != JSON_NUMBER) {
+    return false;
+  }
+  const char *p = value->ptr;
+  const char *end = p + value->len;
+  bool negative = *p == '-';
+  if (negative) {
+    p++;
+  }
+  int64_t result = 0;
+  for (; p < end && *p >= '0' && *p <= '9'; p++) {
+    result = result * 10 + (*p - '0');
+  }
+  *out = negative ? -result : result;
+  return true;
+}
@@ -0,0 +1,46 @@
+#ifndef OAI_JSON_SCAN_H
+#define OAI_JSON_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// In-place JSON member lookup. Nothing is copied or allocated: values point
+// into the caller's buffer. Members not asked for are skipped by matching
+// brackets and quotes only, so large nested payloads cost a byte scan.
+
+typedef enum {
+  JSON_STRING,  // ptr/len exclude the quotes, escapes are left as is
+  JSON_NUMBER,
+  JSON_OBJECT,  // ptr/len cover the braces, pass to json_get again
+  JSON_ARRAY,
+  JSON_LITERAL,  // true, false or null
+} json_kind_t;
+
+typedef struct {
+  const char *ptr;
+  size_t len;
+  json_kind_t kind;
+} json_value_t;
+
+// Looks up `count` top-level members of the object in `json` in one pass and
+// stops as soon as all were found. Returns how many were found, or -1 if the
+// text is not a well-formed object up to that point.
+int json_get_members(const char *json, size_t len, const char *const *keys,
+                     json_value_t *values, size_t count);
+
+// Single-member shorthand.
+bool json_get(const char *json, size_t len, const char *key,
+              json_value_t *value);
+
+// Same on a nested object value.
+bool json_value_get(const json_value_t *object, const char *key,
+                    json_value_t *value);
+
+bool json_value_equals(const json_value_t *value, const char *str);
+
+// Copies a string value and terminates it. False if it does not fit.
+bool json_value_copy(const json_value_t *value, char *out, size_t size);
+
+bool json_value_to_int(const json_value_t *value, int64_t *out);
+
+#endif  // OAI_JSON_SCAN_H
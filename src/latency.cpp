@@ -0,0 +1,116 @@
+#include "latency.h"
+
+#include <stdio.h>
+
+static int bucket_index(int64_t us) {
+  if (us < LATENCY_SUB_BUCKETS) {
+    return us < 0 ? 0 : (int)us;
+  }
+  int msb = 63 - __builtin_clzll((uint64_t)us);
+  int sub = (int)(us >> (msb - 2)) & (LATENCY_SUB_BUCKETS - 1);
+  int index = (msb - 1) * LATENCY_SUB_BUCKETS + sub;
+  return index < LATENCY_BUCKETS ? index : LATENCY_BUCKETS - 1;
+}
+
+// Largest value that still falls into `index`.
+static int64_t bucket_upper(int index) {
+  if (index < LATENCY_SUB_BUCKETS) {
+    return index;
+  }
+  int msb = index / LATENCY_SUB_BUCKETS + 1;
+  int sub = index % LATENCY_SUB_BUCKETS;
+  return ((int64_t)(LATENCY_SUB_BUCKETS + sub + 1) << (msb - 2)) - 1;
+}
+
+void latency_histogram_reset(latency_histogram_t *histogram) {
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    histogram->buckets[i].store(0, std::memory_order_relaxed);
+  }
+  histogram->count.store(0, std::memory_order_relaxed);
+  histogram->max_us.store(0, std::memory_order_relaxed);
+}
+
+void latency_histogram_record(latency_histogram_t *histogram, int64_t us) {
+  histogram->buckets[bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+  histogram->count.fetch_add(1, std::memory_order_relaxed);
+  if (us > histogram->max_us.load(std::memory_order_relaxed)) {
+    histogram->max_us.store(us, std::memory_order_relaxed);
+  }
+}
+
+void latency_histogram_merge(latency_histogram_t *into,
+                             const latency_histogram_t *from) {
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    into->buckets[i].fetch_add(
+        from->buckets[i].load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  }
+  into->count.fetch_add(from->count.load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+  int64_t max = from->max_us.load(std::memory_order_relaxed);
+  if (max > into->max_us.load(std::memory_order_relaxed)) {
+    into->max_us.store(max, std::memory_order_relaxed);
+  }
+}
+
+int64_t latency_histogram_percentile(const latency_histogram_t *histogram,
+                                     uint32_t percent) {
+  uint32_t count = histogram->count.load(std::memory_order_relaxed);
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t rank = ((uint64_t)count * percent + 99) / 100;
+  uint64_t seen = 0;
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += histogram->buckets[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      int64_t upper = bucket_upper(i);
+      int64_t max = histogram->max_us.load(std::memory_order_relaxed);
+      return upper < max ? upper : max;
+    }
+  }
+  return histogram->max_us.load(std::memory_order_relaxed);
+}
+
+void latency_gauge_reset(latency_gauge_t *gauge) {
+  gauge->value.store(0, std::memory_order_relaxed);
+  gauge->max.store(0, std::memory_order_relaxed);
+}
+
+void latency_gauge_set(latency_gauge_t *gauge, int32_t value) {
+  gauge->value.store(value, std::memory_order_relaxed);
+  if (value > gauge->max.load(std::memory_order_relaxed)) {
+    gauge->max.store(value, std::memory_order_relaxed);
+  }
+}
+
+static size_t append(char *out, size_t size, int len) {
+  if (len < 0 || (size_t)len >= size) {
+    if (size > 0) {
+      out[0] = '\0';
+    }
+    return 0;
+  }
+  return (size_t)len;
+}
+
+size_t latency_histogram_format(const latency_histogram_t *histogram,
+                                const char *name, char *out, size_t size) {
+  return append(
+      out, size,
+      snprintf(out, size,
+               "\"%s\":{\"n\":%lu,\"p50\":%lld,\"p95\":%lld,\"p99\":%lld,"
+               "\"max\":%lld}",
+               name, (unsigned long)histogram->count.load(),
+               (long long)latency_histogram_percentile(histogram, 50),
+               (long long)latency_histogram_percentile(histogram, 95),
+               (long long)latency_histogram_percentile(histogram, 99),
+               (long long)histogram->max_us.load()));
+}
+
+size_t latency_gauge_format(const latency_gauge_t *gauge, const char *name,
+                            char *out, size_t size) {
+  return append(out, size,
+                snprintf(out, size, "\"%s\":{\"now\":%ld,\"max\":%ld}", name,
+                         (long)gauge->value.load(), (long)gauge->max.load()));
+}
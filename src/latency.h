@@ -0,0 +1,52 @@
+#ifndef OAI_LATENCY_H
+#define OAI_LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// Fixed-memory latency histograms and queue-depth gauges. One task records,
+// any task may read: counters are relaxed atomics, so a report taken while
+// samples land can be off by the samples in flight, never torn.
+
+// Four buckets per power of two from 1us up to ~16s, so percentiles are
+// within ~19% of the true value.
+#define LATENCY_SUB_BUCKETS 4
+#define LATENCY_BUCKETS (24 * LATENCY_SUB_BUCKETS)
+
+typedef struct {
+  std::atomic<uint32_t> buckets[LATENCY_BUCKETS];
+  std::atomic<uint32_t> count;
+  std::atomic<int64_t> max_us;
+} latency_histogram_t;
+
+typedef struct {
+  std::atomic<int32_t> value;  // Last sample
+  std::atomic<int32_t> max;    // Highest since the last reset
+} latency_gauge_t;
+
+void latency_histogram_reset(latency_histogram_t *histogram);
+void latency_histogram_record(latency_histogram_t *histogram, int64_t us);
+
+// Adds the samples of `from` to `into`, e.g. per-session histograms into one
+// for the whole run. `from` may still be recording.
+void latency_histogram_merge(latency_histogram_t *into,
+                             const latency_histogram_t *from);
+
+// Upper edge of the bucket holding the `percent` percentile, 0 if empty.
+int64_t latency_histogram_percentile(const latency_histogram_t *histogram,
+                                     uint32_t percent);
+
+void latency_gauge_reset(latency_gauge_t *gauge);
+void latency_gauge_set(latency_gauge_t *gauge, int32_t value);
+
+// Append `"name":{...}` to `out`, which holds `size` bytes and is kept
+// NUL-terminated. Return the length written, 0 if it did not fit.
+// Histograms report n, p50, p95, p99 and max in microseconds.
+size_t latency_histogram_format(const latency_histogram_t *histogram,
+                                const char *name, char *out, size_t size);
+size_t latency_gauge_format(const latency_gauge_t *gauge, const char *name,
+                            char *out, size_t size);
+
+#endif  // OAI_LATENCY_H
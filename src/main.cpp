@@ -4,13 +4,48 @@
 #include <esp_log.h>
 #include <peer.h>
 
+#include "boot_timing.h"
+#include "freertos/event_groups.h"
+#include "g711.h"
+#include "media.h"
+#include "media_memory.h"
+
 #ifndef LINUX_BUILD
 #include "nvs_flash.h"
-#include "media.h"
+#endif
+
+#define BOOT_AUDIO_READY_BIT (1 << 0)
+
+static EventGroupHandle_t boot_events;
 
+// Brings audio up on the other core while the main task does peer setup and
+// Wi-Fi associates. On linux the same pipeline runs on the host backend.
+static void oai_boot_audio_task(void *arg) {
+  init_ringbuffer();
+  start_i2s_task();
+  oai_init_audio_capture();
+  oai_init_audio_decoder();
+  boot_mark(BOOT_PHASE_AUDIO_READY);
+  xEventGroupSetBits(boot_events, BOOT_AUDIO_READY_BIT);
+  vTaskDelete(NULL);
+}
 
+void oai_wait_audio(void) {
+  xEventGroupWaitBits(boot_events, BOOT_AUDIO_READY_BIT, pdFALSE, pdTRUE,
+                      portMAX_DELAY);
+}
 
+static void oai_start_audio(void) {
+  boot_events = xEventGroupCreate();
+  g711_init();
+  xTaskCreatePinnedToCore(oai_boot_audio_task, "boot_audio", 8192, NULL, 5,
+                          NULL, 1);
+}
+
+#ifndef LINUX_BUILD
 extern "C" void app_main(void) {
+  boot_mark(BOOT_PHASE_APP_START);
+  media_memory_init();
   esp_err_t ret = nvs_flash_init();
   if (ret == ESP_ERR_NVS_NO_FREE_PAGES ||
       ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -20,23 +55,23 @@ extern "C" void app_main(void) {
   ESP_ERROR_CHECK(ret);
 
   ESP_ERROR_CHECK(esp_event_loop_create_default());
-  printf("peer_init");
-  peer_init();
-      printf("oai_init_audio_capture");
-  init_ringbuffer();
-  start_i2s_task();
-  oai_init_audio_capture();
-  printf("oai_init_audio_decoder");
-  oai_init_audio_decoder();
-    printf("oai_wifi");
+
+  // Association takes longest, so it starts first and everything else
+  // overlaps with it. The offer waits for the IP in oai_webrtc.
   oai_wifi();
+  oai_start_audio();
+  peer_init();
+  boot_mark(BOOT_PHASE_PEER_READY);
   oai_webrtc();
-
 }
 #else
 int main(void) {
+  boot_mark(BOOT_PHASE_APP_START);
+  media_memory_init();
   ESP_ERROR_CHECK(esp_event_loop_create_default());
+  oai_start_audio();
   peer_init();
+  boot_mark(BOOT_PHASE_PEER_READY);
   oai_webrtc();
 }
 #endif
@@ -1,14 +1,23 @@
 #include <peer.h>
 #include "freertos/FreeRTOS.h"
+#include "signaling.h"
 
 #define LOG_TAG "realtimeapi-sdk"
-#define MAX_HTTP_OUTPUT_BUFFER 2048
 
 void oai_wifi(void);
+void oai_wait_network(void);
+void oai_wait_audio(void);
 void oai_init_audio_capture(void);
 void oai_init_audio_decoder(void);
 void oai_init_audio_encoder();
-void oai_send_audio(PeerConnection *peer_connection);
+bool oai_send_audio(PeerConnection *peer_connection);
+void oai_audio_receive(uint8_t *data, size_t size);
 void oai_audio_decode(uint8_t *data, size_t size);
+void oai_audio_interrupt(void);
+void oai_audio_item_started(void);
+uint32_t oai_audio_item_played_ms(void);
 void oai_webrtc();
-void oai_http_request(char *offer, char *answer);
+// POSTs the offer on the session's signaling client, creating it on first
+// use, and returns the answer SDP, owned by the client until the next
+// request. NULL on any failure.
+const char *oai_http_request(signaling_client_t *client, const char *offer);
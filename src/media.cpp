@@ -1,408 +1,864 @@
-#include <driver/i2s.h>
 #include <opus.h>
 #include <esp_log.h>
-#include "esp_audio_dec_default.h"
-#include "esp_audio_dec.h"
 #include <stdio.h>
 #include <string.h>
+#include <atomic>
 #include "esp_err.h"
+#ifndef LINUX_BUILD
 #include "esp_system.h"
+#endif
 #include <stdlib.h>
-#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/ringbuf.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include <srtp.h>
 
 
 
+#include "audio_capture.h"
+#include "audio_backend.h"
+#include "audio_output.h"
+#include "boot_timing.h"
+#include "g711.h"
+#include "jitter_buffer.h"
+#include "latency.h"
 #include "main.h"
 #include "media.h"
-#include "webrtc.h"
-
-#define OPUS_OUT_BUFFER_SIZE 1276  // 1276 bytes is recommended by opus_encode
+#include "opus_codec.h"
+#include "media_memory.h"
+#include "pcm_ring.h"
+#include "ptime.h"
+#include "resampler.h"
+#include "rtp_stamp.h"
+#include "trace.h"
+#include "vad.h"
+
+#ifdef AUDIO_CODEC_OPUS
+#define SAMPLE_RATE OPUS_SAMPLE_RATE
+#define RTP_CLOCK_RATE 48000
+#else
 #define SAMPLE_RATE 8000
-#define BUFFER_SAMPLES 320
-
-#define MCLK_PIN 0
-#define DAC_BCLK_PIN 15
-#define DAC_LRCLK_PIN 16
-#define DAC_DATA_PIN 7
-#define ADC_BCLK_PIN 4
-#define ADC_LRCLK_PIN 5
-#define ADC_DATA_PIN 6
-
-#define OPUS_ENCODER_BITRATE 30000
-#define OPUS_ENCODER_COMPLEXITY 0
+#define RTP_CLOCK_RATE SAMPLE_RATE
+#endif
+
+// Rate the microphone and DAC run at. When it differs from the codec rate a
+// resampler sits between the device and the codec in each direction; by
+// default they match and neither exists.
+#ifndef AUDIO_DEVICE_SAMPLE_RATE
+#define AUDIO_DEVICE_SAMPLE_RATE SAMPLE_RATE
+#endif
+#define AUDIO_RESAMPLE (AUDIO_DEVICE_SAMPLE_RATE != SAMPLE_RATE)
+
+
+// The Realtime API's turn detection and input buffer expect continuous
+// audio, so suppressing silence is opt-in.
+#ifndef AUDIO_VAD_SILENCE
+#define AUDIO_VAD_SILENCE VAD_SILENCE_SEND
+#endif
+#define CAPTURE_STATS_INTERVAL_US (5 * 1000 * 1000)
+
+
+#define PLAYBACK_GAIN_Q8 384  // 1.5x
+#define PLAYBACK_GAIN_DB_Q8 901  // +3.5dB, the same 1.5x for Opus
+#define OPUS_ENCODER_EXPECTED_LOSS 0
+
+#ifndef AUDIO_OUTPUT_PROFILE
+#define AUDIO_OUTPUT_PROFILE AUDIO_PROFILE_LOW_LATENCY
+#endif
+
+
+// End-to-end audio timing, reported by oai_audio_latency_json. Each one is
+// recorded on a single task: uplink on the publisher, downlink on the I2S
+// task, except arrival times, which the jitter buffer carries over.
+static latency_histogram_t uplink_encode_latency;    // Capture to encoded
+static latency_histogram_t uplink_send_latency;      // Encoded to sent
+static latency_histogram_t uplink_total_latency;     // Capture to sent
+static latency_histogram_t downlink_jitter_latency;  // Arrival to in the ring
+static latency_histogram_t downlink_ring_latency;    // Ring to I2S write
+static latency_histogram_t downlink_total_latency;   // Arrival to I2S write
+static latency_gauge_t jitter_depth_gauge;           // Frames
+static latency_gauge_t ring_fill_gauge;              // ms
+static latency_gauge_t device_queue_gauge;           // ms
+
+static audio_input_device_t capture_device;
+static audio_capture_t capture;
+static vad_t vad;
+#if AUDIO_RESAMPLE
+static resampler_t uplink_resampler;    // Microphone to codec rate
+static resampler_t downlink_resampler;  // Codec to DAC rate
+#endif
+
+#ifdef AUDIO_CODEC_OPUS
+static opus_codec_encoder_t opus_uplink;
+#define UPLINK_BITRATE OPUS_ENCODER_BITRATE
+#else
+#define UPLINK_BITRATE (SAMPLE_RATE * 8)
+#endif
+
+// The uplink's packetization time. Requested by the network task for each
+// session and taken up by the publisher between frames.
+static std::atomic<uint32_t> uplink_ptime_request(AUDIO_PTIME_MS);
+static uint32_t uplink_ptime_ms = AUDIO_PTIME_MS;
+
+// libpeer's payload types for the uplink codec.
+#ifdef AUDIO_CODEC_OPUS
+#define UPLINK_PAYLOAD_TYPE 111
+#else
+#define UPLINK_PAYLOAD_TYPE 8
+#endif
+
+// Capture timestamps on their way to the wire, see rtp_stamp.h.
+static rtp_stamp_queue_t uplink_stamps;
+// Set by the network task once a session's peer connection is gone, taken up
+// by the publisher before its next frame.
+static std::atomic<bool> uplink_restart_request(false);
+
+// The frame's capture timestamp on the RTP clock. The microphone may run at
+// another rate than the codec's clock, so device samples are counted in 64
+// bits and scaled, which keeps 32-bit wraps out of the arithmetic.
+static uint32_t uplink_rtp_timestamp(const audio_frame_t *frame) {
+    static bool started = false;
+    static uint32_t base;
+    static uint32_t last_capture;
+    static uint64_t device_samples;
+    if (!started) {
+        started = true;
+        base = frame->rtp_timestamp;
+        last_capture = frame->rtp_timestamp;
+    }
+    device_samples += frame->rtp_timestamp - last_capture;
+    last_capture = frame->rtp_timestamp;
+    return base + (uint32_t)(device_samples * RTP_CLOCK_RATE / AUDIO_DEVICE_SAMPLE_RATE);
+}
 
+// libpeer protects every RTP packet here (-Wl,--wrap, see CMakeLists.txt),
+// after it numbered and stamped the packet itself; the uplink's own timestamp
+// replaces that stamp before the packet is authenticated.
+extern "C" srtp_err_status_t __real_srtp_protect(srtp_t ctx, void *rtp_hdr, int *len_ptr);
 
-typedef union {
-    esp_opus_dec_cfg_t  opus_cfg;
-    esp_adpcm_dec_cfg_t adpcm_cfg;
-    esp_alac_dec_cfg_t  alac_cfg;
-    esp_aac_dec_cfg_t   aac_cfg;
-    esp_g711_dec_cfg_t  g711_cfg;
-} dec_all_cfg_t;
+extern "C" srtp_err_status_t __wrap_srtp_protect(srtp_t ctx, void *rtp_hdr, int *len_ptr) {
+    rtp_stamp_apply(&uplink_stamps, (uint8_t *)rtp_hdr, (size_t)*len_ptr);
+    return __real_srtp_protect(ctx, rtp_hdr, len_ptr);
+}
 
-typedef struct {
-    uint8_t *data;
-    int      read_size;
-    int      size;
-} read_ctx_t;
+// Set when the publisher's current pass handed a frame to libpeer.
+static bool uplink_queued = false;
+
+// Frames are sent only while a peer connection is up; in between they are
+// still read so the DMA never overflows and timestamps keep running. The VAD
+// sees every frame so its noise floor is settled by the time we connect, and
+// suppressed frames skip the encoder too.
+static void send_captured_frame(const audio_frame_t *frame, void *user_data) {
+    PeerConnection *peer_connection = (PeerConnection *)user_data;
+    const int16_t *samples = frame->samples;
+    size_t count = frame->count;
+#if AUDIO_RESAMPLE
+    // A 60ms frame at 48kHz is more than one resampler call takes.
+    static int16_t resampled[AUDIO_CAPTURE_MAX_FRAME];
+    count = 0;
+    for (size_t done = 0; done < frame->count; done += RESAMPLER_MAX_INPUT) {
+        size_t chunk = frame->count - done;
+        chunk = chunk < RESAMPLER_MAX_INPUT ? chunk : RESAMPLER_MAX_INPUT;
+        count += resampler_process(&uplink_resampler, frame->samples + done, chunk,
+                                   resampled + count);
+    }
+    samples = resampled;
+#endif
+    bool was_speech = vad.speech;
+    bool send = vad_process(&vad, samples, count,
+                            UPLINK_BITRATE / 8 * uplink_ptime_ms / 1000);
+    if (vad.speech != was_speech) {
+        ESP_LOGI(LOG_TAG, "vad: %s", vad.speech ? "speech" : "silence");
+        TRACE(TRACE_VAD, vad.speech, vad.energy);
+    }
+    uint32_t rtp_timestamp = uplink_rtp_timestamp(frame);
+    TRACE(TRACE_UPLINK_FRAME, rtp_timestamp, peer_connection != NULL && send);
+    // RFC 3551: the first packet of a talkspurt, after frames that were
+    // held back or never sent, carries the marker bit.
+    static bool last_sent = false;
+    bool marker = !last_sent;
+    last_sent = false;
+    if (peer_connection == NULL || !send) {
+        return;
+    }
+#ifdef AUDIO_CODEC_OPUS
+    int size = opus_codec_encode(&opus_uplink, samples, count);
+    if (size < 0) {
+        ESP_LOGE(LOG_TAG, "Failed to encode Opus frame");
+        return;
+    }
+    int64_t encoded_us = esp_timer_get_time();
+    rtp_stamp_push(&uplink_stamps, rtp_timestamp, marker);
+    int sent = peer_connection_send_audio(peer_connection, opus_uplink.packet, size);
+#else
+    static uint8_t encoded[AUDIO_CAPTURE_MAX_FRAME];
+    g711_alaw_encode(samples, encoded, count);
+    size_t size = count;  // One byte per sample
+    int64_t encoded_us = esp_timer_get_time();
+    rtp_stamp_push(&uplink_stamps, rtp_timestamp, marker);
+    int sent = peer_connection_send_audio(peer_connection, encoded, size);
+#endif
+    if (sent < 0) {
+        rtp_stamp_cancel(&uplink_stamps);
+        return;
+    }
+    last_sent = true;
+    uplink_queued = true;
+    int64_t sent_us = esp_timer_get_time();
+    TRACE(TRACE_UPLINK_SENT, size, sent_us - frame->capture_us);
+    latency_histogram_record(&uplink_encode_latency, encoded_us - frame->capture_us);
+    latency_histogram_record(&uplink_send_latency, sent_us - encoded_us);
+    latency_histogram_record(&uplink_total_latency, sent_us - frame->capture_us);
+}
 
-typedef struct {
-    bool                      use_common_api;
-    esp_audio_dec_handle_t    decoder;
-    esp_audio_dec_out_frame_t out_frame;
-    bool                      decode_err;
-} write_ctx_t;
+void oai_init_audio_capture() {
+    vad_init(&vad, AUDIO_VAD_SILENCE, AUDIO_PTIME_MS);
+    rtp_stamp_init(&uplink_stamps, UPLINK_PAYLOAD_TYPE, RTP_CLOCK_RATE * AUDIO_PTIME_MS / 1000);
+#if AUDIO_RESAMPLE
+    if (!resampler_init(&uplink_resampler, AUDIO_DEVICE_SAMPLE_RATE, SAMPLE_RATE)) {
+        ESP_LOGE(LOG_TAG, "Cannot resample %d Hz to %d Hz", AUDIO_DEVICE_SAMPLE_RATE, SAMPLE_RATE);
+    }
+#endif
+    audio_backend_input_init(&capture_device);
+    if (!audio_capture_open(&capture, &capture_device, AUDIO_DEVICE_SAMPLE_RATE, AUDIO_PTIME_MS,
+                            send_captured_frame, NULL)) {
+        ESP_LOGE(LOG_TAG, "Failed to open audio capture");
+    }
+}
 
-static read_ctx_t  read_ctx;
-static write_ctx_t write_ctx;
+#ifdef AUDIO_CODEC_OPUS
+static opus_codec_decoder_t opus_downlink;
+#endif
 
-esp_audio_dec_handle_t  g_decoder = NULL ;
+void oai_init_audio_decoder() {
+#ifdef AUDIO_CODEC_OPUS
+    // Decoded every 20ms, so its state stays in internal RAM.
+    void *state = media_memory_alloc(MEDIA_MEMORY_INTERNAL, opus_codec_decoder_size(),
+                                     "opus decoder");
+    if (state == NULL ||
+        !opus_codec_decoder_init(&opus_downlink, SAMPLE_RATE, PLAYBACK_GAIN_DB_Q8, state)) {
+        ESP_LOGE(LOG_TAG, "Failed to create Opus decoder");
+#ifndef LINUX_BUILD
+        esp_restart();
+#else
+        abort();
+#endif
+    }
+#else
+    g711_alaw_set_decode_gain(PLAYBACK_GAIN_Q8);
+#endif
+}
 
-static uint64_t get_timestamp() {
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+// 256ms of 8kHz audio, scaled with the DAC rate so the ring holds the same
+// span of codec audio after resampling. Must be a power of 2.
+#if AUDIO_DEVICE_SAMPLE_RATE <= SAMPLE_RATE
+#define PLAYBACK_RING_SAMPLES 2048
+#elif AUDIO_DEVICE_SAMPLE_RATE <= 2 * SAMPLE_RATE
+#define PLAYBACK_RING_SAMPLES 4096
+#elif AUDIO_DEVICE_SAMPLE_RATE <= 4 * SAMPLE_RATE
+#define PLAYBACK_RING_SAMPLES 8192
+#else
+#define PLAYBACK_RING_SAMPLES 16384
+#endif
+#define PLAYBACK_STATS_INTERVAL_US (1000 * 1000)
+#define RTP_HEADER_SIZE 12
+#define CONCEAL_MAX_FRAMES 3  // Consecutive lost frames faded before silence
+
+static pcm_ring_t playback_ring;
+static audio_output_device_t playback_device;
+static audio_output_t playback_output;
+static jitter_buffer_t *jitter_buffer = NULL;
+static SemaphoreHandle_t jitter_buffer_lock = NULL;
+
+// Bytes decoded in place into the ring, logged once per second next to the
+// bytes the output engine copied into the I2S DMA buffers.
+static std::atomic<uint32_t> playback_decoded_bytes(0);
+
+// The ring is read by the output engine every device period and stays in
+// internal RAM. Jitter buffer slots are touched once per packet and are big
+// enough to belong in PSRAM.
+void init_ringbuffer(void) {
+    int16_t *storage = (int16_t *)media_memory_alloc(
+        MEDIA_MEMORY_INTERNAL, PLAYBACK_RING_SAMPLES * sizeof(int16_t), "playback ring");
+    if (storage == NULL || !pcm_ring_init(&playback_ring, storage, PLAYBACK_RING_SAMPLES)) {
+        ESP_LOGE(LOG_TAG, "Failed to create ring buffer");
+    }
+#if AUDIO_RESAMPLE
+    if (!resampler_init(&downlink_resampler, SAMPLE_RATE, AUDIO_DEVICE_SAMPLE_RATE)) {
+        ESP_LOGE(LOG_TAG, "Cannot resample %d Hz to %d Hz", SAMPLE_RATE, AUDIO_DEVICE_SAMPLE_RATE);
+    }
+#endif
+
+    jitter_buffer = (jitter_buffer_t *)media_memory_alloc(
+        MEDIA_MEMORY_PSRAM, sizeof(jitter_buffer_t), "jitter buffer");
+    jitter_buffer_lock = xSemaphoreCreateMutex();
+    if (jitter_buffer == NULL || jitter_buffer_lock == NULL) {
+        ESP_LOGE(LOG_TAG, "Failed to create jitter buffer");
+        return;
+    }
+    jitter_buffer_init(jitter_buffer, RTP_CLOCK_RATE);
 }
 
-void oai_init_audio_capture() {
-  i2s_config_t i2s_config_out = {
-      .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
-      .sample_rate = SAMPLE_RATE,
-      .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
-      .channel_format = I2S_CHANNEL_FMT_ONLY_RIGHT,
-      .communication_format = I2S_COMM_FORMAT_STAND_MSB,
-      .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-      .dma_buf_count = 3,
-      .dma_buf_len = BUFFER_SAMPLES,
-      .use_apll = false,
-        .tx_desc_auto_clear = true,            // 自动清除描述符
-        .fixed_mclk = 0
-  };
-  if (i2s_driver_install(I2S_NUM_1, &i2s_config_out, 0, NULL) != ESP_OK) {
-    printf("Failed to configure I2S driver for audio output");
-    return;
-  }
-
-  i2s_pin_config_t pin_config_out = {
-      // .mck_io_num = MCLK_PIN,
-      .bck_io_num = DAC_BCLK_PIN,
-      .ws_io_num = DAC_LRCLK_PIN,
-      .data_out_num = DAC_DATA_PIN,
-      .data_in_num = I2S_PIN_NO_CHANGE,
-  };
-  if (i2s_set_pin(I2S_NUM_1, &pin_config_out) != ESP_OK) {
-    printf("Failed to set I2S pins for audio output");
-    return;
-  }
-  i2s_zero_dma_buffer(I2S_NUM_1);
-
-  i2s_config_t i2s_config_in = {
-      .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
-      .sample_rate = SAMPLE_RATE,
-      .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
-      .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
-      .communication_format = I2S_COMM_FORMAT_I2S_MSB,
-      .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-      .dma_buf_count = 8,
-      .dma_buf_len = BUFFER_SAMPLES,
-      .use_apll = 1,
-  };
-  if (i2s_driver_install(I2S_NUM_0, &i2s_config_in, 0, NULL) != ESP_OK) {
-    printf("Failed to configure I2S driver for audio input");
-    return;
-  }
-
-  i2s_pin_config_t pin_config_in = {
-      .mck_io_num = MCLK_PIN,
-      .bck_io_num = ADC_BCLK_PIN,
-      .ws_io_num = ADC_LRCLK_PIN,
-      .data_out_num = I2S_PIN_NO_CHANGE,
-      .data_in_num = ADC_DATA_PIN,
-  };
-  if (i2s_set_pin(I2S_NUM_0, &pin_config_in) != ESP_OK) {
-    printf("Failed to set I2S pins for audio input");
-    return;
-  }
+// Runs on the network task. libpeer hands us the payload pointer inside the
+// packet it just unprotected, so the fixed RTP header sits right before it.
+// If that does not look like RTP, fall back to arrival order.
+void oai_audio_receive(uint8_t *data, size_t size) {
+    static uint16_t fallback_seq = 0;
+    static uint32_t fallback_timestamp = 0;
+    if (boot_mark(BOOT_PHASE_FIRST_AUDIO)) {
+        boot_log();
+    }
 
-}
+    uint16_t seq;
+    uint32_t timestamp;
+    const uint8_t *header = data - RTP_HEADER_SIZE;
+    if ((header[0] >> 6) == 2 && (header[0] & 0x0F) == 0) {
+        seq = (uint16_t)((header[2] << 8) | header[3]);
+        timestamp = ((uint32_t)header[4] << 24) | ((uint32_t)header[5] << 16) |
+                    ((uint32_t)header[6] << 8) | header[7];
+    } else {
+        seq = fallback_seq++;
+        timestamp = fallback_timestamp;
+#ifdef AUDIO_CODEC_OPUS
+        fallback_timestamp += RTP_CLOCK_RATE / 50;
+#else
+        fallback_timestamp += size;
+#endif
+    }
 
-opus_int16 *output_buffer = NULL;
-OpusDecoder *opus_decoder = NULL;
-
-// A-Law to PCM16 conversion table
-static const int16_t aLawToPcmTable[256] = { -5504, -5248, -6016, -5760, -4480, -4224,
-  -4992, -4736, -7552, -7296, -8064, -7808, -6528, -6272, -7040, -6784,
-  -2752, -2624, -3008, -2880, -2240, -2112, -2496, -2368, -3776, -3648,
-  -4032, -3904, -3264, -3136, -3520, -3392, -22016, -20992, -24064,
-  -23040, -17920, -16896, -19968, -18944, -30208, -29184, -32256,
-  -31232, -26112, -25088, -28160, -27136, -11008, -10496, -12032,
-  -11520, -8960, -8448, -9984, -9472, -15104, -14592, -16128, -15616,
-  -13056, -12544, -14080, -13568, -344, -328, -376, -360, -280, -264,
-  -312, -296, -472, -456, -504, -488, -408, -392, -440, -424, -88, -72,
-  -120, -104, -24, -8, -56, -40, -216, -200, -248, -232, -152, -136,
-  -184, -168, -1376, -1312, -1504, -1440, -1120, -1056, -1248, -1184,
-  -1888, -1824, -2016, -1952, -1632, -1568, -1760, -1696, -688, -656,
-  -752, -720, -560, -528, -624, -592, -944, -912, -1008, -976, -816,
-  -784, -880, -848, 5504, 5248, 6016, 5760, 4480, 4224, 4992, 4736,
-  7552, 7296, 8064, 7808, 6528, 6272, 7040, 6784, 2752, 2624, 3008,
-  2880, 2240, 2112, 2496, 2368, 3776, 3648, 4032, 3904, 3264, 3136,
-  3520, 3392, 22016, 20992, 24064, 23040, 17920, 16896, 19968, 18944,
-  30208, 29184, 32256, 31232, 26112, 25088, 28160, 27136, 11008, 10496,
-  12032, 11520, 8960, 8448, 9984, 9472, 15104, 14592, 16128, 15616,
-  13056, 12544, 14080, 13568, 344, 328, 376, 360, 280, 264, 312, 296,
-  472, 456, 504, 488, 408, 392, 440, 424, 88, 72, 120, 104, 24, 8, 56,
-  40, 216, 200, 248, 232, 152, 136, 184, 168, 1376, 1312, 1504, 1440,
-  1120, 1056, 1248, 1184, 1888, 1824, 2016, 1952, 1632, 1568, 1760,
-  1696, 688, 656, 752, 720, 560, 528, 624, 592, 944, 912, 1008, 976,
-  816, 784, 880, 848};
-
-int16_t alawToPCM(uint8_t alawbyte) {
-    alawbyte ^= 0x55;
-    int sign = (alawbyte & 0x80) != 0;
-    int exponent = (alawbyte & 0x70) >> 4;
-    int16_t data = (alawbyte & 0x0F);
-
-    data <<= 4;
-    data += 8;
-
-    if (exponent != 0) {
-        data += 0x100;
-    }
-    if (exponent > 1) {
-        data <<= (exponent - 1);
-    }
-
-    if (sign) {
-        return data;
-    }
-    return -data;
+    TRACE(TRACE_DOWNLINK_RECEIVED, seq, size);
+    xSemaphoreTake(jitter_buffer_lock, portMAX_DELAY);
+    jitter_buffer_put(jitter_buffer, seq, timestamp, data, size, esp_timer_get_time());
+    xSemaphoreGive(jitter_buffer_lock);
 }
 
-int16_t convertALawToPCM16(uint8_t aLawByte) {
-    // return aLawToPcmTable[aLawByte];
-    return alawToPCM(aLawByte)*1.5;
+#if AUDIO_RESAMPLE || defined(AUDIO_CODEC_OPUS)
+// Copies samples into the ring, counting whatever does not fit as overrun.
+static void ring_copy(const int16_t *src, size_t count) {
+    while (count > 0) {
+        size_t chunk = count;
+        int16_t *dst = pcm_ring_acquire_write(&playback_ring, &chunk);
+        if (dst == NULL) {
+            audio_output_count_overrun(&playback_output, count);
+            break;
+        }
+        memcpy(dst, src, chunk * sizeof(int16_t));
+        pcm_ring_commit_write(&playback_ring, chunk);
+        playback_decoded_bytes += chunk * sizeof(int16_t);
+        src += chunk;
+        count -= chunk;
+    }
 }
 
-// Convert a buffer of PCMA data to PCM16
-void convertALawBufferToPCM16(const uint8_t *aLawData, int16_t *pcmData, size_t length) {
-    for (size_t i = 0; i < length; ++i) {
-        pcmData[i] = convertALawToPCM16(aLawData[i]);
+// Writes decoded codec-rate audio into the ring, through the downlink
+// resampler when the DAC runs at another rate.
+static void ring_write_pcm(const int16_t *pcm, size_t count) {
+#if AUDIO_RESAMPLE
+    // 20ms at a time keeps the scratch buffer one DAC frame long.
+    static int16_t resampled[AUDIO_DEVICE_SAMPLE_RATE / 50 + 1];
+    const size_t chunk = SAMPLE_RATE / 50;
+    while (count > 0) {
+        size_t in = count < chunk ? count : chunk;
+        ring_copy(resampled, resampler_process(&downlink_resampler, pcm, in, resampled));
+        pcm += in;
+        count -= in;
     }
+#else
+    ring_copy(pcm, count);
+#endif
 }
-
-void oai_init_audio_decoder() {
-    printf("enter oai_init_audio_decoder\n");
-    // xTaskCreate(uart_task, "uart_task", 2048, NULL, 10, NULL);
-  // int ret = 0;
-  // esp_g711_dec_cfg_t g711_cfg = {
-  //   .channel = 1,
-  // };
-  //  esp_audio_dec_cfg_t dec_cfg = {
-  //       .type = ESP_AUDIO_TYPE_G711A,
-  //       .cfg = &g711_cfg,
-  //       .cfg_sz = sizeof(esp_g711_dec_cfg_t),
-  //   };
-  // esp_g711a_dec_register();
-  // ret = esp_audio_dec_open(&dec_cfg, &g_decoder);
-  // if (ret != ESP_AUDIO_ERR_OK) {
-  //   ESP_LOGE(LOG_TAG, "Fail to open decoder ret %d", ret);
-  //   esp_restart();
-  //   return;
-  // }
-  // ESP_LOGI(LOG_TAG, "esp_audio_dec_open SUCCESS");
-
-  // int decoder_error = 0;
-  // opus_decoder = opus_decoder_create(SAMPLE_RATE, 2, &decoder_error);
-  // if (decoder_error != OPUS_OK) {
-  //   printf("Failed to create OPUS decoder");
-  //   return;
-  // }
-
-  // output_buffer = (opus_int16 *)malloc(BUFFER_SAMPLES * sizeof(opus_int16));
+#endif
+
+#ifndef AUDIO_CODEC_OPUS
+static void alaw_decode_faded(const uint8_t *data, int16_t *samples, size_t count,
+                              int fade_shift) {
+    if (fade_shift >= CONCEAL_MAX_FRAMES) {
+        memset(samples, 0, count * sizeof(int16_t));
+        return;
+    }
+    g711_alaw_decode(data, samples, count);
+    for (size_t i = 0; fade_shift > 0 && i < count; i++) {
+        samples[i] >>= fade_shift;
+    }
 }
 
-// #define PCM_BUFFER_SIZE 7680 // 8KB
+// Decodes straight into ring storage, or via scratch and the resampler when
+// the DAC runs at another rate. `fade_shift` attenuates by 6dB per step for
+// concealment; CONCEAL_MAX_FRAMES and above write silence.
+static void decode_into_ring(const uint8_t *data, size_t size, int fade_shift) {
+#if AUDIO_RESAMPLE
+    static int16_t scratch[JITTER_BUFFER_MAX_PAYLOAD];
+    size = size < JITTER_BUFFER_MAX_PAYLOAD ? size : JITTER_BUFFER_MAX_PAYLOAD;
+    alaw_decode_faded(data, scratch, size, fade_shift);
+    ring_write_pcm(scratch, size);
+#else
+    while (size > 0) {
+        size_t count = size;
+        int16_t *samples = pcm_ring_acquire_write(&playback_ring, &count);
+        if (samples == NULL) {
+            audio_output_count_overrun(&playback_output, size);
+            break;
+        }
 
-// static int16_t pcmBuffer[PCM_BUFFER_SIZE / sizeof(int16_t)]; // 缓存用于存储PCM数据
-// static size_t pcmBufferIndex = 0; // 当前缓存写入位置
+        alaw_decode_faded(data, samples, count, fade_shift);
+        pcm_ring_commit_write(&playback_ring, count);
+        playback_decoded_bytes += count * sizeof(int16_t);
 
-#define RINGBUFFER_SIZE (160 * 1024) // 160KB的RingBuffer
-#define BUFFER_THRESHOLD (1 * 320) // 8KB的阈值
+        data += count;
+        size -= count;
+    }
+#endif
+}
+#endif
+
+#ifdef AUDIO_CODEC_OPUS
+typedef enum {
+    OPUS_DECODE_PACKET,
+    OPUS_DECODE_FEC,
+    OPUS_DECODE_PLC,
+} opus_decode_mode_t;
+
+static uint32_t opus_fec_frames = 0;
+static uint32_t opus_plc_frames = 0;
+
+// Opus wants contiguous output. Decode straight into ring storage when the
+// run up to the wrap point holds a whole frame and no resampling is needed,
+// otherwise via scratch.
+static void opus_decode_into_ring(opus_decode_mode_t mode, const uint8_t *packet, size_t size) {
+    static int16_t scratch[OPUS_CODEC_MAX_DECODE];
+
+    size_t needed = opus_downlink.frame_samples;
+    if (mode == OPUS_DECODE_PACKET) {
+        int samples = opus_codec_packet_samples(&opus_downlink, packet, size);
+        if (samples < 0 || samples > OPUS_CODEC_MAX_DECODE) {
+            TRACE(TRACE_DOWNLINK_MALFORMED, size, 0);
+            return;
+        }
+        needed = samples;
+    }
 
-static RingbufHandle_t xRingbuffer = NULL;
+    size_t count = OPUS_CODEC_MAX_DECODE;
+    int16_t *samples = pcm_ring_acquire_write(&playback_ring, &count);
+    bool in_place = !AUDIO_RESAMPLE && samples != NULL && count >= needed;
+    int16_t *out = in_place ? samples : scratch;
+    size_t max_samples = in_place ? count : OPUS_CODEC_MAX_DECODE;
+
+    int decoded;
+    switch (mode) {
+        case OPUS_DECODE_FEC:
+            decoded = opus_codec_decode_fec(&opus_downlink, packet, size, out, max_samples);
+            break;
+        case OPUS_DECODE_PLC:
+            decoded = opus_codec_conceal(&opus_downlink, out, max_samples);
+            break;
+        case OPUS_DECODE_PACKET:
+        default:
+            decoded = opus_codec_decode(&opus_downlink, packet, size, out, max_samples);
+            break;
+    }
+    if (decoded <= 0) {
+        return;
+    }
 
-void init_ringbuffer(void) {
-    xRingbuffer = xRingbufferCreate(RINGBUFFER_SIZE, RINGBUF_TYPE_BYTEBUF);
-    if (xRingbuffer == NULL) {
-        ESP_LOGE(LOG_TAG, "Failed to create ring buffer");
+    if (in_place) {
+        pcm_ring_commit_write(&playback_ring, decoded);
+        playback_decoded_bytes += decoded * sizeof(int16_t);
+        return;
     }
+
+    // Still decoded when the ring is full so decoder state stays in step.
+    ring_write_pcm(scratch, decoded);
 }
+#endif
 
 void oai_audio_decode(uint8_t *data, size_t size) {
-    char buffer[21];
-    snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)get_timestamp());
-    ESP_LOGD(LOG_TAG, "oai_audio_decode: %s, size: %d", buffer, size);
+#ifdef AUDIO_CODEC_OPUS
+    opus_decode_into_ring(OPUS_DECODE_PACKET, data, size);
+#else
+    decode_into_ring(data, size, 0);
+#endif
+    TRACE(TRACE_DOWNLINK_DECODED, size, pcm_ring_available(&playback_ring));
+}
 
-    int16_t pcmData[size];
-    convertALawBufferToPCM16(data, pcmData, size);
+// Frames decoded into the ring waiting for the engine to hand them to I2S,
+// by the ring position of their first sample. Only touched on the I2S task.
+#define RING_MARKERS 32
 
-    if (xRingbufferSend(xRingbuffer, pcmData, size * sizeof(int16_t), portMAX_DELAY) != pdTRUE) {
-        ESP_LOGE(LOG_TAG, "Failed to write to ring buffer");
+typedef struct {
+    size_t position;
+    int64_t arrival_us;
+    int64_t enqueue_us;
+} ring_marker_t;
+
+static ring_marker_t ring_markers[RING_MARKERS];
+static size_t ring_marker_head = 0;
+static size_t ring_marker_count = 0;
+
+// Where the current output item's audio starts. The network task asks for
+// the next frame out of the jitter buffer to be marked; the I2S task finds
+// its ring position and, once the engine reads it, the played-sample count
+// at which its first sample reaches the speaker.
+static std::atomic<bool> item_start_request(false);
+static bool item_start_queued = false;
+static size_t item_start_position;
+static std::atomic<bool> item_start_known(false);
+static std::atomic<uint32_t> item_start_samples(0);
+
+static void ring_marker_push(size_t position, int64_t arrival_us) {
+    int64_t now = esp_timer_get_time();
+    latency_histogram_record(&downlink_jitter_latency, now - arrival_us);
+    if (ring_marker_count == RING_MARKERS) {
+        return;  // Sampled rather than exact while the ring is this deep
     }
+    ring_marker_t *marker = &ring_markers[(ring_marker_head + ring_marker_count) % RING_MARKERS];
+    marker->position = position;
+    marker->arrival_us = arrival_us;
+    marker->enqueue_us = now;
+    ring_marker_count++;
 }
 
-void i2s_task(void *arg) {
-    size_t item_size;
-    int16_t *item;
-
-    while (1) {
-        size_t available_size = xRingbufferGetMaxItemSize(xRingbuffer);
+// Runs right before the engine reads the next `period` samples from the
+// ring. Frames starting in that span are written to I2S now; frames behind
+// the read position were dropped by a flush.
+static void ring_markers_consume(size_t period) {
+    size_t tail = playback_ring.tail.load();
+    int64_t now = esp_timer_get_time();
+    while (ring_marker_count > 0) {
+        ring_marker_t *marker = &ring_markers[ring_marker_head];
+        ptrdiff_t offset = (ptrdiff_t)(marker->position - tail);
+        if (offset >= (ptrdiff_t)period) {
+            break;
+        }
+        if (offset >= 0) {
+            latency_histogram_record(&downlink_ring_latency, now - marker->enqueue_us);
+            latency_histogram_record(&downlink_total_latency, now - marker->arrival_us);
+        }
+        ring_marker_head = (ring_marker_head + 1) % RING_MARKERS;
+        ring_marker_count--;
+    }
 
-        if (available_size >= BUFFER_THRESHOLD) {
-            item = (int16_t *)xRingbufferReceive(xRingbuffer, &item_size, portMAX_DELAY);
+    // A start a flush dropped was never heard: nothing of the item plays.
+    ptrdiff_t offset = (ptrdiff_t)(item_start_position - tail);
+    if (item_start_queued && offset < (ptrdiff_t)period) {
+        item_start_queued = false;
+        item_start_samples = playback_output.written_samples + (offset > 0 ? offset : 0);
+        item_start_known = offset >= 0;
+    }
+}
 
-            if (item != NULL) {
-                size_t bytes_written = 0;
-                i2s_write(I2S_NUM_1, item, item_size, &bytes_written, portMAX_DELAY);
-                vRingbufferReturnItem(xRingbuffer, (void *)item);
+// Pulls one frame from the jitter buffer into the ring. Lost A-law frames
+// repeat the last good one, fading out. Lost Opus frames are rebuilt from the
+// next packet's in-band FEC when it is already here, and from the decoder's
+// PLC otherwise. Returns false when there is nothing to play.
+static bool playout_frame(void) {
+    static uint8_t payloads[2][JITTER_BUFFER_MAX_PAYLOAD];
+    static uint8_t *current = payloads[0];
+#ifndef AUDIO_CODEC_OPUS
+    static uint8_t *last_good = payloads[1];
+    static size_t last_good_size = 0;
+    static int lost_run = 0;
+#endif
+
+    size_t size = 0;
+    xSemaphoreTake(jitter_buffer_lock, portMAX_DELAY);
+    jitter_buffer_result_t result = jitter_buffer_get(jitter_buffer, current, &size);
+    int64_t arrival_us = jitter_buffer->last_arrival_us;
+    latency_gauge_set(&jitter_depth_gauge, jitter_buffer->depth);
+    xSemaphoreGive(jitter_buffer_lock);
+
+    switch (result) {
+        case JITTER_BUFFER_FRAME: {
+            size_t position = playback_ring.head.load();
+            oai_audio_decode(current, size);
+            ring_marker_push(position, arrival_us);
+            if (item_start_request.exchange(false)) {
+                item_start_queued = true;
+                item_start_position = position;
             }
+#ifndef AUDIO_CODEC_OPUS
+            uint8_t *swap = last_good;
+            last_good = current;
+            current = swap;
+            last_good_size = size;
+            lost_run = 0;
+#endif
+            return true;
         }
-
-        vTaskDelay(pdMS_TO_TICKS(1)); // 每100ms检查一次
+        case JITTER_BUFFER_LOST: {
+#ifdef AUDIO_CODEC_OPUS
+            xSemaphoreTake(jitter_buffer_lock, portMAX_DELAY);
+            bool have_next = jitter_buffer_peek(jitter_buffer, current, &size);
+            xSemaphoreGive(jitter_buffer_lock);
+            TRACE(TRACE_DOWNLINK_LOST, have_next, 0);
+            if (have_next) {
+                opus_fec_frames++;
+                opus_decode_into_ring(OPUS_DECODE_FEC, current, size);
+            } else {
+                opus_plc_frames++;
+                opus_decode_into_ring(OPUS_DECODE_PLC, NULL, 0);
+            }
+#else
+            lost_run++;
+            TRACE(TRACE_DOWNLINK_LOST, 0, lost_run);
+            decode_into_ring(last_good, last_good_size, lost_run);
+#endif
+            return true;
+        }
+        case JITTER_BUFFER_EMPTY:
+        default:
+            return false;
     }
 }
 
-void start_i2s_task(void) {
-    const BaseType_t core_id = 1; // 核心0为第一个核心，核心1为第二个核心
-    xTaskCreatePinnedToCore(i2s_task, "i2s_task", 2048, NULL, 5, NULL, core_id);
-}
-// void oai_audio_decode(uint8_t *data, size_t size) {
-//     char buffer[21]; // 最大20位数字加上终止符
-//     snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)get_timestamp());
-//     ESP_LOGD(LOG_TAG, "oai_audio_decode: %s, size: %d", buffer, size);
-    
-//     int16_t pcmData[size];
-//     convertALawBufferToPCM16(data, pcmData, size);
-
-//     // 将解码后的PCM数据存储到缓存中
-//     if (pcmBufferIndex + size > PCM_BUFFER_SIZE / sizeof(int16_t)) {
-//         // 如果缓存中的数据超过8KB，执行I2S操作
-//         size_t bytes_written = 0;
-//         i2s_write(I2S_NUM_1, pcmBuffer, pcmBufferIndex * sizeof(int16_t),
-//                   &bytes_written, portMAX_DELAY);
-
-//         // 清空缓存
-//         pcmBufferIndex = 0;
-//     }
-    
-//     // 将当前PCM数据拷贝到缓存中
-//     memcpy(&pcmBuffer[pcmBufferIndex], pcmData, size * sizeof(int16_t));
-//     pcmBufferIndex += size;
-// }
-
-// void oai_audio_decode(uint8_t *data, size_t size) {
-//   char buffer[21]; // 最大20位数字加上终止符
-//   snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)get_timestamp());
-//   ESP_LOGD(LOG_TAG, "oai_audio_decode: %s, size: %d", buffer, size);
-
-//   int16_t pcmData[size];
-//   convertALawBufferToPCM16(data, pcmData, size);
-//   size_t bytes_written = 0;
-//   i2s_write(I2S_NUM_1, pcmData, size,
-//             &bytes_written, portMAX_DELAY);
-// }
-
-OpusEncoder *opus_encoder = NULL;
-opus_int16 *encoder_input_buffer = NULL;
-uint8_t *encoder_output_buffer = NULL;
+static void log_playback_stats(void) {
+    static int64_t last_report = 0;
+    int64_t now = esp_timer_get_time();
+    if (now - last_report < PLAYBACK_STATS_INTERVAL_US) {
+        return;
+    }
+    last_report = now;
+
+    static uint32_t last_periods = 0;
+    audio_output_stats_t output_stats;
+    audio_output_get_stats(&playback_output, &output_stats);
+    uint32_t copied_bytes = (output_stats.periods - last_periods) *
+                            playback_output.config.period_samples * sizeof(int16_t);
+    last_periods = output_stats.periods;
+    ESP_LOGI(LOG_TAG, "playback: decoded %lu B/s in place, copied %lu B/s to I2S, underruns %lu, overruns %lu, starved %lu",
+             (unsigned long)playback_decoded_bytes.exchange(0),
+             (unsigned long)copied_bytes,
+             (unsigned long)output_stats.underruns,
+             (unsigned long)output_stats.overruns,
+             (unsigned long)output_stats.starved);
+
+    static uint32_t last_flushes = 0;
+    if (output_stats.flushes != last_flushes) {
+        last_flushes = output_stats.flushes;
+        ESP_LOGI(LOG_TAG, "barge-in: %lu flushes, event to silence %lld us (max %lld us), dropped %lu samples",
+                 (unsigned long)output_stats.flushes,
+                 (long long)output_stats.flush_latency_last_us,
+                 (long long)output_stats.flush_latency_max_us,
+                 (unsigned long)output_stats.flushed_samples);
+    }
 
-void oai_init_audio_encoder() {
-  int encoder_error;
-  opus_encoder = opus_encoder_create(SAMPLE_RATE, 1, OPUS_APPLICATION_VOIP,
-                                     &encoder_error);
-  if (encoder_error != OPUS_OK) {
-    printf("Failed to create OPUS encoder");
-    return;
-  }
-
-  if (opus_encoder_init(opus_encoder, SAMPLE_RATE, 1, OPUS_APPLICATION_VOIP) !=
-      OPUS_OK) {
-    printf("Failed to initialize OPUS encoder");
-    return;
-  }
-
-  opus_encoder_ctl(opus_encoder, OPUS_SET_BITRATE(OPUS_ENCODER_BITRATE));
-  opus_encoder_ctl(opus_encoder, OPUS_SET_COMPLEXITY(OPUS_ENCODER_COMPLEXITY));
-  opus_encoder_ctl(opus_encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
-  encoder_input_buffer = (opus_int16 *)malloc(BUFFER_SAMPLES);
-  encoder_output_buffer = (uint8_t *)malloc(OPUS_OUT_BUFFER_SIZE);
+    jitter_buffer_stats_t stats;
+    xSemaphoreTake(jitter_buffer_lock, portMAX_DELAY);
+    jitter_buffer_get_stats(jitter_buffer, &stats);
+    xSemaphoreGive(jitter_buffer_lock);
+    ESP_LOGI(LOG_TAG, "jitter buffer: depth %d/%d frames, jitter %lu ms, lost %lu, late %lu, trimmed %lu",
+             stats.depth, stats.target, (unsigned long)stats.jitter_ms,
+             (unsigned long)stats.lost, (unsigned long)stats.late,
+             (unsigned long)stats.trimmed);
+#ifdef AUDIO_CODEC_OPUS
+    ESP_LOGI(LOG_TAG, "opus: recovered %lu frames from FEC, concealed %lu with PLC",
+             (unsigned long)opus_fec_frames, (unsigned long)opus_plc_frames);
+#endif
 }
 
-#define ALAW_MAX 0xFFF
-#define ALAW_BIAS 0x84
+// Barge-in. Drops queued frames from the jitter buffer here and asks the
+// output engine to empty the ring and the DAC before its next period.
+void oai_audio_interrupt(void) {
+    xSemaphoreTake(jitter_buffer_lock, portMAX_DELAY);
+    jitter_buffer_flush(jitter_buffer);
+    xSemaphoreGive(jitter_buffer_lock);
+    audio_output_flush(&playback_output);
+}
 
-static uint8_t linear_to_alaw(int16_t pcm_val) {
-    int16_t mask;
-    int16_t seg;
-    uint8_t aval;
+void oai_audio_item_started(void) {
+    item_start_known = false;
+    item_start_request = true;
+}
 
-    // Convert from 16-bit signed to 13-bit signed
-    if (pcm_val >= 0) {
-        mask = 0xD5; // Sign (7th) bit = 1
-    } else {
-        mask = 0x55; // Sign bit = 0
-        pcm_val = -pcm_val - 1;
+uint32_t oai_audio_item_played_ms(void) {
+    if (!item_start_known) {
+        return 0;
     }
+    int32_t played = (int32_t)(audio_output_played_samples(&playback_output) - item_start_samples);
+    return played > 0 ? (uint32_t)((uint64_t)played * 1000 / AUDIO_DEVICE_SAMPLE_RATE) : 0;
+}
 
-    // Bias the input
-    pcm_val += ALAW_BIAS;
-
-    if (pcm_val > ALAW_MAX) {
-        pcm_val = ALAW_MAX;
+// Called by the output engine before each device period: tops the ring up
+// from the jitter buffer.
+static void playout_refill(size_t samples, void *user_data) {
+    while (pcm_ring_available(&playback_ring) < samples && playout_frame()) {
     }
+    ring_markers_consume(samples);
+    latency_gauge_set(&ring_fill_gauge,
+                      pcm_ring_available(&playback_ring) * 1000 / AUDIO_DEVICE_SAMPLE_RATE);
+    latency_gauge_set(&device_queue_gauge,
+                      (playback_output.written_samples -
+                       audio_output_played_samples(&playback_output)) * 1000 / AUDIO_DEVICE_SAMPLE_RATE);
+    log_playback_stats();
+}
 
-    // Find the segment
-    if (pcm_val >= 256) {
-        seg = 7;
-        for (int i = 0x4000; i > 0xFF; i >>= 1) {
-            if (pcm_val & i) {
-                seg++;
-            }
+size_t oai_audio_latency_json(char *out, size_t size) {
+    const struct {
+        const char *name;
+        const latency_histogram_t *histogram;
+    } histograms[] = {
+        {"uplink_encode_us", &uplink_encode_latency},
+        {"uplink_send_us", &uplink_send_latency},
+        {"uplink_total_us", &uplink_total_latency},
+        {"downlink_jitter_us", &downlink_jitter_latency},
+        {"downlink_ring_us", &downlink_ring_latency},
+        {"downlink_total_us", &downlink_total_latency},
+    };
+    const struct {
+        const char *name;
+        const latency_gauge_t *gauge;
+    } gauges[] = {
+        {"jitter_depth_frames", &jitter_depth_gauge},
+        {"ring_fill_ms", &ring_fill_gauge},
+        {"device_queue_ms", &device_queue_gauge},
+    };
+
+    if (size < 3) {
+        return 0;
+    }
+    size_t len = 0;
+    out[len++] = '{';
+    for (size_t i = 0; i < sizeof(histograms) / sizeof(histograms[0]); i++) {
+        if (i > 0) {
+            out[len++] = ',';
         }
-        aval = (seg << 4) | ((pcm_val >> (seg + 3)) & 0x0F);
-    } else {
-        aval = pcm_val >> 4;
+        size_t written = latency_histogram_format(histograms[i].histogram, histograms[i].name,
+                                                  out + len, size - len - 1);
+        if (written == 0) {
+            return 0;
+        }
+        len += written;
+    }
+    for (size_t i = 0; i < sizeof(gauges) / sizeof(gauges[0]); i++) {
+        out[len++] = ',';
+        size_t written = latency_gauge_format(gauges[i].gauge, gauges[i].name,
+                                              out + len, size - len - 1);
+        if (written == 0) {
+            return 0;
+        }
+        len += written;
+    }
+    out[len++] = '}';
+    out[len] = '\0';
+    return len;
+}
+
+// The refill callback decodes on this task, and Opus decode, FEC and PLC need
+// well over 4KB of stack on Xtensa. The "memory" console command shows the
+// peak this task reached.
+#ifdef AUDIO_CODEC_OPUS
+#define I2S_TASK_STACK_SIZE (16 * 1024)
+#else
+#define I2S_TASK_STACK_SIZE 4096
+#endif
+
+// Woken by the DAC's buffer-completion events rather than a polling delay.
+// The engine hands ring storage to i2s_write directly; the only copy left on
+// the playback path is the driver's copy into DMA memory.
+void i2s_task(void *arg) {
+    audio_backend_output_init(&playback_device);
+    if (!audio_output_open(&playback_output, &playback_device, &playback_ring,
+                           AUDIO_OUTPUT_PROFILE, AUDIO_DEVICE_SAMPLE_RATE, playout_refill, NULL)) {
+        ESP_LOGE(LOG_TAG, "Failed to open audio output");
+        vTaskDelete(NULL);
+        return;
     }
+    audio_output_run(&playback_output);
+}
 
-    return aval ^ mask;
+void start_i2s_task(void) {
+    const BaseType_t core_id = 1; // 核心0为第一个核心，核心1为第二个核心
+    media_memory_create_task(i2s_task, "i2s_task", I2S_TASK_STACK_SIZE, NULL, 5, core_id,
+                             MEDIA_MEMORY_INTERNAL);
 }
 
+static void log_ptime_cost(uint32_t ptime_ms) {
+    ptime_cost_t cost;
+    ptime_cost(ptime_ms, UPLINK_BITRATE, &cost);
+    ESP_LOGI(LOG_TAG, "ptime: %lu ms, %.1f packets/s, %lu B payload + %d B headers, "
+             "%lu.%lu%% overhead, %lu kbit/s on the wire", (unsigned long)ptime_ms,
+             cost.packets_per_s, (unsigned long)cost.payload_bytes,
+             PTIME_HEADER_BYTES, (unsigned long)(cost.overhead_permille / 10),
+             (unsigned long)(cost.overhead_permille % 10),
+             (unsigned long)(cost.wire_bps / 1000));
+}
 
+void oai_audio_restart_uplink(void) {
+    uplink_restart_request = true;
+}
 
-void pcm_to_alaw(const int16_t* pcm_samples, uint8_t* alaw_samples, size_t num_samples) {
-    for (size_t i = 0; i < num_samples; ++i) {
-        alaw_samples[i] = linear_to_alaw(pcm_samples[i]);
+bool oai_audio_set_ptime(uint32_t ptime_ms) {
+    if (!ptime_valid(ptime_ms)) {
+        return false;
     }
+    uplink_ptime_request = ptime_ms;
+    return true;
 }
 
+// Runs on the publisher, between frames, so capture, VAD and stamps change
+// together. Frames of the old length still queued go out with their stamps.
+static void apply_uplink_ptime(void) {
+    uint32_t ptime_ms = uplink_ptime_request;
+    if (ptime_ms == uplink_ptime_ms) {
+        return;
+    }
+    if (!audio_capture_set_frame(&capture, ptime_ms)) {
+        ESP_LOGE(LOG_TAG, "Cannot capture %lu ms frames", (unsigned long)ptime_ms);
+        uplink_ptime_request = uplink_ptime_ms;
+        return;
+    }
+    uplink_ptime_ms = ptime_ms;
+    vad_set_frame(&vad, ptime_ms);
+    rtp_stamp_set_step(&uplink_stamps, RTP_CLOCK_RATE * ptime_ms / 1000);
+    log_ptime_cost(ptime_ms);
+}
 
-void oai_send_audio(PeerConnection *peer_connection) {
-//   size_t bytes_read = 0;
+void oai_init_audio_encoder() {
+    log_ptime_cost(uplink_ptime_ms);
+#ifdef AUDIO_CODEC_OPUS
+    opus_codec_config_t config = {SAMPLE_RATE, OPUS_ENCODER_BITRATE, OPUS_ENCODER_COMPLEXITY,
+                                  OPUS_ENCODER_EXPECTED_LOSS};
+    void *state = media_memory_alloc(MEDIA_MEMORY_INTERNAL, opus_codec_encoder_size(),
+                                     "opus encoder");
+    if (state == NULL || !opus_codec_encoder_init(&opus_uplink, &config, state)) {
+        ESP_LOGE(LOG_TAG, "Failed to create Opus encoder");
+    }
+#endif
+}
 
-//   int16_t buf[BUFFER_SAMPLES];
-//   i2s_read(I2S_NUM_0, buf, BUFFER_SAMPLES*sizeof(int16_t), &bytes_read,
-//            portMAX_DELAY);
-//   // ESP_LOGI(LOG_TAG, "READ BYTE: %d", bytes_read);
-//   uint8_t pcmaBuf[bytes_read/sizeof(int16_t)];
-//   lin2alaw(buf, pcmaBuf, 1, 1, bytes_read/sizeof(int16_t));
-//   // auto encoded_size =
-//   //     opus_encode(opus_encoder, encoder_input_buffer, BUFFER_SAMPLES / 2,
-//   //                 encoder_output_buffer, OPUS_OUT_BUFFER_SIZE);
+// Blocks on the microphone DMA, so the caller is paced by the ADC clock and
+// sends one packet per ptime. True if this pass queued a frame in libpeer.
+bool oai_send_audio(PeerConnection *peer_connection) {
+    apply_uplink_ptime();
+    if (uplink_restart_request.exchange(false)) {
+        rtp_stamp_restart(&uplink_stamps);
+    }
+    capture.user_data = peer_connection;
+    uplink_queued = false;
+    if (!audio_capture_step(&capture)) {
+        ESP_LOGW(LOG_TAG, "Audio capture read timed out");
+    }
+    if (capture.stats.dropped_samples > 0) {
+        ESP_LOGW(LOG_TAG, "Audio capture dropped %lu samples, discarded %lu around the gap",
+                 (unsigned long)capture.stats.dropped_samples,
+                 (unsigned long)capture.stats.discarded_samples);
+        capture.stats.dropped_samples = 0;
+        capture.stats.discarded_samples = 0;
+    }
 
-//   peer_connection_send_audio(peer_connection, pcmaBuf,
-//                              bytes_read/sizeof(int16_t));
+    static int64_t last_report = 0;
+    int64_t now = esp_timer_get_time();
+    if (now - last_report >= CAPTURE_STATS_INTERVAL_US) {
+        last_report = now;
+        ESP_LOGI(LOG_TAG, "vad: speech %lu frames, silence %lu, suppressed %lu, saved %lu B",
+                 (unsigned long)vad.stats.speech_frames, (unsigned long)vad.stats.silence_frames,
+                 (unsigned long)vad.stats.suppressed_frames, (unsigned long)vad.stats.bytes_saved);
+        const rtp_stamp_stats_t *stamps = &uplink_stamps.stats;
+        if (stamps->unmatched > 0 || stamps->full > 0) {
+            ESP_LOGW(LOG_TAG, "rtp stamps: applied %lu, unmatched %lu, full %lu",
+                     (unsigned long)stamps->applied, (unsigned long)stamps->unmatched,
+                     (unsigned long)stamps->full);
+        }
+    }
+    return uplink_queued;
 }
-
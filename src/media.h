@@ -4,12 +4,67 @@
 #include <stddef.h>
 #include <stdint.h>
 
+// Codec negotiated for both directions. Opus runs at OPUS_SAMPLE_RATE locally;
+// its RTP clock is always 48kHz.
+#ifdef AUDIO_CODEC_OPUS
+#define OAI_AUDIO_CODEC CODEC_OPUS
+#else
+#define OAI_AUDIO_CODEC CODEC_PCMA
+#endif
+
+#ifndef OPUS_SAMPLE_RATE
+#define OPUS_SAMPLE_RATE 16000
+#endif
+#ifndef OPUS_ENCODER_BITRATE
+#define OPUS_ENCODER_BITRATE 20000
+#endif
+#ifndef OPUS_ENCODER_COMPLEXITY
+#define OPUS_ENCODER_COMPLEXITY 0
+#endif
+
+// Default packetization time, offered to the server as a=ptime. The
+// microphone is cut into frames this long and each is encoded into one RTP
+// packet, so the publisher sends one packet per pass. 10, 20, 40 or 60ms.
+// Each session may pick another with oai_audio_set_ptime.
+#ifndef AUDIO_PTIME_MS
+#define AUDIO_PTIME_MS 20
+#endif
+#if AUDIO_PTIME_MS != 10 && AUDIO_PTIME_MS != 20 && AUDIO_PTIME_MS != 40 && \
+    AUDIO_PTIME_MS != 60
+#error "AUDIO_PTIME_MS must be 10, 20, 40 or 60"
+#endif
+
 // 初始化RingBuffer
 void init_ringbuffer(void);
 
 // 启动I2S任务
 void start_i2s_task(void);
 
+// Queues one received RTP payload in the jitter buffer
+void oai_audio_receive(uint8_t *data, size_t size);
+
+// Barge-in: drops queued downlink audio, silent within one device period
+void oai_audio_interrupt(void);
+
+// Uplink packetization time from the publisher's next pass on. False if it
+// is not one of the values above.
+bool oai_audio_set_ptime(uint32_t ptime_ms);
+
+// Call once the session's peer connection is destroyed: the next one numbers
+// its uplink packets afresh.
+void oai_audio_restart_uplink(void);
+
+// A new output item began: its audio starts with the next downlink frame.
+void oai_audio_item_started(void);
+
+// How much of that item has come out of the speaker, 0 until its first sample
+// has.
+uint32_t oai_audio_item_played_ms(void);
+
+// Latency histograms and queue gauges as one JSON object. Returns its length,
+// 0 if `size` is too small.
+size_t oai_audio_latency_json(char *out, size_t size);
+
 // 音频解码函数
 void oai_audio_decode(uint8_t *data, size_t size);
 
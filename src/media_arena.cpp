@@ -0,0 +1,34 @@
+#include "media_arena.h"
+
+#include <string.h>
+
+void media_arena_init(media_arena_t *arena, const char *name, void *base,
+                      size_t size) {
+  arena->name = name;
+  arena->base = (uint8_t *)base;
+  arena->size = size;
+  arena->used = 0;
+  arena->allocations = 0;
+  arena->failures = 0;
+  arena->sealed = false;
+}
+
+void *media_arena_alloc(media_arena_t *arena, size_t size) {
+  size_t rounded =
+      (size + MEDIA_ARENA_ALIGN - 1) & ~(size_t)(MEDIA_ARENA_ALIGN - 1);
+  size_t offset = arena->used.load(std::memory_order_relaxed);
+  do {
+    if (arena->sealed || rounded > arena->size - offset) {
+      arena->failures++;
+      return NULL;
+    }
+  } while (!arena->used.compare_exchange_weak(offset, offset + rounded));
+
+  arena->allocations++;
+  memset(arena->base + offset, 0, rounded);
+  return arena->base + offset;
+}
+
+void media_arena_seal(media_arena_t *arena) {
+  arena->sealed = true;
+}
@@ -0,0 +1,41 @@
+#ifndef OAI_MEDIA_ARENA_H
+#define OAI_MEDIA_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// Bump allocator over one fixed block of memory. Everything the media path
+// needs is carved out of an arena while the device boots; nothing is ever
+// returned, so `used` is also the arena's high-water mark. Once sealed every
+// request fails and is counted, which makes a stray runtime allocation show
+// up in the memory report instead of fragmenting the heap.
+//
+// Allocation is lock-free, so tasks starting in parallel at boot may share
+// an arena.
+
+#define MEDIA_ARENA_ALIGN 16  // Enough for any type and for DMA descriptors
+
+typedef struct {
+  const char *name;
+  uint8_t *base;
+  size_t size;
+  std::atomic<size_t> used;
+  std::atomic<uint32_t> allocations;
+  std::atomic<uint32_t> failures;  // Requests that did not fit or came late
+  std::atomic<bool> sealed;
+} media_arena_t;
+
+// `base` must be MEDIA_ARENA_ALIGN aligned and hold `size` bytes.
+void media_arena_init(media_arena_t *arena, const char *name, void *base,
+                      size_t size);
+
+// Returns zeroed memory aligned to MEDIA_ARENA_ALIGN, or NULL once the arena
+// is full or sealed.
+void *media_arena_alloc(media_arena_t *arena, size_t size);
+
+// Ends startup: later allocations fail.
+void media_arena_seal(media_arena_t *arena);
+
+#endif  // OAI_MEDIA_ARENA_H
@@ -0,0 +1,155 @@
+#include "media_memory.h"
+
+#include <esp_log.h>
+
+#include <atomic>
+
+#include "main.h"
+#include "media_arena.h"
+
+#ifndef LINUX_BUILD
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#else
+#define EXT_RAM_BSS_ATTR
+#endif
+
+// Sized for the largest configuration: a playback ring for a 48kHz DAC, the
+// I2S stack and, with Opus, its encoder and decoder state and the 16KB stack
+// the I2S task decodes on. The report after boot shows how much is left.
+#ifndef MEDIA_MEMORY_INTERNAL_SIZE
+#ifdef AUDIO_CODEC_OPUS
+#define MEDIA_MEMORY_INTERNAL_SIZE (112 * 1024)
+#else
+#define MEDIA_MEMORY_INTERNAL_SIZE (48 * 1024)
+#endif
+#endif
+
+// The jitter buffer and the publisher and console stacks.
+#ifndef MEDIA_MEMORY_PSRAM_SIZE
+#define MEDIA_MEMORY_PSRAM_SIZE (96 * 1024)
+#endif
+
+#define MEDIA_MEMORY_MAX_TASKS 8
+
+static uint8_t internal_storage[MEDIA_MEMORY_INTERNAL_SIZE]
+    __attribute__((aligned(MEDIA_ARENA_ALIGN)));
+EXT_RAM_BSS_ATTR static uint8_t psram_storage[MEDIA_MEMORY_PSRAM_SIZE]
+    __attribute__((aligned(MEDIA_ARENA_ALIGN)));
+
+static media_arena_t arenas[MEDIA_MEMORY_REGIONS];
+
+typedef struct {
+  TaskHandle_t handle;
+  uint32_t stack_size;
+} watched_task_t;
+
+static watched_task_t watched[MEDIA_MEMORY_MAX_TASKS];
+static std::atomic<int> watched_count(0);
+
+#ifndef LINUX_BUILD
+// Task control blocks must be in internal RAM whatever the stack is in.
+static StaticTask_t task_buffers[MEDIA_MEMORY_MAX_TASKS];
+static std::atomic<int> task_buffers_used(0);
+#endif
+
+void media_memory_init(void) {
+  media_arena_init(&arenas[MEDIA_MEMORY_INTERNAL], "internal",
+                   internal_storage, sizeof(internal_storage));
+  media_arena_init(&arenas[MEDIA_MEMORY_PSRAM], "psram", psram_storage,
+                   sizeof(psram_storage));
+}
+
+void *media_memory_alloc(media_memory_region_t region, size_t size,
+                         const char *what) {
+  media_arena_t *arena = &arenas[region];
+  void *memory = media_arena_alloc(arena, size);
+  if (memory == NULL) {
+    ESP_LOGE(LOG_TAG, "No room for %s (%lu B) in the %s arena%s", what,
+             (unsigned long)size, arena->name,
+             arena->sealed ? ", allocated after startup" : "");
+  }
+  return memory;
+}
+
+void media_memory_watch_task(TaskHandle_t task, uint32_t stack_size) {
+  int index = watched_count.fetch_add(1);
+  if (task == NULL || index >= MEDIA_MEMORY_MAX_TASKS) {
+    watched_count--;
+    return;
+  }
+  watched[index].handle = task;
+  watched[index].stack_size = stack_size;
+}
+
+TaskHandle_t media_memory_create_task(TaskFunction_t task, const char *name,
+                                      uint32_t stack_size, void *arg,
+                                      UBaseType_t priority, BaseType_t core,
+                                      media_memory_region_t stack_region) {
+  TaskHandle_t handle = NULL;
+#ifndef LINUX_BUILD
+  StackType_t *stack =
+      (StackType_t *)media_memory_alloc(stack_region, stack_size, name);
+  int index = task_buffers_used.fetch_add(1);
+  if (stack == NULL || index >= MEDIA_MEMORY_MAX_TASKS) {
+    ESP_LOGE(LOG_TAG, "Cannot create task %s", name);
+    return NULL;
+  }
+  handle = xTaskCreateStaticPinnedToCore(task, name, stack_size, arg, priority,
+                                         stack, &task_buffers[index], core);
+#else
+  // Tasks are threads on linux; their stacks are not ours to place.
+  (void)stack_region;
+  xTaskCreatePinnedToCore(task, name, stack_size, arg, priority, &handle,
+                          core);
+#endif
+  media_memory_watch_task(handle, stack_size);
+  return handle;
+}
+
+void media_memory_seal(void) {
+  for (int i = 0; i < MEDIA_MEMORY_REGIONS; i++) {
+    media_arena_seal(&arenas[i]);
+  }
+}
+
+void media_memory_log(void) {
+  for (int i = 0; i < MEDIA_MEMORY_REGIONS; i++) {
+    const media_arena_t *arena = &arenas[i];
+    ESP_LOGI(LOG_TAG,
+             "memory: %-8s arena %6lu/%6lu B in %lu blocks, %lu refused",
+             arena->name, (unsigned long)arena->used.load(),
+             (unsigned long)arena->size,
+             (unsigned long)arena->allocations.load(),
+             (unsigned long)arena->failures.load());
+  }
+
+#ifndef LINUX_BUILD
+  static const struct {
+    const char *name;
+    uint32_t caps;
+  } heaps[] = {
+      {"internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT},
+      {"psram", MALLOC_CAP_SPIRAM},
+  };
+  for (size_t i = 0; i < sizeof(heaps) / sizeof(heaps[0]); i++) {
+    ESP_LOGI(LOG_TAG,
+             "memory: %-8s heap  free %7lu B, low-water %7lu B, "
+             "largest block %7lu B",
+             heaps[i].name,
+             (unsigned long)heap_caps_get_free_size(heaps[i].caps),
+             (unsigned long)heap_caps_get_minimum_free_size(heaps[i].caps),
+             (unsigned long)heap_caps_get_largest_free_block(heaps[i].caps));
+  }
+
+  int count = watched_count;
+  for (int i = 0; i < count && i < MEDIA_MEMORY_MAX_TASKS; i++) {
+    // ESP-IDF counts stacks in bytes.
+    uint32_t unused = uxTaskGetStackHighWaterMark(watched[i].handle);
+    ESP_LOGI(LOG_TAG, "memory: task %-16s stack %5lu B, peak %5lu B",
+             pcTaskGetName(watched[i].handle),
+             (unsigned long)watched[i].stack_size,
+             (unsigned long)(watched[i].stack_size - unused));
+  }
+#endif
+}
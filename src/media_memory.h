@@ -0,0 +1,54 @@
+#ifndef OAI_MEDIA_MEMORY_H
+#define OAI_MEDIA_MEMORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// The device's media memory plan. Every buffer, codec state and task stack
+// the media path needs comes from one of two static arenas carved out while
+// the device boots:
+//
+//   internal  touched every period by the CPU or DMA: the playback ring,
+//             codec state, the I2S task's stack
+//   psram     large and touched once per packet or rarely: the jitter
+//             buffer, the publisher and console stacks
+//
+// The arenas are sealed once audio is up, so the heap that is left belongs
+// to Wi-Fi, TLS and libpeer and does not fragment while sessions come and
+// go. On linux both arenas are plain static memory.
+
+typedef enum {
+  MEDIA_MEMORY_INTERNAL,
+  MEDIA_MEMORY_PSRAM,
+  MEDIA_MEMORY_REGIONS,
+} media_memory_region_t;
+
+// Must run before any other media_memory call.
+void media_memory_init(void);
+
+// Zeroed memory from `region`, NULL with an error naming `what` if the
+// region is full or already sealed.
+void *media_memory_alloc(media_memory_region_t region, size_t size,
+                         const char *what);
+
+// Creates a pinned task whose stack comes from `stack_region` and watches its
+// stack. `stack_size` is in bytes.
+TaskHandle_t media_memory_create_task(TaskFunction_t task, const char *name,
+                                      uint32_t stack_size, void *arg,
+                                      UBaseType_t priority, BaseType_t core,
+                                      media_memory_region_t stack_region);
+
+// Adds a task created elsewhere, e.g. the main task, to the stack report.
+void media_memory_watch_task(TaskHandle_t task, uint32_t stack_size);
+
+// Ends startup: from here on every allocation from an arena fails.
+void media_memory_seal(void);
+
+// Logs arena use, heap low-water marks per capability and the unused stack
+// of every watched task.
+void media_memory_log(void);
+
+#endif  // OAI_MEDIA_MEMORY_H
@@ -0,0 +1,96 @@
+#include "network_wait.h"
+
+// Queued frames the loop still drains one pass at a time after a stall;
+// anything older has been sent by libpeer in between or is stale anyway.
+#define NETWORK_WAIT_MAX_BACKLOG 4
+
+// How fast the phase estimate forgets a slow pass, per pass. Also covers the
+// microphone clock running up to 1000ppm fast against the CPU timer.
+#define NETWORK_WAIT_PHASE_DECAY_US 20
+
+void network_wait_init(network_wait_t *wait, uint32_t frame_ms) {
+  wait->frame_us = frame_ms * 1000;
+  wait->passes_seen = 0;
+  wait->phase_us = 0;
+  wait->phase_valid = false;
+  wait->woken = false;
+  wait->last_wait_ms = 0;
+  wait->stats = {};
+}
+
+void network_wait_set_woken(network_wait_t *wait, bool woken) {
+  wait->woken = woken;
+}
+
+void network_wait_set_frame(network_wait_t *wait, uint32_t frame_ms) {
+  wait->frame_us = frame_ms * 1000;
+  wait->phase_valid = false;
+}
+
+static uint32_t until_ms(int64_t deadline_us, int64_t now_us) {
+  int64_t ms = (deadline_us - now_us + 999) / 1000;
+  return ms > NETWORK_WAIT_IDLE_MS ? NETWORK_WAIT_IDLE_MS : (uint32_t)ms;
+}
+
+uint32_t network_wait_next(network_wait_t *wait, bool connected,
+                           uint32_t passes, int64_t last_pass_us,
+                           int64_t now_us) {
+  if (!connected) {
+    // Passes made before the session was up queued nothing.
+    wait->passes_seen = passes;
+    wait->phase_valid = false;
+    wait->last_wait_ms = NETWORK_WAIT_HANDSHAKE_MS;
+    return wait->last_wait_ms;
+  }
+
+  // This pass sends one queued frame before it selects.
+  uint32_t backlog = passes - wait->passes_seen;
+  if (backlog > NETWORK_WAIT_MAX_BACKLOG) {
+    backlog = NETWORK_WAIT_MAX_BACKLOG;
+    wait->passes_seen = passes - backlog;
+  }
+  if (backlog > 0) {
+    wait->passes_seen++;
+    wait->stats.uplink++;
+    int64_t phase = last_pass_us - (int64_t)passes * wait->frame_us;
+    int64_t decayed = wait->phase_us - NETWORK_WAIT_PHASE_DECAY_US;
+    wait->phase_us = !wait->phase_valid || phase > decayed ? phase : decayed;
+    wait->phase_valid = true;
+  }
+
+  uint32_t ms;
+  if (backlog > 1) {
+    wait->stats.drains++;
+    ms = 0;
+  } else if (!wait->phase_valid) {
+    ms = NETWORK_WAIT_IDLE_MS;
+  } else {
+    int64_t due = wait->phase_us + (int64_t)(passes + 1) * wait->frame_us;
+    if (wait->woken) {
+      // Only a lost wake lets this run out, so no early or retry polls.
+      int64_t fallback = due + wait->frame_us;
+      ms = now_us < fallback ? until_ms(fallback, now_us)
+                             : NETWORK_WAIT_IDLE_MS;
+    } else if (now_us < due) {
+      ms = until_ms(due, now_us);
+    } else if (now_us - due < wait->frame_us) {
+      ms = 1;  // The pass is running late; check back shortly
+    } else {
+      ms = NETWORK_WAIT_IDLE_MS;  // The publisher is not running
+    }
+  }
+  wait->last_wait_ms = ms;
+  return ms;
+}
+
+void network_wait_done(network_wait_t *wait, int64_t elapsed_us) {
+  wait->stats.iterations++;
+  if (wait->last_wait_ms == 0) {
+    return;
+  }
+  if (elapsed_us < (int64_t)wait->last_wait_ms * 1000) {
+    wait->stats.socket_wakeups++;
+  } else {
+    wait->stats.timeouts++;
+  }
+}
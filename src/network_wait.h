@@ -0,0 +1,63 @@
+#ifndef OAI_NETWORK_WAIT_H
+#define OAI_NETWORK_WAIT_H
+
+#include <stdint.h>
+
+// Picks how long each pass of the network loop blocks. libpeer selects on
+// the ICE socket inside peer_connection_loop, so that select is the only
+// place the loop sleeps: a packet arriving wakes it at once, and the timeout
+// is what brings it back for work the socket cannot announce.
+//
+// The one such source of work is the uplink. The publisher queues a frame
+// every pass, paced by the microphone, and libpeer only sends it from the
+// loop, one per pass and before it selects. The publisher wakes the select
+// itself once a frame is queued (see network_wake.h); the wait is then only
+// a fallback for a lost wake and ends a frame after the next pass is due.
+// Without a wake it ends when the next publisher pass is due. Either way it
+// is zero while more than one queued frame has not been looped over yet.
+// Passes end on the microphone's clock plus however long encoding took, so
+// "due" is the latest phase seen recently: waking earlier would only find the
+// encoder still busy. Before the session is connected, ICE and DTLS
+// retransmits are driven by loop passes, so those keep a short poll and the
+// caller keeps its fixed tick.
+
+#define NETWORK_WAIT_HANDSHAKE_MS 1  // Poll while the tick paces the handshake
+#define NETWORK_WAIT_IDLE_MS 100     // Connected, but no uplink running
+
+typedef struct {
+  uint32_t iterations;
+  uint32_t socket_wakeups;  // Ended before their timeout: a packet arrived
+  uint32_t timeouts;
+  uint32_t uplink;  // Passes that found a new uplink frame queued
+  uint32_t drains;  // Of those, zero waits to catch up on a backlog
+} network_wait_stats_t;
+
+typedef struct {
+  uint32_t frame_us;       // Uplink pass period
+  uint32_t passes_seen;    // Publisher passes the loop has accounted for
+  int64_t phase_us;        // When pass 0 would have ended, latest recent
+  bool phase_valid;
+  bool woken;              // The publisher wakes the select
+  uint32_t last_wait_ms;
+  network_wait_stats_t stats;
+} network_wait_t;
+
+void network_wait_init(network_wait_t *wait, uint32_t frame_ms);
+
+// A new uplink period, e.g. for a session with another ptime. Stats carry
+// on; the phase is learned again.
+void network_wait_set_frame(network_wait_t *wait, uint32_t frame_ms);
+
+// Whether the publisher wakes the select when it queues a frame.
+void network_wait_set_woken(network_wait_t *wait, bool woken);
+
+// Timeout for the next select, in ms. `passes` counts the publisher's passes
+// and `last_pass_us` is when the latest one ended, 0 if none yet.
+uint32_t network_wait_next(network_wait_t *wait, bool connected,
+                           uint32_t passes, int64_t last_pass_us,
+                           int64_t now_us);
+
+// Accounts a loop pass that took `elapsed_us` against the wait it was given.
+void network_wait_done(network_wait_t *wait, int64_t elapsed_us);
+
+#endif  // OAI_NETWORK_WAIT_H
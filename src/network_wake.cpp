@@ -0,0 +1,83 @@
+#include "network_wake.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define STUN_BINDING_INDICATION 0x0011
+#define STUN_MAGIC_COOKIE 0x2112A442
+
+void network_wake_init(network_wake_t *wake) {
+  memset(wake, 0, sizeof(*wake));
+  wake->fd = -1;
+}
+
+// "a=candidate:<foundation> <component> <transport> <priority> <address>
+// <port> typ host", IPv4 and UDP only: that is the socket libpeer selects on.
+static bool host_candidate(const char *line, uint32_t *address,
+                           uint16_t *port) {
+  char transport[8], ip[64], type[16];
+  unsigned int candidate_port;
+  if (sscanf(line, "a=candidate:%*s %*u %7s %*u %63s %u typ %15s", transport,
+             ip, &candidate_port, type) != 4 ||
+      strcasecmp(transport, "udp") != 0 || strcmp(type, "host") != 0 ||
+      candidate_port == 0 || candidate_port > 0xFFFF) {
+    return false;
+  }
+  struct in_addr in;
+  if (inet_pton(AF_INET, ip, &in) != 1) {
+    return false;
+  }
+  *address = in.s_addr;
+  *port = htons((uint16_t)candidate_port);
+  return true;
+}
+
+bool network_wake_open(network_wake_t *wake, const char *sdp) {
+  network_wake_close(wake);
+  bool found = false;
+  for (const char *line = strstr(sdp, "a=candidate:"); line != NULL && !found;
+       line = strstr(line + 1, "a=candidate:")) {
+    found = host_candidate(line, &wake->address, &wake->port);
+  }
+  if (!found) {
+    return false;
+  }
+  wake->fd = socket(AF_INET, SOCK_DGRAM, 0);
+  return wake->fd >= 0;
+}
+
+void network_wake_signal(network_wake_t *wake) {
+  if (wake->fd < 0) {
+    return;
+  }
+  uint8_t message[NETWORK_WAKE_BYTES] = {};
+  message[0] = STUN_BINDING_INDICATION >> 8;
+  message[1] = STUN_BINDING_INDICATION & 0xFF;
+  uint32_t cookie = htonl(STUN_MAGIC_COOKIE);
+  memcpy(message + 4, &cookie, sizeof(cookie));
+  // Indications need a transaction ID too; a counter is unique enough.
+  uint32_t transaction = ++wake->transaction;
+  memcpy(message + 8, &transaction, sizeof(transaction));
+
+  struct sockaddr_in to = {};
+  to.sin_family = AF_INET;
+  to.sin_addr.s_addr = wake->address;
+  to.sin_port = wake->port;
+  if (sendto(wake->fd, message, sizeof(message), MSG_DONTWAIT,
+             (struct sockaddr *)&to, sizeof(to)) == sizeof(message)) {
+    wake->stats.sent++;
+  } else {
+    wake->stats.failed++;
+  }
+}
+
+void network_wake_close(network_wake_t *wake) {
+  if (wake->fd >= 0) {
+    close(wake->fd);
+    wake->fd = -1;
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef OAI_NETWORK_WAKE_H
+#define OAI_NETWORK_WAKE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Ends libpeer's select on the ICE socket from another task. libpeer owns
+// that socket and its fd set, so the publisher wakes it the way a packet
+// would: it sends a datagram to the socket's own host candidate. The
+// datagram is a STUN Binding Indication, which ICE agents read and ignore as
+// a keepalive (RFC 7675), so it costs libpeer one empty loop pass.
+
+#define NETWORK_WAKE_BYTES 20  // A STUN header with no attributes
+
+typedef struct {
+  uint32_t sent;
+  uint32_t failed;  // sendto errors, e.g. a full socket buffer
+} network_wake_stats_t;
+
+typedef struct {
+  int fd;  // -1 while closed
+  uint32_t address;  // IPv4, network order
+  uint16_t port;     // Network order
+  uint32_t transaction;
+  network_wake_stats_t stats;
+} network_wake_t;
+
+void network_wake_init(network_wake_t *wake);
+
+// Finds the first IPv4 host candidate in `sdp` and opens a socket aimed at
+// it. False if there is none or no socket could be made; signals are then
+// dropped and the caller's select timeouts alone pace the loop.
+bool network_wake_open(network_wake_t *wake, const char *sdp);
+
+// Never blocks. Safe against network_wake_open/close only if the caller
+// keeps them apart, as the session does with its publisher.
+void network_wake_signal(network_wake_t *wake);
+
+void network_wake_close(network_wake_t *wake);
+
+#endif  // OAI_NETWORK_WAKE_H
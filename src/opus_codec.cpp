@@ -0,0 +1,118 @@
+#include "opus_codec.h"
+
+#include <stdlib.h>
+
+size_t opus_codec_encoder_size(void) {
+  return opus_encoder_get_size(1);
+}
+
+bool opus_codec_encoder_init(opus_codec_encoder_t *codec,
+                             const opus_codec_config_t *config, void *state) {
+  codec->sample_rate = config->sample_rate;
+  codec->owns_encoder = state == NULL;
+  codec->encoder = (OpusEncoder *)(state != NULL
+                                       ? state
+                                       : malloc(opus_codec_encoder_size()));
+  if (codec->encoder == NULL) {
+    return false;
+  }
+  if (opus_encoder_init(codec->encoder, config->sample_rate, 1,
+                        OPUS_APPLICATION_VOIP) != OPUS_OK) {
+    opus_codec_encoder_free(codec);
+    return false;
+  }
+
+  opus_encoder_ctl(codec->encoder, OPUS_SET_BITRATE(config->bitrate));
+  opus_encoder_ctl(codec->encoder, OPUS_SET_COMPLEXITY(config->complexity));
+  opus_encoder_ctl(codec->encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+  opus_encoder_ctl(codec->encoder,
+                   OPUS_SET_INBAND_FEC(config->expected_loss > 0 ? 1 : 0));
+  opus_encoder_ctl(codec->encoder,
+                   OPUS_SET_PACKET_LOSS_PERC(config->expected_loss));
+  return true;
+}
+
+int opus_codec_encode(opus_codec_encoder_t *codec, const int16_t *samples,
+                      size_t count) {
+  int size = opus_encode(codec->encoder, samples, (int)count, codec->packet,
+                         sizeof(codec->packet));
+  return size < 0 ? -1 : size;
+}
+
+void opus_codec_encoder_free(opus_codec_encoder_t *codec) {
+  if (codec->owns_encoder) {
+    free(codec->encoder);
+  }
+  codec->encoder = NULL;
+}
+
+size_t opus_codec_decoder_size(void) {
+  return opus_decoder_get_size(1);
+}
+
+bool opus_codec_decoder_init(opus_codec_decoder_t *codec, uint32_t sample_rate,
+                             int gain_db_q8, void *state) {
+  codec->sample_rate = sample_rate;
+  codec->frame_samples = sample_rate / 50;
+  codec->owns_decoder = state == NULL;
+  codec->decoder = (OpusDecoder *)(state != NULL
+                                       ? state
+                                       : malloc(opus_codec_decoder_size()));
+  if (codec->decoder == NULL) {
+    return false;
+  }
+  if (opus_decoder_init(codec->decoder, sample_rate, 1) != OPUS_OK) {
+    opus_codec_decoder_free(codec);
+    return false;
+  }
+  opus_decoder_ctl(codec->decoder, OPUS_SET_GAIN(gain_db_q8));
+  return true;
+}
+
+int opus_codec_packet_samples(const opus_codec_decoder_t *codec,
+                              const uint8_t *packet, size_t size) {
+  int samples = opus_packet_get_nb_samples(packet, (opus_int32)size,
+                                           (opus_int32)codec->sample_rate);
+  return samples < 0 ? -1 : samples;
+}
+
+int opus_codec_decode(opus_codec_decoder_t *codec, const uint8_t *packet,
+                      size_t size, int16_t *samples, size_t max_samples) {
+  int decoded = opus_decode(codec->decoder, packet, (opus_int32)size, samples,
+                            (int)max_samples, 0);
+  if (decoded < 0) {
+    return -1;
+  }
+  codec->frame_samples = decoded;
+  return decoded;
+}
+
+// FEC and PLC must be asked for exactly the duration that went missing, which
+// we assume matches the last frame we decoded.
+int opus_codec_decode_fec(opus_codec_decoder_t *codec,
+                          const uint8_t *next_packet, size_t size,
+                          int16_t *samples, size_t max_samples) {
+  if (codec->frame_samples > max_samples) {
+    return -1;
+  }
+  int decoded = opus_decode(codec->decoder, next_packet, (opus_int32)size,
+                            samples, (int)codec->frame_samples, 1);
+  return decoded < 0 ? -1 : decoded;
+}
+
+int opus_codec_conceal(opus_codec_decoder_t *codec, int16_t *samples,
+                       size_t max_samples) {
+  if (codec->frame_samples > max_samples) {
+    return -1;
+  }
+  int decoded = opus_decode(codec->decoder, NULL, 0, samples,
+                            (int)codec->frame_samples, 0);
+  return decoded < 0 ? -1 : decoded;
+}
+
+void opus_codec_decoder_free(opus_codec_decoder_t *codec) {
+  if (codec->owns_decoder) {
+    free(codec->decoder);
+  }
+  codec->decoder = NULL;
+}
@@ -0,0 +1,79 @@
+#ifndef OAI_OPUS_CODEC_H
+#define OAI_OPUS_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <opus.h>
+
+#define OPUS_CODEC_MAX_PACKET 1276  // Largest packet opus_encode can produce
+#define OPUS_CODEC_MAX_FRAME 1440   // 60ms at 24kHz
+#define OPUS_CODEC_MAX_DECODE 1440  // 60ms at 24kHz, longest packet we accept
+
+typedef struct {
+  uint32_t sample_rate;  // 16000 or 24000 for wideband speech
+  int bitrate;           // bits/s
+  int complexity;        // 0-10, CPU against quality
+  int expected_loss;     // Percent; above 0 enables in-band FEC
+} opus_codec_config_t;
+
+// Encoder state lives in one block handed over or allocated at init;
+// encoding never allocates and writes into the preallocated `packet`.
+typedef struct {
+  OpusEncoder *encoder;
+  bool owns_encoder;
+  uint32_t sample_rate;
+  uint8_t packet[OPUS_CODEC_MAX_PACKET];
+} opus_codec_encoder_t;
+
+// Bytes of encoder state, for callers that place it themselves.
+size_t opus_codec_encoder_size(void);
+
+// `state` holds opus_codec_encoder_size() bytes owned by the caller, or is
+// NULL to have it allocated here and released by opus_codec_encoder_free.
+bool opus_codec_encoder_init(opus_codec_encoder_t *codec,
+                             const opus_codec_config_t *config, void *state);
+
+// Encodes one frame of `count` samples (2.5-60ms at the configured rate) into
+// codec->packet. Returns the packet size, or -1 on error.
+int opus_codec_encode(opus_codec_encoder_t *codec, const int16_t *samples,
+                      size_t count);
+
+void opus_codec_encoder_free(opus_codec_encoder_t *codec);
+
+typedef struct {
+  OpusDecoder *decoder;
+  bool owns_decoder;
+  uint32_t sample_rate;
+  size_t frame_samples;  // Duration of the last decoded frame
+} opus_codec_decoder_t;
+
+size_t opus_codec_decoder_size(void);
+
+// `gain_db_q8` is applied by the decoder, in 1/256 dB. `state` works as for
+// the encoder.
+bool opus_codec_decoder_init(opus_codec_decoder_t *codec, uint32_t sample_rate,
+                             int gain_db_q8, void *state);
+
+// Samples `packet` will decode to, or -1 if it is malformed.
+int opus_codec_packet_samples(const opus_codec_decoder_t *codec,
+                              const uint8_t *packet, size_t size);
+
+// Each decode writes one frame to `samples` (room for `max_samples`) and
+// returns the samples written, or -1 on error.
+int opus_codec_decode(opus_codec_decoder_t *codec, const uint8_t *packet,
+                      size_t size, int16_t *samples, size_t max_samples);
+
+// Rebuilds the frame before `next_packet` from the redundancy the encoder
+// put in it. Falls back to PLC if the packet carries none.
+int opus_codec_decode_fec(opus_codec_decoder_t *codec,
+                          const uint8_t *next_packet, size_t size,
+                          int16_t *samples, size_t max_samples);
+
+// Extrapolates a missing frame from decoder state (packet-loss concealment).
+int opus_codec_conceal(opus_codec_decoder_t *codec, int16_t *samples,
+                       size_t max_samples);
+
+void opus_codec_decoder_free(opus_codec_decoder_t *codec);
+
+#endif  // OAI_OPUS_CODEC_H
@@ -0,0 +1,65 @@
+#include "pcm_ring.h"
+
+bool pcm_ring_init(pcm_ring_t *ring, int16_t *storage, size_t capacity) {
+  if (storage == NULL || capacity == 0 || (capacity & (capacity - 1)) != 0) {
+    return false;
+  }
+  ring->samples = storage;
+  ring->capacity = capacity;
+  ring->head.store(0, std::memory_order_relaxed);
+  ring->tail.store(0, std::memory_order_relaxed);
+  return true;
+}
+
+size_t pcm_ring_available(const pcm_ring_t *ring) {
+  return ring->head.load(std::memory_order_acquire) -
+         ring->tail.load(std::memory_order_acquire);
+}
+
+size_t pcm_ring_free(const pcm_ring_t *ring) {
+  return ring->capacity - pcm_ring_available(ring);
+}
+
+int16_t *pcm_ring_acquire_write(pcm_ring_t *ring, size_t *count) {
+  size_t head = ring->head.load(std::memory_order_relaxed);
+  size_t tail = ring->tail.load(std::memory_order_acquire);
+  size_t offset = head & (ring->capacity - 1);
+
+  size_t granted = ring->capacity - (head - tail);
+  if (granted > ring->capacity - offset) {
+    granted = ring->capacity - offset;
+  }
+  if (granted > *count) {
+    granted = *count;
+  }
+
+  *count = granted;
+  return granted == 0 ? NULL : ring->samples + offset;
+}
+
+void pcm_ring_commit_write(pcm_ring_t *ring, size_t count) {
+  ring->head.store(ring->head.load(std::memory_order_relaxed) + count,
+                   std::memory_order_release);
+}
+
+const int16_t *pcm_ring_acquire_read(pcm_ring_t *ring, size_t *count) {
+  size_t tail = ring->tail.load(std::memory_order_relaxed);
+  size_t head = ring->head.load(std::memory_order_acquire);
+  size_t offset = tail & (ring->capacity - 1);
+
+  size_t granted = head - tail;
+  if (granted > ring->capacity - offset) {
+    granted = ring->capacity - offset;
+  }
+  if (granted > *count) {
+    granted = *count;
+  }
+
+  *count = granted;
+  return granted == 0 ? NULL : ring->samples + offset;
+}
+
+void pcm_ring_commit_read(pcm_ring_t *ring, size_t count) {
+  ring->tail.store(ring->tail.load(std::memory_order_relaxed) + count,
+                   std::memory_order_release);
+}
@@ -0,0 +1,37 @@
+#ifndef OAI_PCM_RING_H
+#define OAI_PCM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// Single-producer/single-consumer ring of PCM16 samples. Both sides work on
+// the ring storage directly: the producer acquires a contiguous region,
+// writes samples into it and commits; the consumer does the same for reading.
+// Nothing is copied in or out by the ring itself.
+typedef struct {
+  int16_t *samples;
+  size_t capacity;  // Power of two, in samples
+  std::atomic<size_t> head;  // Total samples committed by the producer
+  std::atomic<size_t> tail;  // Total samples released by the consumer
+} pcm_ring_t;
+
+// `storage` must hold `capacity` samples and `capacity` must be a power of
+// two. Returns false otherwise.
+bool pcm_ring_init(pcm_ring_t *ring, int16_t *storage, size_t capacity);
+
+size_t pcm_ring_available(const pcm_ring_t *ring);
+size_t pcm_ring_free(const pcm_ring_t *ring);
+
+// Producer side. `count` is the number of samples wanted on input and the
+// contiguous number granted on output, which may be smaller near the end of
+// the storage or when the ring is nearly full. Returns NULL if nothing fits.
+int16_t *pcm_ring_acquire_write(pcm_ring_t *ring, size_t *count);
+void pcm_ring_commit_write(pcm_ring_t *ring, size_t count);
+
+// Consumer side, same contract as the producer side.
+const int16_t *pcm_ring_acquire_read(pcm_ring_t *ring, size_t *count);
+void pcm_ring_commit_read(pcm_ring_t *ring, size_t count);
+
+#endif  // OAI_PCM_RING_H
@@ -0,0 +1,95 @@
+#include "ptime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool ptime_valid(uint32_t ptime_ms) {
+  return ptime_ms == 10 || ptime_ms == 20 || ptime_ms == 40 || ptime_ms == 60;
+}
+
+void ptime_cost(uint32_t ptime_ms, uint32_t payload_bps, ptime_cost_t *cost) {
+  cost->packets_per_s = 1000.0f / ptime_ms;
+  cost->payload_bytes = payload_bps / 8 * ptime_ms / 1000;
+  uint32_t header_bps = PTIME_HEADER_BYTES * 8 * 1000 / ptime_ms;
+  cost->wire_bps = payload_bps + header_bps;
+  cost->overhead_permille =
+      (uint32_t)((uint64_t)header_bps * 1000 / cost->wire_bps);
+}
+
+// Finds the line starting with `prefix` in [p, end), NULL if there is none.
+static const char *find_line(const char *p, const char *end,
+                             const char *prefix) {
+  size_t len = strlen(prefix);
+  while (p < end) {
+    if ((size_t)(end - p) >= len && memcmp(p, prefix, len) == 0) {
+      return p;
+    }
+    const char *newline = (const char *)memchr(p, '\n', end - p);
+    if (newline == NULL) {
+      return NULL;
+    }
+    p = newline + 1;
+  }
+  return NULL;
+}
+
+// The audio media section of `sdp`: from its m= line to the next m= line or
+// the end of the SDP.
+static bool audio_section(const char *sdp, const char **start,
+                          const char **end) {
+  const char *sdp_end = sdp + strlen(sdp);
+  *start = find_line(sdp, sdp_end, "m=audio ");
+  if (*start == NULL) {
+    return false;
+  }
+  const char *first = (const char *)memchr(*start, '\n', sdp_end - *start);
+  const char *next = first == NULL ? NULL : find_line(first + 1, sdp_end, "m=");
+  *end = next == NULL ? sdp_end : next;
+  return true;
+}
+
+size_t ptime_offer(const char *sdp, uint32_t ptime_ms, uint32_t maxptime_ms,
+                   char *out, size_t size) {
+  const char *start, *end;
+  if (!audio_section(sdp, &start, &end)) {
+    return 0;
+  }
+  size_t sdp_len = strlen(sdp);
+  if (find_line(start, end, "a=ptime:") != NULL) {
+    if (sdp_len + 1 > size) {
+      return 0;
+    }
+    memcpy(out, sdp, sdp_len + 1);
+    return sdp_len;
+  }
+
+  // libpeer ends lines with CRLF; follow whatever the m= line uses.
+  const char *newline = (const char *)memchr(start, '\n', end - start);
+  const char *eol = newline != NULL && newline > start && newline[-1] == '\r'
+                        ? "\r\n"
+                        : "\n";
+  char lines[64];
+  int lines_len =
+      snprintf(lines, sizeof(lines), "%sa=ptime:%lu%sa=maxptime:%lu%s",
+               end > sdp && end[-1] == '\n' ? "" : eol,
+               (unsigned long)ptime_ms, eol, (unsigned long)maxptime_ms, eol);
+  size_t head = end - sdp;
+  size_t total = sdp_len + lines_len;
+  if (lines_len < 0 || (size_t)lines_len >= sizeof(lines) || total + 1 > size) {
+    return 0;
+  }
+  memcpy(out, sdp, head);
+  memcpy(out + head, lines, lines_len);
+  memcpy(out + head + lines_len, end, sdp_len - head + 1);
+  return total;
+}
+
+uint32_t ptime_from_sdp(const char *sdp) {
+  const char *start, *end;
+  if (!audio_section(sdp, &start, &end)) {
+    return 0;
+  }
+  const char *line = find_line(start, end, "a=ptime:");
+  return line == NULL ? 0 : (uint32_t)strtoul(line + 8, NULL, 10);
+}
@@ -0,0 +1,45 @@
+#ifndef OAI_PTIME_H
+#define OAI_PTIME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Packetization time: how much audio goes into each RTP packet. Longer
+// packets mean fewer of them, so less header overhead and fewer loop passes,
+// crypto calls and radio wakeups per second. The cost is latency: a packet
+// cannot leave before its last sample is captured, and losing one loses more
+// audio.
+//
+// The device offers its ptime with a=ptime and the longest packet it can
+// take with a=maxptime. Both are hints the answerer may echo or ignore;
+// RTP timestamps tell the receiver the truth either way.
+
+// IPv4 (20) + UDP (8) + RTP (12) + SRTP authentication tag (10, the 80-bit
+// tag of AES_CM_128_HMAC_SHA1_80)
+#define PTIME_HEADER_BYTES 50
+#define PTIME_MAX_MS 60
+
+typedef struct {
+  float packets_per_s;
+  uint32_t payload_bytes;      // Per packet
+  uint32_t wire_bps;           // Payload and headers
+  uint32_t overhead_permille;  // Share of wire_bps spent on headers
+} ptime_cost_t;
+
+// 10, 20, 40 and 60ms: what both Opus and the capture path can frame.
+bool ptime_valid(uint32_t ptime_ms);
+
+// What a stream of `payload_bps` costs on the wire at `ptime_ms`.
+void ptime_cost(uint32_t ptime_ms, uint32_t payload_bps, ptime_cost_t *cost);
+
+// Copies `sdp` to `out` (room for `size` bytes) with a=ptime and a=maxptime
+// added to its audio section. Returns the length written, 0 if the SDP has no
+// audio section or `out` is too small. An audio section that already carries
+// a=ptime is copied unchanged.
+size_t ptime_offer(const char *sdp, uint32_t ptime_ms, uint32_t maxptime_ms,
+                   char *out, size_t size);
+
+// The a=ptime of the audio section of `sdp`, 0 if it has none.
+uint32_t ptime_from_sdp(const char *sdp);
+
+#endif  // OAI_PTIME_H
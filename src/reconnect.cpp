@@ -0,0 +1,76 @@
+#include "reconnect.h"
+
+#include <string.h>
+
+void reconnect_init(reconnect_t *reconnect, uint32_t base_ms, uint32_t max_ms,
+                    uint32_t seed) {
+  memset(reconnect, 0, sizeof(*reconnect));
+  reconnect->state = RECONNECT_WAITING;
+  reconnect->base_ms = base_ms;
+  reconnect->max_ms = max_ms;
+  reconnect->lcg = seed;
+}
+
+reconnect_action_t reconnect_poll(reconnect_t *reconnect, int64_t now_us) {
+  switch (reconnect->state) {
+    case RECONNECT_WAITING:
+      if (now_us < reconnect->retry_at_us) {
+        return RECONNECT_NONE;
+      }
+      reconnect->state = RECONNECT_CONNECTING;
+      reconnect->attempt_us = now_us;
+      reconnect->stats.attempts++;
+      return RECONNECT_START;
+    case RECONNECT_CONNECTING:
+      if (now_us - reconnect->attempt_us <
+          (int64_t)RECONNECT_CONNECT_TIMEOUT_MS * 1000) {
+        return RECONNECT_NONE;
+      }
+      reconnect_failed(reconnect, now_us);
+      return RECONNECT_TIMED_OUT;
+    case RECONNECT_CONNECTED:
+      break;
+  }
+  return RECONNECT_NONE;
+}
+
+void reconnect_offered(reconnect_t *reconnect, int64_t now_us) {
+  reconnect->attempt_us = now_us;
+}
+
+void reconnect_connected(reconnect_t *reconnect, int64_t now_us) {
+  if (reconnect->lost_us != 0) {
+    int64_t elapsed = now_us - reconnect->lost_us;
+    reconnect->stats.recoveries++;
+    reconnect->stats.recover_last_us = elapsed;
+    if (elapsed > reconnect->stats.recover_max_us) {
+      reconnect->stats.recover_max_us = elapsed;
+    }
+  }
+  reconnect->state = RECONNECT_CONNECTED;
+  reconnect->failed_in_row = 0;
+  reconnect->lost_us = 0;
+}
+
+// Exponential backoff with "equal jitter": half the step is fixed, the other
+// half random, so retries never bunch up near zero yet still spread out.
+uint32_t reconnect_failed(reconnect_t *reconnect, int64_t now_us) {
+  if (reconnect->lost_us == 0) {
+    reconnect->lost_us = now_us;
+  }
+  reconnect->stats.failures++;
+
+  uint32_t shift = reconnect->failed_in_row < 16 ? reconnect->failed_in_row : 16;
+  uint64_t step = (uint64_t)reconnect->base_ms << shift;
+  if (step > reconnect->max_ms) {
+    step = reconnect->max_ms;
+  }
+  reconnect->lcg = reconnect->lcg * 1664525 + 1013904223;
+  uint32_t delay_ms =
+      (uint32_t)(step / 2 + (reconnect->lcg >> 8) % (step / 2 + 1));
+
+  reconnect->failed_in_row++;
+  reconnect->state = RECONNECT_WAITING;
+  reconnect->retry_at_us = now_us + (int64_t)delay_ms * 1000;
+  return delay_ms;
+}
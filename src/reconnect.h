@@ -0,0 +1,61 @@
+#ifndef OAI_RECONNECT_H
+#define OAI_RECONNECT_H
+
+#include <stdint.h>
+
+#define RECONNECT_BASE_MS 500
+#define RECONNECT_MAX_MS (30 * 1000)
+#define RECONNECT_CONNECT_TIMEOUT_MS (20 * 1000)
+
+// Decides when to rebuild the session after it failed. Only the peer
+// connection and signaling are rebuilt; everything else stays up.
+typedef enum {
+  RECONNECT_WAITING,     // Backing off until retry_at_us
+  RECONNECT_CONNECTING,  // A session is being set up
+  RECONNECT_CONNECTED,
+} reconnect_state_t;
+
+typedef enum {
+  RECONNECT_NONE,
+  RECONNECT_START,      // Build a new session now
+  RECONNECT_TIMED_OUT,  // Tear the current attempt down, it got nowhere
+} reconnect_action_t;
+
+typedef struct {
+  uint32_t attempts;        // Sessions started, the first one included
+  uint32_t failures;        // Sessions or attempts that failed
+  uint32_t recoveries;      // Connected again after a failure
+  int64_t recover_last_us;  // Failure to connected, backoff included
+  int64_t recover_max_us;
+} reconnect_stats_t;
+
+typedef struct {
+  reconnect_state_t state;
+  uint32_t base_ms;
+  uint32_t max_ms;
+  uint32_t failed_in_row;
+  int64_t retry_at_us;
+  int64_t attempt_us;  // When the current attempt started
+  int64_t lost_us;     // First failure since last connected, 0 if none
+  uint32_t lcg;
+  reconnect_stats_t stats;
+} reconnect_t;
+
+// Starts out due, so the first poll starts the first session. `seed` only
+// spreads retries of many devices apart.
+void reconnect_init(reconnect_t *reconnect, uint32_t base_ms, uint32_t max_ms,
+                     uint32_t seed);
+
+reconnect_action_t reconnect_poll(reconnect_t *reconnect, int64_t now_us);
+
+// The attempt is on the network; RECONNECT_CONNECT_TIMEOUT_MS counts from
+// here, so time spent waiting for an IP address is not held against it.
+void reconnect_offered(reconnect_t *reconnect, int64_t now_us);
+
+void reconnect_connected(reconnect_t *reconnect, int64_t now_us);
+
+// The session or attempt failed and was torn down; schedules the next one.
+// Returns the backoff chosen, in ms.
+uint32_t reconnect_failed(reconnect_t *reconnect, int64_t now_us);
+
+#endif  // OAI_RECONNECT_H
@@ -0,0 +1,145 @@
+#include "resampler.h"
+
+#include <math.h>
+#include <string.h>
+
+#define RESAMPLER_CUTOFF 0.9  // Of the lower rate's Nyquist
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+  while (b != 0) {
+    uint32_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+static void design(resampler_t *resampler) {
+  uint32_t up = resampler->up;
+  uint32_t taps = resampler->taps;
+  uint32_t length = up * taps;
+  double center = (length - 1) / 2.0;
+  double cutoff =
+      RESAMPLER_CUTOFF * 0.5 / (up > resampler->down ? up : resampler->down);
+
+  double prototype[RESAMPLER_MAX_COEFFS];
+  for (uint32_t m = 0; m < length; m++) {
+    double x = m - center;
+    double arg = 2 * M_PI * cutoff * x;
+    double sinc = x == 0 ? 1.0 : sin(arg) / arg;
+    double window = 0.42 - 0.5 * cos(2 * M_PI * (m + 0.5) / length) +
+                    0.08 * cos(4 * M_PI * (m + 0.5) / length);
+    prototype[m] = sinc * window;
+  }
+
+  for (uint32_t phase = 0; phase < up; phase++) {
+    double sum = 0;
+    for (uint32_t k = 0; k < taps; k++) {
+      sum += prototype[phase + k * up];
+    }
+    int16_t *coeffs = resampler->coeffs + phase * taps;
+    for (uint32_t k = 0; k < taps; k++) {
+      long q = lround(prototype[phase + k * up] / sum * 32768.0);
+      if (q > INT16_MAX) {
+        q = INT16_MAX;
+      } else if (q < INT16_MIN) {
+        q = INT16_MIN;
+      }
+      coeffs[taps - 1 - k] = (int16_t)q;
+    }
+  }
+}
+
+bool resampler_init(resampler_t *resampler, uint32_t in_rate,
+                    uint32_t out_rate) {
+  if (in_rate == 0 || out_rate == 0) {
+    return false;
+  }
+  uint32_t divisor = gcd(in_rate, out_rate);
+  uint32_t up = out_rate / divisor;
+  uint32_t down = in_rate / divisor;
+  uint32_t taps = RESAMPLER_BASE_TAPS * ((down + up - 1) / up);
+  if (up > RESAMPLER_MAX_RATIO || down > RESAMPLER_MAX_RATIO ||
+      up * taps > RESAMPLER_MAX_COEFFS) {
+    return false;
+  }
+
+  resampler->in_rate = in_rate;
+  resampler->out_rate = out_rate;
+  resampler->up = up;
+  resampler->down = down;
+  resampler->taps = taps;
+  if (up != down) {
+    design(resampler);
+  }
+  resampler_reset(resampler);
+  return true;
+}
+
+void resampler_reset(resampler_t *resampler) {
+  memset(resampler->history, 0, sizeof(resampler->history));
+  resampler->phase = 0;
+  resampler->index = 0;
+}
+
+size_t resampler_max_output(const resampler_t *resampler, size_t in_count) {
+  return (in_count * resampler->up + resampler->down - 1) / resampler->down +
+         1;
+}
+
+uint32_t resampler_delay(const resampler_t *resampler) {
+  if (resampler->up == resampler->down) {
+    return 0;
+  }
+  return (resampler->up * resampler->taps - 1) / (2 * resampler->down);
+}
+
+// The hot loop: int16 x int16 into int32. Phases sum to unity, so the sum of
+// absolute coefficients stays well under 2.0 and full-scale input cannot
+// overflow the accumulator.
+static inline int16_t dot(const int16_t *x, const int16_t *h, uint32_t taps) {
+  int32_t acc = 1 << 14;
+  for (uint32_t t = 0; t < taps; t++) {
+    acc += (int32_t)x[t] * h[t];
+  }
+  acc >>= 15;
+  if (acc > INT16_MAX) {
+    return INT16_MAX;
+  }
+  if (acc < INT16_MIN) {
+    return INT16_MIN;
+  }
+  return (int16_t)acc;
+}
+
+size_t resampler_process(resampler_t *resampler, const int16_t *in,
+                         size_t in_count, int16_t *out) {
+  if (in_count > RESAMPLER_MAX_INPUT) {
+    in_count = RESAMPLER_MAX_INPUT;
+  }
+  if (resampler->up == resampler->down) {
+    memcpy(out, in, in_count * sizeof(int16_t));
+    return in_count;
+  }
+
+  uint32_t taps = resampler->taps;
+  uint32_t up = resampler->up;
+  uint32_t down = resampler->down;
+  int16_t *history = resampler->history;
+  memcpy(history + taps - 1, in, in_count * sizeof(int16_t));
+
+  size_t produced = 0;
+  size_t index = resampler->index;
+  uint32_t phase = resampler->phase;
+  while (index < in_count) {
+    out[produced++] =
+        dot(history + index, resampler->coeffs + phase * taps, taps);
+    phase += down;
+    index += phase / up;
+    phase %= up;
+  }
+  resampler->index = index - in_count;
+  resampler->phase = phase;
+  memmove(history, history + in_count, (taps - 1) * sizeof(int16_t));
+  return produced;
+}
@@ -0,0 +1,59 @@
+#ifndef OAI_RESAMPLER_H
+#define OAI_RESAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming polyphase FIR resampler between any two of 8, 16, 24 and 48kHz.
+// The ratio is reduced to up/down (at most 6), and each output sample is one
+// int16 x Q15 dot product over `taps` inputs with the coefficients of its
+// phase laid out contiguously, which compilers vectorize (and the S3 can run
+// as a single MAC loop).
+//
+// The prototype is a Blackman-windowed sinc cut at 90% of the lower rate's
+// Nyquist, RESAMPLER_BASE_TAPS long per phase for upsampling and that times
+// the decimation factor going down, so the transition band is the same
+// width in output terms either way. Every phase is normalized to unity DC
+// gain.
+
+#define RESAMPLER_BASE_TAPS 24
+#define RESAMPLER_MAX_RATIO 6  // 8kHz <-> 48kHz
+#define RESAMPLER_MAX_TAPS (RESAMPLER_BASE_TAPS * RESAMPLER_MAX_RATIO)
+#define RESAMPLER_MAX_COEFFS (RESAMPLER_BASE_TAPS * RESAMPLER_MAX_RATIO)
+#define RESAMPLER_MAX_INPUT 1440  // 30ms at 48kHz per call
+
+typedef struct {
+  uint32_t in_rate;
+  uint32_t out_rate;
+  uint32_t up;    // Interpolation factor, also the number of phases
+  uint32_t down;  // Decimation factor
+  uint32_t taps;  // Per phase
+  int16_t coeffs[RESAMPLER_MAX_COEFFS];  // [phase][tap], taps reversed
+
+  // The last taps - 1 inputs, then the block being processed.
+  int16_t history[RESAMPLER_MAX_TAPS - 1 + RESAMPLER_MAX_INPUT];
+  uint32_t phase;  // Of the next output, 0 .. up - 1
+  size_t index;    // Input index of the next output within the next block
+} resampler_t;
+
+// Returns false for unsupported rates. Equal rates are valid and copy.
+bool resampler_init(resampler_t *resampler, uint32_t in_rate,
+                    uint32_t out_rate);
+
+// Upper bound on the output of one call with `in_count` inputs.
+size_t resampler_max_output(const resampler_t *resampler, size_t in_count);
+
+// Consumes all `in_count` (at most RESAMPLER_MAX_INPUT) samples and returns
+// how many were written to `out`, which must hold resampler_max_output.
+// Blocks whose length is a multiple of `down` always produce exactly
+// in_count * up / down samples, e.g. every 10 or 20ms frame.
+size_t resampler_process(resampler_t *resampler, const int16_t *in,
+                         size_t in_count, int16_t *out);
+
+// Forgets the history so the next block starts from silence.
+void resampler_reset(resampler_t *resampler);
+
+// Samples of delay the filter adds, in output samples.
+uint32_t resampler_delay(const resampler_t *resampler);
+
+#endif  // OAI_RESAMPLER_H
@@ -0,0 +1,121 @@
+#include "rtp_stamp.h"
+
+#include <string.h>
+
+#define RTP_HEADER_BYTES 12
+
+void rtp_stamp_init(rtp_stamp_queue_t *queue, uint8_t payload_type,
+                    uint32_t step) {
+  // No slot holds a frame yet: each names the frame a lap before index 0.
+  for (uint32_t i = 0; i < RTP_STAMP_QUEUE; i++) {
+    queue->stamps[i].index = i - RTP_STAMP_QUEUE;
+  }
+  queue->head.store(0, std::memory_order_relaxed);
+  queue->tail.store(0, std::memory_order_relaxed);
+  queue->session_start.store(0, std::memory_order_relaxed);
+  queue->session.store(0, std::memory_order_relaxed);
+  queue->payload_type = payload_type;
+  queue->step.store(step, std::memory_order_relaxed);
+  queue->session_seen = 0;
+  queue->started = false;
+  queue->last_seq = 0;
+  queue->last_index = 0;
+  queue->last_timestamp = 0;
+  memset(&queue->stats, 0, sizeof(queue->stats));
+}
+
+void rtp_stamp_set_step(rtp_stamp_queue_t *queue, uint32_t step) {
+  queue->step.store(step, std::memory_order_relaxed);
+}
+
+bool rtp_stamp_push(rtp_stamp_queue_t *queue, uint32_t timestamp,
+                    bool marker) {
+  uint32_t head = queue->head.load(std::memory_order_relaxed);
+  // Stamps the old session never sent are not waited for.
+  uint32_t oldest = queue->tail.load(std::memory_order_acquire);
+  uint32_t start = queue->session_start.load(std::memory_order_relaxed);
+  if ((int32_t)(start - oldest) > 0) {
+    oldest = start;
+  }
+  // Without room the slot may still be read for the frame a lap before, so
+  // it is left alone and the frame's packet finds no stamp.
+  bool room = head - oldest < RTP_STAMP_QUEUE;
+  if (room) {
+    rtp_stamp_t *stamp = &queue->stamps[head & (RTP_STAMP_QUEUE - 1)];
+    stamp->index = head;
+    stamp->timestamp = timestamp;
+    stamp->marker = marker;
+  } else {
+    queue->stats.full++;
+  }
+  queue->head.store(head + 1, std::memory_order_release);
+  return room;
+}
+
+// The refused frame never becomes a packet, so nothing reads its slot.
+void rtp_stamp_cancel(rtp_stamp_queue_t *queue) {
+  uint32_t head = queue->head.load(std::memory_order_relaxed) - 1;
+  rtp_stamp_t *stamp = &queue->stamps[head & (RTP_STAMP_QUEUE - 1)];
+  if (stamp->index == head) {
+    stamp->index = head - RTP_STAMP_QUEUE;
+  }
+  queue->head.store(head, std::memory_order_release);
+}
+
+void rtp_stamp_restart(rtp_stamp_queue_t *queue) {
+  queue->session_start.store(queue->head.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+  queue->session.fetch_add(1, std::memory_order_release);
+}
+
+void rtp_stamp_apply(rtp_stamp_queue_t *queue, uint8_t *packet, size_t len) {
+  if (len < RTP_HEADER_BYTES || (packet[0] >> 6) != 2 ||
+      (packet[1] & 0x7F) != queue->payload_type) {
+    return;
+  }
+  uint16_t seq = (uint16_t)((packet[2] << 8) | packet[3]);
+
+  uint32_t index;
+  uint32_t session = queue->session.load(std::memory_order_acquire);
+  if (!queue->started || session != queue->session_seen) {
+    index = queue->session_start.load(std::memory_order_relaxed);
+    queue->session_seen = session;
+  } else {
+    index = queue->last_index + (uint16_t)(seq - queue->last_seq);
+  }
+  queue->last_seq = seq;
+  queue->last_index = index;
+
+  uint32_t head = queue->head.load(std::memory_order_acquire);
+  bool pushed = (int32_t)(head - index) > 0;
+  const rtp_stamp_t *stamp = &queue->stamps[index & (RTP_STAMP_QUEUE - 1)];
+  uint32_t timestamp;
+  bool marker;
+  if (pushed && stamp->index == index) {
+    timestamp = stamp->timestamp;
+    marker = stamp->marker;
+    queue->stats.applied++;
+  } else if (queue->started) {
+    timestamp = queue->last_timestamp +
+                queue->step.load(std::memory_order_relaxed);
+    marker = false;
+    queue->stats.unmatched++;
+  } else {
+    // Nothing to step from: keep libpeer's, and step from it.
+    queue->stats.unmatched++;
+    queue->started = true;
+    queue->last_timestamp = ((uint32_t)packet[4] << 24) |
+                            ((uint32_t)packet[5] << 16) |
+                            ((uint32_t)packet[6] << 8) | packet[7];
+    queue->tail.store(pushed ? index + 1 : head, std::memory_order_release);
+    return;
+  }
+  queue->tail.store(pushed ? index + 1 : head, std::memory_order_release);
+  queue->started = true;
+  queue->last_timestamp = timestamp;
+  packet[4] = (uint8_t)(timestamp >> 24);
+  packet[5] = (uint8_t)(timestamp >> 16);
+  packet[6] = (uint8_t)(timestamp >> 8);
+  packet[7] = (uint8_t)timestamp;
+  packet[1] = (uint8_t)((packet[1] & 0x7F) | (marker ? 0x80 : 0));
+}
@@ -0,0 +1,77 @@
+#ifndef OAI_RTP_STAMP_H
+#define OAI_RTP_STAMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// Carries the uplink's own RTP timestamps and marker bits to the packets
+// libpeer builds. libpeer queues each frame and stamps it with a fixed ptime
+// step when it encodes, so neither samples the microphone dropped nor frames
+// the VAD held back would show on the wire.
+// The publisher pushes a stamp per frame before handing the frame over; the
+// packet picks it up on its way into SRTP (see media.cpp).
+//
+// Stamps are paired with packets by sequence number. A peer connection sends
+// every frame it accepted, in order, as one packet numbered one past the
+// last, so a packet's distance in sequence numbers from the session's first
+// packet is its frame's distance from the session's first frame. A frame
+// libpeer refused takes its stamp back; a new peer connection starts over.
+
+#define RTP_STAMP_QUEUE 64  // Frames libpeer may hold queued, a power of two
+
+typedef struct {
+  uint32_t index;  // Frame the stamp belongs to, counted since init
+  uint32_t timestamp;
+  bool marker;  // First packet after frames that were not sent
+} rtp_stamp_t;
+
+typedef struct {
+  uint32_t applied;
+  uint32_t unmatched;  // Packets with no stamp, stepped from the last one
+  uint32_t full;       // Frames pushed with no room, nothing took stamps
+} rtp_stamp_stats_t;
+
+// Single producer (the publisher), single consumer (the task protecting
+// packets). Counters belong to the consumer, except `full`.
+typedef struct {
+  rtp_stamp_t stamps[RTP_STAMP_QUEUE];
+  std::atomic<uint32_t> head;  // Index of the next frame pushed
+  std::atomic<uint32_t> tail;  // Oldest frame whose packet is not out yet
+  std::atomic<uint32_t> session_start;  // Index of the session's first frame
+  std::atomic<uint32_t> session;        // Bumped by rtp_stamp_restart
+  uint8_t payload_type;
+  std::atomic<uint32_t> step;  // RTP clock per frame, for unstamped packets
+
+  // The consumer's place: the last packet's sequence number and frame.
+  uint32_t session_seen;
+  bool started;
+  uint16_t last_seq;
+  uint32_t last_index;
+  uint32_t last_timestamp;
+  rtp_stamp_stats_t stats;
+} rtp_stamp_queue_t;
+
+void rtp_stamp_init(rtp_stamp_queue_t *queue, uint8_t payload_type,
+                    uint32_t step);
+
+// A new frame length, from the producer side.
+void rtp_stamp_set_step(rtp_stamp_queue_t *queue, uint32_t step);
+
+// Call before handing the frame to libpeer, and rtp_stamp_cancel if libpeer
+// refused it. Returns false if the queue is full; the packet then goes out
+// stepped from the previous one.
+bool rtp_stamp_push(rtp_stamp_queue_t *queue, uint32_t timestamp,
+                    bool marker);
+void rtp_stamp_cancel(rtp_stamp_queue_t *queue);
+
+// From the producer side once the peer connection that took the frames so
+// far is gone: the next packet is the first of a new one.
+void rtp_stamp_restart(rtp_stamp_queue_t *queue);
+
+// Rewrites the timestamp and marker bit of an outgoing RTP packet of
+// `payload_type`. Anything else is left alone.
+void rtp_stamp_apply(rtp_stamp_queue_t *queue, uint8_t *packet, size_t len);
+
+#endif  // OAI_RTP_STAMP_H
@@ -0,0 +1,100 @@
+#include "signaling.h"
+
+#include <esp_timer.h>
+#include <stdio.h>
+#include <string.h>
+
+static esp_err_t signaling_event_handler(esp_http_client_event_t *evt) {
+  signaling_client_t *client = (signaling_client_t *)evt->user_data;
+  switch (evt->event_id) {
+    case HTTP_EVENT_ON_CONNECTED:
+      // Raised only when perform had to open a new connection, after the
+      // TLS handshake completed.
+      client->connected_us = esp_timer_get_time();
+      client->stats.connections++;
+      break;
+    case HTTP_EVENT_ON_DATA:
+      // Chunked bodies arrive here already de-chunked; without a length the
+      // accumulator just grows until the response finishes. An answer over
+      // the limit sets `overflow` and fails the request.
+      if (client->answer.len == 0) {
+        int64_t length = esp_http_client_get_content_length(evt->client);
+        if (length > 0) {
+          http_body_reserve(&client->answer, (size_t)length);
+        }
+      }
+      http_body_append(&client->answer, (const char *)evt->data,
+                       evt->data_len);
+      break;
+    default:
+      break;
+  }
+  return ESP_OK;
+}
+
+bool signaling_client_init(signaling_client_t *client, const char *url,
+                           const char *api_key) {
+  memset(client, 0, sizeof(*client));
+  if (!http_body_init(&client->answer, SIGNALING_ANSWER_INITIAL,
+                      SIGNALING_ANSWER_LIMIT)) {
+    return false;
+  }
+
+  esp_http_client_config_t config;
+  memset(&config, 0, sizeof(esp_http_client_config_t));
+  config.url = url;
+  config.event_handler = signaling_event_handler;
+  config.user_data = client;
+  config.timeout_ms = SIGNALING_TIMEOUT_MS;
+  config.keep_alive_enable = true;
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+  config.save_client_session = true;
+#endif
+
+  client->http = esp_http_client_init(&config);
+  if (client->http == NULL) {
+    http_body_free(&client->answer);
+    return false;
+  }
+  snprintf(client->authorization, sizeof(client->authorization), "Bearer %s",
+           api_key);
+  esp_http_client_set_method(client->http, HTTP_METHOD_POST);
+  esp_http_client_set_header(client->http, "Content-Type", "application/sdp");
+  esp_http_client_set_header(client->http, "Authorization",
+                             client->authorization);
+  return true;
+}
+
+const char *signaling_client_post(signaling_client_t *client,
+                                  const char *offer) {
+  http_body_reset(&client->answer);
+  client->connected_us = 0;
+  client->start_us = esp_timer_get_time();
+  client->stats.requests++;
+
+  esp_http_client_set_post_field(client->http, offer, strlen(offer));
+  client->err = esp_http_client_perform(client->http);
+  client->status = esp_http_client_get_status_code(client->http);
+  client->done_us = esp_timer_get_time();
+
+  if (client->err != ESP_OK || client->status != 201 ||
+      client->answer.overflow) {
+    client->stats.failures++;
+    // Start the next attempt on a fresh socket; the TLS session ticket is
+    // kept by the client and still saves the full handshake.
+    esp_http_client_close(client->http);
+    return NULL;
+  }
+  if (client->connected_us == 0) {
+    client->stats.reused++;
+  }
+  return client->answer.data;
+}
+
+void signaling_client_free(signaling_client_t *client) {
+  if (client->http != NULL) {
+    esp_http_client_cleanup(client->http);
+    client->http = NULL;
+  }
+  http_body_free(&client->answer);
+}
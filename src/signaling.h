@@ -0,0 +1,52 @@
+#ifndef OAI_SIGNALING_H
+#define OAI_SIGNALING_H
+
+#include <esp_err.h>
+#include <esp_http_client.h>
+#include <stdint.h>
+
+#include "http_body.h"
+
+#define SIGNALING_ANSWER_INITIAL 4096
+#define SIGNALING_ANSWER_LIMIT (32 * 1024)
+#define SIGNALING_TIMEOUT_MS 10000
+#define SIGNALING_AUTHORIZATION_SIZE 256
+
+typedef struct {
+  uint32_t requests;
+  uint32_t failures;
+  uint32_t connections;  // New TCP+TLS connections
+  uint32_t reused;       // Requests that skipped the handshake entirely
+} signaling_stats_t;
+
+// One WHIP client: POSTs offers and keeps the answer. The HTTP connection is
+// long-lived, so a renegotiation or reconnect finds it still open, or at
+// least resumes the TLS session from its ticket instead of running a full
+// handshake. Each session owns one; nothing is shared between clients.
+typedef struct {
+  esp_http_client_handle_t http;
+  char authorization[SIGNALING_AUTHORIZATION_SIZE];
+  http_body_t answer;
+
+  // The last request, reset before every POST.
+  int64_t start_us;
+  int64_t connected_us;  // 0 if the request went out on a kept-alive socket
+  int64_t done_us;
+  int status;  // HTTP status, 0 if none arrived
+  esp_err_t err;
+
+  signaling_stats_t stats;
+} signaling_client_t;
+
+// Returns false if the answer buffer or the HTTP client cannot be created.
+bool signaling_client_init(signaling_client_t *client, const char *url,
+                           const char *api_key);
+
+// POSTs the offer and returns the answer SDP, owned by the client until the
+// next request. NULL on any failure; `status` and `err` say which.
+const char *signaling_client_post(signaling_client_t *client,
+                                  const char *offer);
+
+void signaling_client_free(signaling_client_t *client);
+
+#endif  // OAI_SIGNALING_H
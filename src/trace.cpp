@@ -0,0 +1,157 @@
+#include "trace.h"
+
+#include <esp_timer.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "freertos/FreeRTOS.h"
+
+#ifndef LINUX_BUILD
+#include "esp_attr.h"
+#define TRACE_CORES portNUM_PROCESSORS
+#define TRACE_CORE() xPortGetCoreID()
+#else
+#define EXT_RAM_BSS_ATTR
+#define TRACE_CORES 1
+#define TRACE_CORE() 0
+#endif
+
+#define TRACE_VERSION 1
+#define TRACE_HEX_LINE 32  // Dump bytes per console line
+
+static_assert((TRACE_RING_RECORDS & (TRACE_RING_RECORDS - 1)) == 0,
+              "TRACE_RING_RECORDS must be a power of two");
+static_assert(sizeof(trace_record_t) == 16, "trace records are 16 bytes");
+
+#ifdef OAI_TRACE
+typedef struct {
+  std::atomic<uint32_t> next;  // Index of the next record to claim
+  trace_record_t records[TRACE_RING_RECORDS];
+} trace_ring_t;
+
+// Touched once per record, so PSRAM's cache keeps up and internal RAM stays
+// free for DMA.
+EXT_RAM_BSS_ATTR static trace_ring_t rings[TRACE_CORES];
+
+// A task preempted mid-record on its core holds its claimed slot; the task
+// that preempted it claims the next one. The index is published last so a
+// half-written slot never reads as valid.
+void trace_record(trace_event_t event, uint32_t a, uint32_t b) {
+  trace_ring_t *ring = &rings[TRACE_CORE()];
+  uint32_t index = ring->next.fetch_add(1, std::memory_order_relaxed);
+  trace_record_t *record = &ring->records[index & (TRACE_RING_RECORDS - 1)];
+  __atomic_store_n(&record->seq, (uint16_t)~index, __ATOMIC_RELAXED);
+  std::atomic_thread_fence(std::memory_order_release);
+  record->time_us = (uint32_t)esp_timer_get_time();
+  record->event = (uint16_t)event;
+  record->a = a;
+  record->b = b;
+  __atomic_store_n(&record->seq, (uint16_t)index, __ATOMIC_RELEASE);
+}
+#else
+void trace_record(trace_event_t event, uint32_t a, uint32_t b) {}
+#endif
+
+static void write_u16(trace_write_fn write, void *ctx, uint16_t value) {
+  uint8_t bytes[2] = {(uint8_t)value, (uint8_t)(value >> 8)};
+  write(bytes, sizeof(bytes), ctx);
+}
+
+static void write_u32(trace_write_fn write, void *ctx, uint32_t value) {
+  uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8),
+                      (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+  write(bytes, sizeof(bytes), ctx);
+}
+
+void trace_dump(trace_write_fn write, void *ctx) {
+  write("OAIT", 4, ctx);
+  write_u16(write, ctx, TRACE_VERSION);
+  write_u16(write, ctx, sizeof(trace_record_t));
+#ifdef OAI_TRACE
+  write_u32(write, ctx, TRACE_CORES);
+  for (uint32_t core = 0; core < TRACE_CORES; core++) {
+    trace_ring_t *ring = &rings[core];
+    uint32_t next = ring->next.load(std::memory_order_acquire);
+    uint32_t count = next < TRACE_RING_RECORDS ? next : TRACE_RING_RECORDS;
+    uint32_t first = next - count;
+    write_u32(write, ctx, core);
+    write_u32(write, ctx, first);
+    write_u32(write, ctx, count);
+    for (uint32_t i = 0; i < count; i++) {
+      trace_record_t *record =
+          &ring->records[(first + i) & (TRACE_RING_RECORDS - 1)];
+      uint16_t seq = __atomic_load_n(&record->seq, __ATOMIC_ACQUIRE);
+      trace_record_t copy = *record;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (__atomic_load_n(&record->seq, __ATOMIC_RELAXED) != seq) {
+        seq = (uint16_t)~(first + i);  // Rewritten while we copied it
+      }
+      write_u32(write, ctx, copy.time_us);
+      write_u16(write, ctx, copy.event);
+      write_u16(write, ctx, seq);
+      write_u32(write, ctx, copy.a);
+      write_u32(write, ctx, copy.b);
+    }
+  }
+#else
+  write_u32(write, ctx, 0);
+#endif
+}
+
+typedef struct {
+  uint8_t line[TRACE_HEX_LINE];
+  size_t len;
+} hex_writer_t;
+
+static void hex_flush(hex_writer_t *hex) {
+  static const char digits[] = "0123456789abcdef";
+  char text[TRACE_HEX_LINE * 2 + 1];
+  for (size_t i = 0; i < hex->len; i++) {
+    text[i * 2] = digits[hex->line[i] >> 4];
+    text[i * 2 + 1] = digits[hex->line[i] & 0x0F];
+  }
+  text[hex->len * 2] = '\0';
+  printf("trace: %s\n", text);
+  hex->len = 0;
+}
+
+static void hex_write(const void *data, size_t size, void *ctx) {
+  hex_writer_t *hex = (hex_writer_t *)ctx;
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (size_t i = 0; i < size; i++) {
+    hex->line[hex->len++] = bytes[i];
+    if (hex->len == TRACE_HEX_LINE) {
+      hex_flush(hex);
+    }
+  }
+}
+
+void trace_dump_console(void) {
+  hex_writer_t hex = {};
+  printf("trace: begin\n");
+  trace_dump(hex_write, &hex);
+  if (hex.len > 0) {
+    hex_flush(&hex);
+  }
+  printf("trace: end\n");
+}
+
+static void file_write(const void *data, size_t size, void *ctx) {
+  fwrite(data, 1, size, (FILE *)ctx);
+}
+
+bool trace_dump_file(const char *path) {
+  char temp[256];
+  if (snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp)) {
+    return false;
+  }
+  FILE *file = fopen(temp, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  trace_dump(file_write, file);
+  bool ok = fclose(file) == 0;
+  return ok && rename(temp, path) == 0;
+}
@@ -0,0 +1,80 @@
+#ifndef OAI_TRACE_H
+#define OAI_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary trace of the media path, cheap enough to leave on in production
+// units. Each TRACE writes one 16-byte record into a ring of the core it runs
+// on: no formatting, no locks, no UART. The rings are dumped on request and
+// decoded on a host by tools/trace_decode.py.
+//
+// Built with OAI_TRACE defined (`export OAI_TRACE=1`). Without it TRACE
+// compiles to nothing and its arguments are not evaluated.
+
+// tools/trace_decode.py reads event names and argument meanings from this
+// enum: one event per line, its comment naming `a` and `b`. Append only, so
+// old dumps keep decoding.
+typedef enum {
+  TRACE_NONE = 0,
+  TRACE_UPLINK_FRAME,         // a: RTP timestamp, b: 1 sent, 0 suppressed
+  TRACE_UPLINK_SENT,          // a: payload bytes, b: capture to sent us
+  TRACE_VAD,                  // a: 1 speech started, 0 ended, b: energy
+  TRACE_DOWNLINK_RECEIVED,    // a: RTP sequence, b: payload bytes
+  TRACE_DOWNLINK_DECODED,     // a: payload bytes, b: ring fill samples
+  TRACE_DOWNLINK_LOST,        // a: 1 rebuilt from FEC, b: A-law lost run
+  TRACE_DOWNLINK_MALFORMED,   // a: payload bytes
+  TRACE_BARGE_IN,             // a: flush request us
+  TRACE_NETWORK_PASS,         // a: select timeout ms, b: pass us
+  TRACE_DATACHANNEL_MESSAGE,  // a: message bytes, b: stream id
+  TRACE_PEER_STATE,           // a: PeerConnectionState
+  TRACE_EVENTS,
+} trace_event_t;
+
+typedef struct {
+  uint32_t time_us;  // esp_timer, low 32 bits: wraps every 71 minutes
+  uint16_t event;
+  uint16_t seq;  // Low bits of the record's index, written last
+  uint32_t a;
+  uint32_t b;
+} trace_record_t;
+
+// Records per core, a power of two. 1024 is 16KB and a few seconds of a
+// busy session.
+#ifndef TRACE_RING_RECORDS
+#define TRACE_RING_RECORDS 1024
+#endif
+
+// Receives the dump in pieces; see trace_dump for the layout.
+typedef void (*trace_write_fn)(const void *data, size_t size, void *ctx);
+
+#ifdef OAI_TRACE
+#define TRACE(event, a, b) trace_record((event), (uint32_t)(a), (uint32_t)(b))
+#else
+#define TRACE(event, a, b) \
+  do {                     \
+    (void)sizeof(a);       \
+    (void)sizeof(b);       \
+  } while (0)
+#endif
+
+// Safe from any task. Never blocks: the oldest record is overwritten. Not for
+// ISRs, which may run while the PSRAM cache is off.
+void trace_record(trace_event_t event, uint32_t a, uint32_t b);
+
+// Writes a snapshot of every ring, oldest record first:
+//
+//   "OAIT", u16 version, u16 record size, u32 cores
+//   per core: u32 core, u32 index of its first record, u32 count, records
+//
+// little-endian. Tracing goes on meanwhile; a record overwritten while it was
+// copied no longer matches its index and the decoder drops it.
+void trace_dump(trace_write_fn write, void *ctx);
+
+// trace_dump as "trace: <hex>" lines on stdout, for a serial console.
+void trace_dump_console(void);
+
+// trace_dump into `path`, replaced whole so a reader never sees half a dump.
+bool trace_dump_file(const char *path);
+
+#endif  // OAI_TRACE_H
@@ -0,0 +1,91 @@
+#include "vad.h"
+
+#include <string.h>
+
+void vad_init(vad_t *vad, vad_silence_mode_t mode, uint32_t frame_ms) {
+  memset(vad, 0, sizeof(*vad));
+  vad->mode = mode;
+  vad->noise_floor = VAD_MIN_ENERGY;
+  vad->hangover_frames = VAD_HANGOVER_MS / frame_ms;
+}
+
+void vad_set_frame(vad_t *vad, uint32_t frame_ms) {
+  vad->hangover_frames = VAD_HANGOVER_MS / frame_ms;
+  if (vad->hangover > vad->hangover_frames) {
+    vad->hangover = vad->hangover_frames;
+  }
+}
+
+static uint32_t frame_energy(const int16_t *samples, size_t count) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < count; i++) {
+    sum += (int32_t)samples[i] * samples[i];
+  }
+  return count > 0 ? (uint32_t)(sum / count) : 0;
+}
+
+// The floor falls quickly to quieter frames and follows louder background
+// within a few frames. Through speech it only creeps up ~0.2% per frame, so a
+// long sentence barely moves it but a room that got louder for good is
+// learned within seconds instead of reading as endless speech.
+static void track_noise(vad_t *vad, uint32_t energy, bool active) {
+  if (energy < vad->noise_floor) {
+    vad->noise_floor -= (vad->noise_floor - energy) >> 2;
+  } else if (!active) {
+    vad->noise_floor += (energy - vad->noise_floor) >> 4;
+  } else {
+    vad->noise_floor += (vad->noise_floor >> 9) + 1;
+  }
+  if (vad->noise_floor < VAD_MIN_ENERGY) {
+    vad->noise_floor = VAD_MIN_ENERGY;
+  }
+}
+
+bool vad_process(vad_t *vad, const int16_t *samples, size_t count,
+                 size_t nominal_bytes) {
+  uint32_t energy = frame_energy(samples, count);
+  vad->energy = energy;
+
+  uint64_t threshold = (uint64_t)vad->noise_floor << VAD_THRESHOLD_SHIFT;
+  bool active = energy > threshold;
+  track_noise(vad, energy, active);
+
+  if (active) {
+    vad->hangover = vad->hangover_frames;
+  } else if (vad->hangover > 0) {
+    vad->hangover--;
+  }
+  bool speech = active || vad->hangover > 0;
+  if (speech != vad->speech) {
+    vad->stats.transitions++;
+    vad->speech = speech;
+  }
+
+  if (speech) {
+    vad->stats.speech_frames++;
+    vad->silence_run = 0;
+    return true;
+  }
+  vad->stats.silence_frames++;
+
+  bool send;
+  switch (vad->mode) {
+    case VAD_SILENCE_SEND:
+      send = true;
+      break;
+    case VAD_SILENCE_COMFORT:
+      send = vad->silence_run % VAD_COMFORT_INTERVAL == 0;
+      break;
+    case VAD_SILENCE_DROP:
+    default:
+      send = false;
+      break;
+  }
+  vad->silence_run++;
+
+  if (!send) {
+    vad->stats.suppressed_frames++;
+    vad->stats.bytes_saved += nominal_bytes;
+  }
+  return send;
+}
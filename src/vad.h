@@ -0,0 +1,54 @@
+#ifndef OAI_VAD_H
+#define OAI_VAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VAD_MIN_ENERGY 10000  // Mean power floor, ~-50dBFS
+#define VAD_THRESHOLD_SHIFT 2  // Speech is 4x (6dB) above the noise floor
+#define VAD_HANGOVER_MS 800    // Longer than the server's end-of-turn silence
+#define VAD_COMFORT_INTERVAL 10  // Silence frames per comfort frame sent
+
+// What to send while nobody speaks. The device sends every frame unless built
+// with another mode. Comfort sends every VAD_COMFORT_INTERVAL-th captured
+// frame so the far end keeps hearing the room, the same idea as Opus DTX
+// updates.
+typedef enum {
+  VAD_SILENCE_SEND,  // VAD off, every frame is sent
+  VAD_SILENCE_COMFORT,
+  VAD_SILENCE_DROP,
+} vad_silence_mode_t;
+
+typedef struct {
+  uint32_t speech_frames;
+  uint32_t silence_frames;
+  uint32_t suppressed_frames;
+  uint32_t bytes_saved;  // Nominal bytes of suppressed frames
+  uint32_t transitions;  // Speech starts and ends
+} vad_stats_t;
+
+// Energy VAD with an adaptive noise floor, integer math only. Frames stay
+// classified as speech for VAD_HANGOVER_MS after the energy drops so word
+// endings and the pause the server waits for are not cut.
+typedef struct {
+  vad_silence_mode_t mode;
+  uint32_t noise_floor;
+  uint32_t energy;  // Mean power of the last frame
+  int hangover_frames;
+  int hangover;
+  bool speech;
+  uint32_t silence_run;
+  vad_stats_t stats;
+} vad_t;
+
+void vad_init(vad_t *vad, vad_silence_mode_t mode, uint32_t frame_ms);
+
+// Keeps the noise floor and state; only the hangover is re-counted.
+void vad_set_frame(vad_t *vad, uint32_t frame_ms);
+
+// Classifies one frame and applies the silence policy. Returns true if the
+// frame should be sent; otherwise `nominal_bytes` is counted as saved.
+bool vad_process(vad_t *vad, const int16_t *samples, size_t count,
+                 size_t nominal_bytes);
+
+#endif  // OAI_VAD_H
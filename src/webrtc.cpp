@@ -1,50 +1,245 @@
-#ifndef LINUX_BUILD
-#include <driver/i2s.h>
-#include <opus.h>
-#endif
-
 #include <esp_event.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+
+#include "event_builder.h"
+#include "boot_timing.h"
+#include "event_dispatch.h"
 #include "main.h"
 #include "media.h"
-#include "driver/uart.h"
+#include "media_memory.h"
+#include "network_wait.h"
+#include "network_wake.h"
+#include "ptime.h"
+#include "reconnect.h"
+#include "signaling.h"
+#include "trace.h"
 #include "freertos/FreeRTOS.h"
+#ifndef LINUX_BUILD
+#include "driver/uart.h"
+#endif
 
 #define TICK_INTERVAL 15
-#define GREETING                                                    \
-  "{\"type\": \"response.create\", \"response\": {\"modalities\": " \
-  "[\"audio\", \"text\"], \"instructions\": \"Say 'How can I help?.'\"}}"
+#define GREETING "Say 'How can I help?.'"
+#define EVENT_STATS_INTERVAL_US (10 * 1000 * 1000)
+#define ITEM_ID_SIZE 64
+#define LATENCY_REPORT_SIZE 768
 
+// The offer as POSTed, with our ptime added. Taken from the PSRAM arena
+// before the publisher seals it.
+#define OFFER_MAX_SIZE 4096
 
-static TaskHandle_t xPcTaskHandle = NULL;
-PeerConnection *peer_connection = NULL;
+// Everything tied to one session with the Realtime API. libpeer's callbacks,
+// the event routes and the publisher reach it through their user data, so
+// nothing here is shared with another session. The device runs one; audio
+// devices, codecs and buffers belong to the process and outlive it.
+typedef struct {
+  PeerConnection *pc;
+  std::atomic<bool> audio_connected;
+  // Failures are only noted from libpeer's callbacks; the session is torn
+  // down and rebuilt from the loop, outside of peer_connection_loop.
+  bool lost;
+  event_queue_t events;
+  event_dispatcher_t dispatcher;
+  // Assistant item whose audio is playing, so a barge-in can tell the
+  // server how much of it was heard.
+  char playing_item_id[ITEM_ID_SIZE];
+  char *offer;
+  signaling_client_t signaling;  // Kept across reconnects
+  // Packetization time in effect, offered as a=ptime, and the one the next
+  // session starts with, which the console may change meanwhile.
+  uint32_t ptime_ms;
+  std::atomic<uint32_t> next_ptime_ms;
+  // Backoff and recovery times span the session's reconnects.
+  reconnect_t reconnect;
+  // The publisher's passes, counted and timed for the network loop, which
+  // paces itself on them.
+  std::atomic<uint32_t> audio_passes;
+  std::atomic<int64_t> audio_pass_us;
+  network_wait_t network_wait;
+  // Aimed at the ICE socket once the offer names it; the publisher ends the
+  // loop's select through it as it queues a frame.
+  network_wake_t wake;
+} oai_session_t;
 
-#ifndef LINUX_BUILD
-StaticTask_t task_buffer;
+static oai_session_t device_session;
+
+// Read by libpeer's select on the ICE socket as AGENT_POLL_TIMEOUT, see
+// components/peer/CMakeLists.txt. Set before every peer_connection_loop.
+int peer_poll_timeout_ms = NETWORK_WAIT_HANDSHAKE_MS;
+
+// Read by libpeer as AUDIO_LATENCY, the RTP timestamp step of each packet
+// sent, see components/peer/CMakeLists.txt. Follows the session's ptime.
+int peer_audio_ptime_ms = AUDIO_PTIME_MS;
+
+// Moves the uplink, libpeer's timestamp step and the loop's pacing to
+// `ptime_ms` together.
+static void oai_session_set_ptime(oai_session_t *session, uint32_t ptime_ms) {
+  if (!oai_audio_set_ptime(ptime_ms)) {
+    return;
+  }
+  session->ptime_ms = ptime_ms;
+  peer_audio_ptime_ms = (int)ptime_ms;
+  network_wait_set_frame(&session->network_wait, ptime_ms);
+}
+
+// AUDIO_PTIME_MS unless linux was started with OAI_AUDIO_PTIME_MS.
+static uint32_t oai_ptime_setting(void) {
+#ifdef LINUX_BUILD
+  const char *value = getenv("OAI_AUDIO_PTIME_MS");
+  if (value != NULL && value[0] != '\0') {
+    uint32_t ptime_ms = strtoul(value, NULL, 10);
+    if (ptime_valid(ptime_ms)) {
+      return ptime_ms;
+    }
+    ESP_LOGW(LOG_TAG, "OAI_AUDIO_PTIME_MS must be 10, 20, 40 or 60, using %d",
+             AUDIO_PTIME_MS);
+  }
+#endif
+  return AUDIO_PTIME_MS;
+}
+
+// Runs for the whole session, paced by the microphone rather than a delay.
+// Frames captured while disconnected are read and dropped. The encoder is the
+// last piece of media memory, so startup ends here.
 void oai_send_audio_task(void *user_data) {
+  oai_session_t *session = (oai_session_t *)user_data;
+  oai_wait_audio();
   oai_init_audio_encoder();
+  media_memory_seal();
+  media_memory_log();
 
   while (1) {
-    oai_send_audio(peer_connection);
-    vTaskDelay(pdMS_TO_TICKS(TICK_INTERVAL));
+    bool queued = oai_send_audio(session->audio_connected ? session->pc : NULL);
+    int64_t now = esp_timer_get_time();
+    // Counted first: a reader pairing the new count with the old time sees
+    // the pass as early, which the network loop's phase estimate ignores.
+    session->audio_passes++;
+    session->audio_pass_us = now;
+    // Only once the pass is counted, so the loop accounts for it on waking.
+    if (queued) {
+      network_wake_signal(&session->wake);
+    }
+  }
+}
+
+// Once the session's audio_connected is cleared, every pass that starts afterwards sends
+// nowhere. Waiting for the pass in flight to end makes the peer connection
+// safe to destroy. Capture reads time out, so a pass is never longer than
+// AUDIO_CAPTURE_WAIT_MS.
+static void oai_wait_audio_idle(oai_session_t *session) {
+  uint32_t seen = session->audio_passes;
+  while (session->audio_passes == seen) {
+    vTaskDelay(1);
+  }
+}
+
+// Flushes local playback first, then truncates the item to what was heard
+// so the model's context matches what the user actually got.
+static void oai_barge_in(oai_session_t *session, const char *reason,
+                         bool truncate) {
+  int64_t start = esp_timer_get_time();
+  oai_audio_interrupt();
+  int64_t flush_us = esp_timer_get_time() - start;
+  TRACE(TRACE_BARGE_IN, flush_us, 0);
+  ESP_LOGI(LOG_TAG, "barge-in on %s, flush requested in %lld us", reason,
+           (long long)flush_us);
+
+  if (!truncate || session->playing_item_id[0] == '\0') {
+    return;
+  }
+  uint32_t audio_end_ms = oai_audio_item_played_ms();
+  event_item_truncate(&session->events, session->playing_item_id,
+                      audio_end_ms);
+  ESP_LOGI(LOG_TAG, "Truncating %s at %lu ms", session->playing_item_id,
+           (unsigned long)audio_end_ms);
+  session->playing_item_id[0] = '\0';
+}
+
+static void on_speech_started(const event_message_t *event, void *user_data) {
+  oai_barge_in((oai_session_t *)user_data, "speech_started", true);
+}
+
+static void on_playback_cancelled(const event_message_t *event,
+                                  void *user_data) {
+  oai_session_t *session = (oai_session_t *)user_data;
+  oai_barge_in(session, "cancel", false);
+  session->playing_item_id[0] = '\0';
+}
+
+// Only a local peer sends this, e.g. a test harness on the data channel.
+static void on_latency_get(const event_message_t *event, void *user_data) {
+  static char report[LATENCY_REPORT_SIZE];
+  if (oai_audio_latency_json(report, sizeof(report)) > 0) {
+    event_latency_report(&((oai_session_t *)user_data)->events, report);
+  }
+}
+
+static void on_output_item_added(const event_message_t *event,
+                                 void *user_data) {
+  oai_session_t *session = (oai_session_t *)user_data;
+  json_value_t item, id;
+  if (json_get(event->json, event->len, "item", &item) &&
+      json_value_get(&item, "id", &id) &&
+      json_value_copy(&id, session->playing_item_id,
+                      sizeof(session->playing_item_id))) {
+    oai_audio_item_started();
+  }
+}
+
+static void on_error(const event_message_t *event, void *user_data) {
+  json_value_t error, message;
+  if (json_get(event->json, event->len, "error", &error) &&
+      json_value_get(&error, "message", &message)) {
+    ESP_LOGE(LOG_TAG, "Realtime API error: %.*s", (int)message.len,
+             message.ptr);
+  }
+}
+
+static void on_transcript_done(const event_message_t *event,
+                               void *user_data) {
+  json_value_t transcript;
+  if (json_get(event->json, event->len, "transcript", &transcript)) {
+    ESP_LOGI(LOG_TAG, "%.*s: %.*s", (int)event->type.len, event->type.ptr,
+             (int)transcript.len, transcript.ptr);
   }
 }
-#endif
+
+// Sorted by type. Everything else, including the high-rate delta events, is
+// counted and skipped.
+static const event_dispatch_route_t event_routes[] = {
+    {"conversation.item.input_audio_transcription.completed",
+     on_transcript_done},
+    {"error", on_error},
+    {"input_audio_buffer.speech_started", on_speech_started},
+    {"oai.latency.get", on_latency_get},
+    {"output_audio_buffer.cleared", on_playback_cancelled},
+    {"response.audio_transcript.done", on_transcript_done},
+    {"response.cancelled", on_playback_cancelled},
+    {"response.output_item.added", on_output_item_added},
+};
 
 static void oai_ondatachannel_onmessage_task(char *msg, size_t len,
                                              void *userdata, uint16_t sid) {
-  ESP_LOGI(LOG_TAG, "DataChannel Message: %s", msg);
+  TRACE(TRACE_DATACHANNEL_MESSAGE, len, sid);
+#ifdef LOG_DATACHANNEL_MESSAGES
+  ESP_LOGI(LOG_TAG, "DataChannel Message: %.*s", (int)len, msg);
+#endif
+  event_dispatch(&((oai_session_t *)userdata)->dispatcher, msg, len);
 }
 
 static void oai_ondatachannel_onopen_task(void *userdata) {
-  if (peer_connection_create_datachannel(peer_connection, DATA_CHANNEL_RELIABLE,
+  oai_session_t *session = (oai_session_t *)userdata;
+  if (peer_connection_create_datachannel(session->pc, DATA_CHANNEL_RELIABLE,
                                          0, 0, (char *)"oai-events",
                                          (char *)"") != -1) {
     ESP_LOGI(LOG_TAG, "DataChannel created");
-    peer_connection_datachannel_send(peer_connection, (char *)GREETING,
-                                     strlen(GREETING));
+    event_response_create(&session->events, GREETING);
   } else {
     ESP_LOGE(LOG_TAG, "Failed to create DataChannel");
   }
@@ -52,81 +247,78 @@ static void oai_ondatachannel_onopen_task(void *userdata) {
 
 static void oai_onconnectionstatechange_task(PeerConnectionState state,
                                              void *user_data) {
+  oai_session_t *session = (oai_session_t *)user_data;
   ESP_LOGI(LOG_TAG, "PeerConnectionState: %s",
            peer_connection_state_to_string(state));
 
-  if (state == PEER_CONNECTION_DISCONNECTED ||
-      state == PEER_CONNECTION_CLOSED) {
-#ifndef LINUX_BUILD
-    esp_restart();
-#endif
-  } else if (state == PEER_CONNECTION_CONNECTED) {
-#ifndef LINUX_BUILD
-    StackType_t *stack_memory = (StackType_t *)heap_caps_malloc(
-        20000 * sizeof(StackType_t), MALLOC_CAP_SPIRAM);
-    xTaskCreateStaticPinnedToCore(oai_send_audio_task, "audio_publisher", 20000,
-                                  NULL, 7, stack_memory, &task_buffer, 0);
-#endif
+  TRACE(TRACE_PEER_STATE, state, 0);
+  session->audio_connected = state == PEER_CONNECTION_CONNECTED;
+  if (state == PEER_CONNECTION_CONNECTED) {
+    boot_mark(BOOT_PHASE_CONNECTED);
+    reconnect_t *reconnect = &session->reconnect;
+    uint32_t recoveries = reconnect->stats.recoveries;
+    reconnect_connected(reconnect, esp_timer_get_time());
+    if (reconnect->stats.recoveries != recoveries) {
+      ESP_LOGI(LOG_TAG, "Session recovered in %lld ms (max %lld ms, %lu so far)",
+               (long long)(reconnect->stats.recover_last_us / 1000),
+               (long long)(reconnect->stats.recover_max_us / 1000),
+               (unsigned long)reconnect->stats.recoveries);
+    }
+  } else if (state == PEER_CONNECTION_DISCONNECTED ||
+             state == PEER_CONNECTION_CLOSED ||
+             state == PEER_CONNECTION_FAILED) {
+    session->lost = true;
   }
 }
 
 static void oai_on_icecandidate_task(char *description, void *user_data) {
-  char local_buffer[MAX_HTTP_OUTPUT_BUFFER + 1] = {0};
-  oai_http_request(description, local_buffer);
-  peer_connection_set_remote_description(peer_connection, local_buffer);
-  // peer_signaling_http_post("s.sdad22624319.cn", "/whip", 8877, "", description);
-}
-
-#define QUANT_MASK      (0xf)           /* Quantization field mask. */
-#define NSEGS           (8)             /* Number of A-law segments. */
-#define SEG_SHIFT       (4)             /* Left shift for segment number. */
-
-void lin2alaw(int16_t *linp, uint8_t *alawp, int linc, int ainc, long npts)
-{
-    int linear, seg; 
-    uint8_t aval, mask;
-    static int16_t seg_aend[NSEGS] 
-        = {0x1f, 0x3f, 0x7f, 0xff, 0x1ff, 0x3ff, 0x7ff, 0xfff};
-    long i;
-
-    for (i = 0; i < npts; ++i) {
-        linear = (*linp) >> 3;
-
-        if (linear >= 0) {
-            mask = 0xd5;                /* sign (7th) bit = 1 */
-        } else {
-            mask = 0x55;                /* sign bit = 0 */
-            linear = -linear - 1;
-        }
-
-        /* Convert the scaled magnitude to segment number. */
-        for (seg = 0; seg < NSEGS && linear > seg_aend[seg]; seg++);
-  
-        /* Combine the sign, segment, and quantization bits. */
-        if (seg >= NSEGS) {             /* out of range, return maximum value. */
-            aval = (uint8_t)(0x7F ^ mask);
-        } else {
-            aval = (uint8_t)seg << SEG_SHIFT;
-            if (seg < 2)
-                aval |= (linear >> 1) & QUANT_MASK;
-            else
-                aval |= (linear >> seg) & QUANT_MASK;
-            aval = (aval ^ mask);
-        }
-
-        /* alaw */
-        *alawp = aval;
-
-        alawp += ainc;
-        linp += linc;
+  oai_session_t *session = (oai_session_t *)user_data;
+  const char *sdp = description;
+  if (session->offer != NULL &&
+      ptime_offer(description, session->ptime_ms, PTIME_MAX_MS,
+                  session->offer, OFFER_MAX_SIZE) > 0) {
+    sdp = session->offer;
+  } else {
+    ESP_LOGW(LOG_TAG, "Offer sent without a=ptime");
+  }
+  bool woken = network_wake_open(&session->wake, description);
+  network_wait_set_woken(&session->network_wait, woken);
+  if (!woken) {
+    ESP_LOGW(LOG_TAG, "No host candidate to wake the loop through, polling");
+  }
+  boot_mark(BOOT_PHASE_OFFER_SENT);
+  const char *answer = oai_http_request(&session->signaling, sdp);
+  if (answer == NULL) {
+    session->lost = true;
+    return;
+  }
+  boot_mark(BOOT_PHASE_ANSWER);
+  // The far end says what it wants to receive; follow it for this session
+  // if we can packetize that, the timestamps say so either way.
+  uint32_t answer_ptime = ptime_from_sdp(answer);
+  if (answer_ptime != 0 && answer_ptime != session->ptime_ms) {
+    ESP_LOGW(LOG_TAG, "Answer prefers ptime %lu ms, sending %lu ms",
+             (unsigned long)answer_ptime,
+             (unsigned long)(ptime_valid(answer_ptime) ? answer_ptime
+                                                       : session->ptime_ms));
+    if (ptime_valid(answer_ptime)) {
+      oai_session_set_ptime(session, answer_ptime);
     }
+  }
+  peer_connection_set_remote_description(session->pc, answer);
+  // peer_signaling_http_post("s.sdad22624319.cn", "/whip", 8877, "", description);
 }
 
+#ifndef LINUX_BUILD
 // UART 参数
 #define UART_PORT_NUM      UART_NUM_0
 #define UART_BAUD_RATE     115200
 #define UART_BUF_SIZE      1024
 
+// Microphone audio streams continuously from oai_send_audio_task instead of
+// in "start" bursts. "latency" prints the audio latency report, "memory" the
+// memory report, "trace" dumps the trace rings, "ptime <ms>" sets the ptime
+// of the next session; everything else is only logged.
 void uart_task(void *pvParameters) {
     ESP_LOGI(LOG_TAG, "enter uart_task\n");
     
@@ -157,77 +349,259 @@ void uart_task(void *pvParameters) {
                 data[UART_BUF_SIZE - 1] = '\0';
             }
             
-            printf("Received: %s\n", data);
-            if (strcmp((const char*)data, "start") == 0) {
-                peer_connection_datachannel_send(peer_connection, "start", 5);
-                int totalSample = 8000 * 5 / 320;
-                int16_t *buf = (int16_t *)malloc(320 * sizeof(int16_t));
-                if (buf == NULL) {
-                    ESP_LOGE(LOG_TAG, "Failed to allocate memory for I2S buffer");
-                    continue;
+            if (strncmp((const char *)data, "latency", 7) == 0) {
+                static char report[LATENCY_REPORT_SIZE];
+                if (oai_audio_latency_json(report, sizeof(report)) > 0) {
+                    printf("%s\n", report);
                 }
-
-                for (int i = 0; i < totalSample; i++) {
-                    size_t bytes_read = 0;
-                    esp_err_t err = i2s_read(I2S_NUM_0, buf, 320 * sizeof(int16_t), &bytes_read, portMAX_DELAY);
-                    if (err != ESP_OK) {
-                        ESP_LOGE(LOG_TAG, "I2S read failed: %s", esp_err_to_name(err));
-                        break;
-                    }
-                    ESP_LOGD(LOG_TAG, "READ BYTE: %d", bytes_read);
-                    uint8_t pcmaBuf[bytes_read / sizeof(int16_t)];
-                    lin2alaw(buf, pcmaBuf, 1, 1, bytes_read / sizeof(int16_t));
-                    peer_connection_send_audio(peer_connection, pcmaBuf, bytes_read / sizeof(int16_t));
+                continue;
+            }
+            if (strncmp((const char *)data, "memory", 6) == 0) {
+                media_memory_log();
+                continue;
+            }
+            if (strncmp((const char *)data, "trace", 5) == 0) {
+                trace_dump_console();
+                continue;
+            }
+            if (strncmp((const char *)data, "ptime ", 6) == 0) {
+                uint32_t ptime_ms = strtoul((const char *)data + 6, NULL, 10);
+                if (ptime_valid(ptime_ms)) {
+                    device_session.next_ptime_ms = ptime_ms;
+                    printf("ptime %lu ms from the next session\n", (unsigned long)ptime_ms);
+                } else {
+                    printf("ptime must be 10, 20, 40 or 60\n");
                 }
-
-                free(buf);
-                peer_connection_datachannel_send(peer_connection, "end", 3);
-                printf("end\n");
+                continue;
             }
+            printf("Received: %s\n", data);
         }
         vTaskDelay(pdMS_TO_TICKS(TICK_INTERVAL));
     }
 }
+#endif
 
 
-void oai_webrtc() {
-  PeerConfiguration peer_connection_config = {
-      .ice_servers = {},
-      .audio_codec = CODEC_PCMA,
-      .video_codec = CODEC_NONE,
-      .datachannel = DATA_CHANNEL_STRING,
-      .onaudiotrack = [](uint8_t *data, size_t size, void *userdata) -> void {
-#ifndef LINUX_BUILD
-        oai_audio_decode(data, size);
+// A full SCTP send buffer makes libpeer refuse the message; the queue keeps
+// it and tries again next tick.
+static bool send_event(const char *data, size_t len, void *user_data) {
+  oai_session_t *session = (oai_session_t *)user_data;
+  return peer_connection_datachannel_send(session->pc, (char *)data, len) >=
+         0;
+}
+
+static void log_event_stats(oai_session_t *session) {
+  static int64_t last_report = 0;
+  static uint32_t last_queued = 0;
+  int64_t now = esp_timer_get_time();
+  if (now - last_report < EVENT_STATS_INTERVAL_US) {
+    return;
+  }
+  last_report = now;
+
+  event_queue_stats_t stats;
+  event_queue_get_stats(&session->events, &stats);
+  if (stats.queued == last_queued && stats.depth == 0) {
+    return;
+  }
+  last_queued = stats.queued;
+  ESP_LOGI(LOG_TAG,
+           "events: depth %lu (max %lu), sent %lu, coalesced %lu, rejected "
+           "%lu, stalls %lu",
+           (unsigned long)stats.depth, (unsigned long)stats.depth_max,
+           (unsigned long)stats.sent, (unsigned long)stats.coalesced,
+           (unsigned long)stats.rejected, (unsigned long)stats.stalls);
+}
+
+static void log_network_stats(oai_session_t *session) {
+  static int64_t last_report = 0;
+  static network_wait_stats_t last = {};
+  static network_wake_stats_t last_wake = {};
+  int64_t now = esp_timer_get_time();
+  if (now - last_report < EVENT_STATS_INTERVAL_US) {
+    return;
+  }
+  int64_t interval_ms = (now - last_report) / 1000;
+  last_report = now;
+
+  const network_wait_stats_t *stats = &session->network_wait.stats;
+  network_wake_stats_t wake = session->wake.stats;
+  if (stats->iterations != last.iterations && interval_ms > 0) {
+    ESP_LOGI(LOG_TAG,
+             "network loop: %lu passes/s, woken by packets %lu, timeouts "
+             "%lu, uplink frames %lu (%lu caught up), wakes sent %lu, "
+             "failed %lu",
+             (unsigned long)((stats->iterations - last.iterations) * 1000 /
+                             interval_ms),
+             (unsigned long)(stats->socket_wakeups - last.socket_wakeups),
+             (unsigned long)(stats->timeouts - last.timeouts),
+             (unsigned long)(stats->uplink - last.uplink),
+             (unsigned long)(stats->drains - last.drains),
+             (unsigned long)(wake.sent - last_wake.sent),
+             (unsigned long)(wake.failed - last_wake.failed));
+  }
+  last = *stats;
+  last_wake = wake;
+}
+
+#if defined(OAI_TRACE) && defined(LINUX_BUILD)
+// OAI_TRACE_OUTPUT names a file that always holds the latest trace rings,
+// rewritten as often as the stats are logged.
+static void save_trace(void) {
+  static const char *path = getenv("OAI_TRACE_OUTPUT");
+  static int64_t last_save = 0;
+  int64_t now = esp_timer_get_time();
+  if (path == NULL || now - last_save < EVENT_STATS_INTERVAL_US) {
+    return;
+  }
+  last_save = now;
+  if (!trace_dump_file(path)) {
+    ESP_LOGW(LOG_TAG, "Cannot write trace to %s", path);
+  }
+}
 #endif
-      },
-      .onvideotrack = NULL,
-      .on_request_keyframe = NULL,
-      .user_data = NULL,
-  };
-
-  peer_connection = peer_connection_create(&peer_connection_config);
-  if (peer_connection == NULL) {
+
+static void oai_onaudiotrack(uint8_t *data, size_t size, void *userdata) {
+  oai_audio_receive(data, size);
+}
+
+static PeerConfiguration peer_connection_config = {
+    .ice_servers = {},
+    .audio_codec = OAI_AUDIO_CODEC,
+    .video_codec = CODEC_NONE,
+    .datachannel = DATA_CHANNEL_STRING,
+    .onaudiotrack = oai_onaudiotrack,
+    .onvideotrack = NULL,
+    .on_request_keyframe = NULL,
+    .user_data = NULL,
+};
+
+static bool oai_session_start(oai_session_t *session) {
+  oai_session_set_ptime(session, session->next_ptime_ms);
+  peer_connection_config.user_data = session;
+  session->pc = peer_connection_create(&peer_connection_config);
+  if (session->pc == NULL) {
     ESP_LOGE(LOG_TAG, "Failed to create peer connection");
-#ifndef LINUX_BUILD
-    esp_restart();
-#endif
+    return false;
   }
+  boot_mark(BOOT_PHASE_PEER_CREATED);
 
-  peer_connection_oniceconnectionstatechange(peer_connection,
+  peer_connection_oniceconnectionstatechange(session->pc,
                                              oai_onconnectionstatechange_task);
-  peer_connection_onicecandidate(peer_connection, oai_on_icecandidate_task);
-  peer_connection_ondatachannel(peer_connection,
-                                oai_ondatachannel_onmessage_task,
+  peer_connection_onicecandidate(session->pc, oai_on_icecandidate_task);
+  peer_connection_ondatachannel(session->pc, oai_ondatachannel_onmessage_task,
                                 oai_ondatachannel_onopen_task, NULL);
   // peer_signaling_connect("mqtts://s.sdad22624319.cn/public/spotted-happy-panda", "dGVzdDp0ZXN0", peer_connection);
-  peer_connection_create_offer(peer_connection);
+  // Creating the connection (DTLS keys included) overlaps with Wi-Fi; the
+  // offer needs host candidates, and playback must be up before audio flows.
+  oai_wait_audio();
+#ifndef LINUX_BUILD
+  oai_wait_network();
+#endif
+  reconnect_offered(&session->reconnect, esp_timer_get_time());
+  peer_connection_create_offer(session->pc);
+  return true;
+}
+
+// Drops the peer connection and everything tied to the old session. Audio
+// devices, codecs, buffers and the signaling client stay up.
+static void oai_session_teardown(oai_session_t *session) {
+  session->audio_connected = false;
+  if (session->pc != NULL) {
+    oai_wait_audio_idle(session);
+    network_wake_close(&session->wake);
+    network_wait_set_woken(&session->network_wait, false);
+    peer_connection_destroy(session->pc);
+    session->pc = NULL;
+    oai_audio_restart_uplink();
+  }
+  oai_audio_interrupt();
+  session->playing_item_id[0] = '\0';
+  event_queue_init(&session->events, send_event, session);
+}
+
+static void oai_session_failed(oai_session_t *session, const char *reason) {
+  oai_session_teardown(session);
+  uint32_t delay_ms =
+      reconnect_failed(&session->reconnect, esp_timer_get_time());
+  ESP_LOGW(LOG_TAG, "Session %s, reconnecting in %lu ms", reason,
+           (unsigned long)delay_ms);
+}
 
-  // xTaskCreatePinnedToCore(peer_connection_task, "peer_connection", 8192, NULL, 5, &xPcTaskHandle, 1);
-  xTaskCreatePinnedToCore(uart_task, "uart_task", 8192, NULL, 5, &xPcTaskHandle, 1);
-  // uart_task();
+void oai_webrtc() {
+  event_queue_init(&device_session.events, send_event, &device_session);
+  if (!event_dispatcher_init(&device_session.dispatcher, event_routes,
+                             sizeof(event_routes) / sizeof(event_routes[0]),
+                             &device_session)) {
+    ESP_LOGE(LOG_TAG, "Data channel event routes are not sorted");
+  }
+  reconnect_init(&device_session.reconnect, RECONNECT_BASE_MS, RECONNECT_MAX_MS,
+                 (uint32_t)esp_timer_get_time());
+  device_session.next_ptime_ms = oai_ptime_setting();
+  device_session.ptime_ms = device_session.next_ptime_ms;
+  network_wait_init(&device_session.network_wait, device_session.ptime_ms);
+  network_wake_init(&device_session.wake);
+  device_session.offer = (char *)media_memory_alloc(
+      MEDIA_MEMORY_PSRAM, OFFER_MAX_SIZE, "offer");
+
+  // The console is idle and the publisher's deep Opus stack is only partly
+  // hot, so both stacks live in PSRAM and leave internal RAM to TLS.
+#ifndef LINUX_BUILD
+  media_memory_watch_task(xTaskGetCurrentTaskHandle(),
+                          CONFIG_ESP_MAIN_TASK_STACK_SIZE);
+  media_memory_create_task(uart_task, "uart_task", 8192, NULL, 5, 1,
+                           MEDIA_MEMORY_PSRAM);
+#endif
+  media_memory_create_task(oai_send_audio_task, "audio_publisher", 20000,
+                           &device_session, 7, 0, MEDIA_MEMORY_PSRAM);
   while (1) {
-    peer_connection_loop(peer_connection);
-    vTaskDelay(pdMS_TO_TICKS(TICK_INTERVAL));
+    switch (reconnect_poll(&device_session.reconnect, esp_timer_get_time())) {
+      case RECONNECT_START:
+        if (!oai_session_start(&device_session)) {
+          oai_session_failed(&device_session, "could not start");
+        }
+        break;
+      case RECONNECT_TIMED_OUT:
+        // The poll already scheduled the retry.
+        ESP_LOGW(LOG_TAG, "Session did not connect in %d ms, retrying",
+                 RECONNECT_CONNECT_TIMEOUT_MS);
+        oai_session_teardown(&device_session);
+        break;
+      case RECONNECT_NONE:
+        break;
+    }
+
+    // Connected, the loop sleeps only in libpeer's select: packets wake it
+    // at once, and so does the publisher as it queues the next uplink
+    // frame. The timeout only covers a lost wake.
+    bool connected = device_session.audio_connected;
+    if (device_session.pc != NULL) {
+      uint32_t passes = device_session.audio_passes;
+      int64_t last_pass_us = device_session.audio_pass_us;
+      int64_t start = esp_timer_get_time();
+      peer_poll_timeout_ms =
+          network_wait_next(&device_session.network_wait, connected, passes,
+                            last_pass_us, start);
+      peer_connection_loop(device_session.pc);
+      int64_t elapsed_us = esp_timer_get_time() - start;
+      TRACE(TRACE_NETWORK_PASS, peer_poll_timeout_ms, elapsed_us);
+      network_wait_done(&device_session.network_wait, elapsed_us);
+      if (device_session.lost) {
+        device_session.lost = false;
+        oai_session_failed(&device_session, "lost");
+      } else {
+        event_queue_flush(&device_session.events);
+      }
+    }
+    log_event_stats(&device_session);
+    log_network_stats(&device_session);
+#if defined(OAI_TRACE) && defined(LINUX_BUILD)
+    save_trace();
+#endif
+    // Not every handshake state blocks on the socket, and libpeer's ICE and
+    // DTLS retransmits count loop passes.
+    if (!connected || device_session.pc == NULL) {
+      vTaskDelay(pdMS_TO_TICKS(TICK_INTERVAL));
+    }
   }
 }
@@ -1,7 +0,0 @@
-#ifndef AUDIO_PROCESSING_H2
-#define AUDIO_PROCESSING_H2
-#include <peer.h>
-
-
-extern PeerConnection *peer_connection;
-#endif // AUDIO_PROCESSING_H2
\ No newline at end of file
@@ -6,9 +6,15 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "boot_timing.h"
+#include "freertos/event_groups.h"
 #include "main.h"
 
-static bool g_wifi_connected = false;
+#define WIFI_GOT_IP_BIT (1 << 0)
+
+// Set while the station holds an IP address, so the session waits on it
+// instead of polling.
+static EventGroupHandle_t wifi_events = NULL;
 
 static void oai_event_handler(void *arg, esp_event_base_t event_base,
                               int32_t event_id, void *event_data) {
@@ -20,14 +26,19 @@ static void oai_event_handler(void *arg, esp_event_base_t event_base,
       ESP_LOGI(LOG_TAG, "retry to connect to the AP");
     }
     ESP_LOGI(LOG_TAG, "connect to the AP fail");
+    xEventGroupClearBits(wifi_events, WIFI_GOT_IP_BIT);
   } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
     ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
     ESP_LOGI(LOG_TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
-    g_wifi_connected = true;
+    s_retry_num = 0;
+    boot_mark(BOOT_PHASE_NETWORK_READY);
+    xEventGroupSetBits(wifi_events, WIFI_GOT_IP_BIT);
   }
 }
 
+// Starts joining the AP and returns; the rest of boot runs meanwhile.
 void oai_wifi(void) {
+  wifi_events = xEventGroupCreate();
   ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID,
                                              &oai_event_handler, NULL));
   ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
@@ -53,9 +64,9 @@ void oai_wifi(void) {
   ESP_ERROR_CHECK(esp_wifi_set_config(
       static_cast<wifi_interface_t>(ESP_IF_WIFI_STA), &wifi_config));
   ESP_ERROR_CHECK(esp_wifi_connect());
+}
 
-  // block until we get an IP address
-  while (!g_wifi_connected) {
-    vTaskDelay(pdMS_TO_TICKS(200));
-  }
+void oai_wait_network(void) {
+  xEventGroupWaitBits(wifi_events, WIFI_GOT_IP_BIT, pdFALSE, pdTRUE,
+                      portMAX_DELAY);
 }
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""Compares two bench JSON runs (BENCH_JSON=...) and flags regressions.
+
+    tools/bench_compare.py baseline.json candidate.json [--threshold 10]
+
+Times (ns, us, ms, also per sample or frame) are better lower, rates
+(anything per second) better higher; other units are listed but never fail
+the comparison. A null value, written for inf or nan, is listed and
+skipped. Exits 1 if a result got worse by more than the threshold,
+or the candidate run failed.
+"""
+
+import argparse
+import json
+import sys
+
+TIME_UNITS = {"ns", "us", "ms", "cycles"}
+
+
+def load(path):
+    with open(path) as f:
+        run = json.load(f)
+    results = {(r["suite"], r["name"]): r for r in run["results"]}
+    return run, results
+
+
+def direction(unit):
+    if unit.endswith("/s"):
+        return 1
+    if unit.split("/")[0] in TIME_UNITS:
+        return -1
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="percent change counted as a regression")
+    args = parser.parse_args()
+
+    base_run, base = load(args.baseline)
+    cand_run, cand = load(args.candidate)
+    if base_run.get("config") != cand_run.get("config"):
+        print("warning: runs were built with different settings")
+        print("  baseline:  %s" % base_run.get("config"))
+        print("  candidate: %s" % cand_run.get("config"))
+
+    regressions = 0
+    for key in sorted(set(base) & set(cand)):
+        old, new = base[key]["value"], cand[key]["value"]
+        unit = cand[key]["unit"]
+        if old is None or new is None:
+            print("%-10s %-44s no value (inf or nan)" % key)
+            continue
+        change = (new - old) * 100.0 / old if old else 0.0
+        better = direction(unit)
+        mark = ""
+        if better != 0 and -better * change > args.threshold:
+            mark = "  REGRESSION"
+            regressions += 1
+        elif better != 0 and better * change > args.threshold:
+            mark = "  improved"
+        print("%-10s %-44s %12.2f -> %12.2f %-10s %+7.1f%%%s" %
+              (key[0], key[1], old, new, unit, change, mark))
+
+    for key in sorted(set(base) - set(cand)):
+        print("%-10s %-44s missing from candidate" % key)
+    for failure in cand_run.get("failures", []):
+        print("%-10s FAILED: %s" % (failure["suite"], failure["reason"]))
+
+    print("%d regressions over %.0f%%, %d failures" %
+          (regressions, args.threshold, len(cand_run.get("failures", []))))
+    return 1 if regressions or cand_run.get("failures") else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,37 @@
+#include "tool_report.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+uint32_t tool_env_u32(const char *name, uint32_t fallback) {
+  const char *value = getenv(name);
+  return value != NULL && value[0] != '\0' ? strtoul(value, NULL, 10)
+                                           : fallback;
+}
+
+const char *tool_env_str(const char *name, const char *fallback) {
+  const char *value = getenv(name);
+  return value != NULL && value[0] != '\0' ? value : fallback;
+}
+
+void tool_report(const char *suite, const char *name, double value,
+                 const char *unit) {
+  printf("%s %s: %.2f %s\n", suite, name, value, unit);
+}
+
+void tool_report_histogram(const char *suite, const char *name,
+                           const latency_histogram_t *histogram) {
+  char line[64];
+  const struct {
+    const char *suffix;
+    int64_t us;
+  } values[] = {
+      {"p50", latency_histogram_percentile(histogram, 50)},
+      {"p95", latency_histogram_percentile(histogram, 95)},
+      {"max", histogram->max_us},
+  };
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    snprintf(line, sizeof(line), "%s_%s", name, values[i].suffix);
+    tool_report(suite, line, values[i].us / 1000.0, "ms");
+  }
+}
@@ -0,0 +1,23 @@
+#ifndef OAI_TOOL_REPORT_H
+#define OAI_TOOL_REPORT_H
+
+#include <stdint.h>
+
+#include "latency.h"
+
+// Settings and result lines shared by the linux tools (loopback, loadgen).
+// Results use the bench's line format, "<suite> <name>: <value> <unit>", so
+// the same scripts read all of them.
+
+// An unset or empty variable gives `fallback`.
+uint32_t tool_env_u32(const char *name, uint32_t fallback);
+const char *tool_env_str(const char *name, const char *fallback);
+
+void tool_report(const char *suite, const char *name, double value,
+                 const char *unit);
+
+// p50, p95 and max in ms, as <name>_p50 and so on.
+void tool_report_histogram(const char *suite, const char *name,
+                           const latency_histogram_t *histogram);
+
+#endif  // OAI_TOOL_REPORT_H
@@ -0,0 +1,214 @@
+#include "load_session.h"
+
+#include <esp_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "g711.h"
+#include "ptime.h"
+
+#define LOAD_ALAW_SILENCE 0xD5
+#define LOAD_REPLY_THRESHOLD 1000  // Peak of a frame that counts as a reply
+
+static void on_audio(uint8_t *data, size_t size, void *user_data) {
+  load_session_t *session = (load_session_t *)user_data;
+  session->stats.audio_rx.fetch_add(1, std::memory_order_relaxed);
+  if (session->utterance_end_us == 0) {
+    return;
+  }
+
+  int16_t pcm[LOAD_MAX_FRAME_SAMPLES];
+  size_t count = size < LOAD_MAX_FRAME_SAMPLES ? size : LOAD_MAX_FRAME_SAMPLES;
+  g711_alaw_decode(data, pcm, count);
+  bool loud = false;
+  for (size_t i = 0; i < count && !loud; i++) {
+    loud = abs(pcm[i]) >= LOAD_REPLY_THRESHOLD;
+  }
+  // A reply starts after a quiet frame, so audio the far end was already
+  // sending when the replay ended, an echo included, is not taken for it.
+  if (!loud) {
+    session->reply_armed = true;
+  } else if (session->reply_armed) {
+    latency_histogram_record(&session->reply_latency,
+                             esp_timer_get_time() - session->utterance_end_us);
+    session->utterance_end_us = 0;
+  }
+}
+
+static void on_state(PeerConnectionState state, void *user_data) {
+  load_session_t *session = (load_session_t *)user_data;
+  if (state == PEER_CONNECTION_CONNECTED) {
+    int64_t now = esp_timer_get_time();
+    reconnect_connected(&session->reconnect, now);
+    latency_histogram_record(&session->connect_latency,
+                             now - session->offer_us);
+    session->stats.connected.fetch_add(1, std::memory_order_relaxed);
+    session->stats.up = true;
+    session->position = 0;
+    session->next_frame_us = now;
+    session->utterance_end_us = 0;
+  } else if (state == PEER_CONNECTION_DISCONNECTED ||
+             state == PEER_CONNECTION_CLOSED ||
+             state == PEER_CONNECTION_FAILED) {
+    session->lost = true;
+  }
+}
+
+// Same exchange as the device: our ptime goes into the offer, the answer
+// comes back from one WHIP POST. The POST blocks the worker, and with it
+// the worker's other sessions, for as long as the gateway takes.
+static void on_local_description(char *description, void *user_data) {
+  load_session_t *session = (load_session_t *)user_data;
+  const char *sdp = description;
+  if (ptime_offer(description, session->config->ptime_ms, PTIME_MAX_MS,
+                  session->offer, sizeof(session->offer)) > 0) {
+    sdp = session->offer;
+  }
+  session->stats.offers.fetch_add(1, std::memory_order_relaxed);
+  const char *answer = signaling_client_post(&session->signaling, sdp);
+  if (answer == NULL) {
+    session->stats.rejected.fetch_add(1, std::memory_order_relaxed);
+    session->lost = true;
+    return;
+  }
+  latency_histogram_record(
+      &session->signaling_latency,
+      session->signaling.done_us - session->signaling.start_us);
+  peer_connection_set_remote_description(session->pc, answer);
+}
+
+static void on_message(char *msg, size_t len, void *user_data, uint16_t sid) {
+  load_session_t *session = (load_session_t *)user_data;
+  session->stats.events_rx.fetch_add(1, std::memory_order_relaxed);
+}
+
+// The device opens the same channel, so the gateway sees what it would in
+// production. Nothing is sent on it.
+static void on_channel_open(void *user_data) {
+  load_session_t *session = (load_session_t *)user_data;
+  peer_connection_create_datachannel(session->pc, DATA_CHANNEL_RELIABLE, 0, 0,
+                                     (char *)"oai-events", (char *)"");
+}
+
+bool load_session_init(load_session_t *session, uint32_t id,
+                       const load_config_t *config, int64_t start_at_us) {
+  session->id = id;
+  session->config = config;
+  session->start_at_us = start_at_us;
+  session->pc = NULL;
+  session->lost = false;
+  latency_histogram_reset(&session->signaling_latency);
+  latency_histogram_reset(&session->connect_latency);
+  latency_histogram_reset(&session->reply_latency);
+  reconnect_init(&session->reconnect, RECONNECT_BASE_MS, RECONNECT_MAX_MS,
+                 (uint32_t)start_at_us ^ id);
+  return signaling_client_init(&session->signaling, config->url,
+                               config->api_key);
+}
+
+static bool session_start(load_session_t *session, int64_t now_us) {
+  PeerConfiguration config;
+  memset(&config, 0, sizeof(config));
+  config.audio_codec = CODEC_PCMA;
+  config.video_codec = CODEC_NONE;
+  config.datachannel = DATA_CHANNEL_STRING;
+  config.onaudiotrack = on_audio;
+  config.user_data = session;
+
+  session->pc = peer_connection_create(&config);
+  if (session->pc == NULL) {
+    return false;
+  }
+  peer_connection_oniceconnectionstatechange(session->pc, on_state);
+  peer_connection_onicecandidate(session->pc, on_local_description);
+  peer_connection_ondatachannel(session->pc, on_message, on_channel_open,
+                                NULL);
+  session->offer_us = now_us;
+  reconnect_offered(&session->reconnect, now_us);
+  peer_connection_create_offer(session->pc);
+  return true;
+}
+
+static void session_teardown(load_session_t *session) {
+  if (session->pc != NULL) {
+    peer_connection_destroy(session->pc);
+    session->pc = NULL;
+  }
+  session->stats.up = false;
+  session->lost = false;
+  session->utterance_end_us = 0;
+}
+
+static void session_failed(load_session_t *session, int64_t now_us) {
+  session_teardown(session);
+  session->stats.failed.fetch_add(1, std::memory_order_relaxed);
+  reconnect_failed(&session->reconnect, now_us);
+}
+
+// The recording, then `gap_ms` of silence, over and over. A frame that
+// reaches the end of the recording marks the end of an utterance.
+static void send_frame(load_session_t *session, int64_t now_us) {
+  const load_config_t *config = session->config;
+  uint8_t alaw[LOAD_MAX_FRAME_SAMPLES];
+  size_t frame = config->ptime_ms * 8;
+  size_t cycle = config->samples + config->gap_ms * 8;
+  for (size_t i = 0; i < frame; i++) {
+    size_t at = (session->position + i) % cycle;
+    alaw[i] = at < config->samples ? config->alaw[at] : LOAD_ALAW_SILENCE;
+  }
+  size_t before = session->position % cycle;
+  session->position += frame;
+  size_t after = session->position % cycle;
+  if (before < config->samples &&
+      (after >= config->samples || after < before)) {
+    session->utterance_end_us = now_us;
+    session->reply_armed = false;
+  }
+  if (peer_connection_send_audio(session->pc, alaw, frame) >= 0) {
+    session->stats.audio_tx.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void load_session_step(load_session_t *session, int64_t now_us) {
+  if (now_us < session->start_at_us) {
+    return;
+  }
+  switch (reconnect_poll(&session->reconnect, now_us)) {
+    case RECONNECT_START:
+      if (!session_start(session, now_us)) {
+        session_failed(session, now_us);
+      }
+      break;
+    case RECONNECT_TIMED_OUT:
+      session_teardown(session);
+      session->stats.failed.fetch_add(1, std::memory_order_relaxed);
+      break;
+    case RECONNECT_NONE:
+      break;
+  }
+  if (session->pc == NULL) {
+    return;
+  }
+
+  peer_connection_loop(session->pc);
+  now_us = esp_timer_get_time();
+  if (session->lost) {
+    session_failed(session, now_us);
+    return;
+  }
+  if (!session->stats.up) {
+    return;
+  }
+  // Paced by the clock; a worker that fell behind catches up in a burst,
+  // as a device's publisher does after a stall.
+  while (now_us >= session->next_frame_us) {
+    send_frame(session, now_us);
+    session->next_frame_us += session->config->ptime_ms * 1000LL;
+  }
+}
+
+void load_session_free(load_session_t *session) {
+  session_teardown(session);
+  signaling_client_free(&session->signaling);
+}
@@ -0,0 +1,74 @@
+#ifndef OAI_LOAD_SESSION_H
+#define OAI_LOAD_SESSION_H
+
+#include <peer.h>
+
+#include <atomic>
+
+#include "latency.h"
+#include "reconnect.h"
+#include "signaling.h"
+
+#define LOAD_OFFER_MAX_SIZE 4096
+#define LOAD_MAX_FRAME_SAMPLES 480  // 60ms of PCMA, the longest ptime
+
+// Shared by every session and read only once the workers run.
+typedef struct {
+  const char *url;
+  const char *api_key;
+  const uint8_t *alaw;  // The recording, A-law at 8kHz
+  size_t samples;
+  uint32_t gap_ms;  // Silence after each replay, so the far end takes a turn
+  uint32_t ptime_ms;
+} load_config_t;
+
+// Counted by the session's worker, read by the reporter at any time.
+typedef struct {
+  std::atomic<uint32_t> offers;        // Offers POSTed
+  std::atomic<uint32_t> rejected;      // Offers the gateway did not answer
+  std::atomic<uint32_t> connected;     // Times the session reached CONNECTED
+  std::atomic<uint32_t> failed;        // Attempts or sessions torn down
+  std::atomic<uint32_t> audio_tx;
+  std::atomic<uint32_t> audio_rx;
+  std::atomic<uint32_t> events_rx;
+  std::atomic<bool> up;                // CONNECTED right now
+} load_stats_t;
+
+// One simulated device: its own peer connection, signaling client and place
+// in the recording. Only its worker thread touches it, so libpeer's
+// callbacks, which fire from inside load_session_step, need no locks.
+typedef struct {
+  uint32_t id;
+  const load_config_t *config;
+  int64_t start_at_us;  // Ramp: nothing happens before this
+
+  PeerConnection *pc;
+  signaling_client_t signaling;
+  reconnect_t reconnect;
+  bool lost;
+  char offer[LOAD_OFFER_MAX_SIZE];
+  int64_t offer_us;
+
+  size_t position;          // Next sample of the replay, gap included
+  int64_t next_frame_us;
+  int64_t utterance_end_us;  // Replay finished, no reply heard yet; 0 if none
+  bool reply_armed;          // Quiet audio came in since the replay ended
+
+  load_stats_t stats;
+  latency_histogram_t signaling_latency;  // WHIP POST, connect included
+  latency_histogram_t connect_latency;    // Offer created to CONNECTED
+  latency_histogram_t reply_latency;      // End of a replay to a reply
+} load_session_t;
+
+// The session is zeroed memory, e.g. from calloc. Returns false if its
+// signaling client cannot be created.
+bool load_session_init(load_session_t *session, uint32_t id,
+                       const load_config_t *config, int64_t start_at_us);
+
+// Starts, retries or tears down the session as due, runs libpeer once and
+// sends the audio frames that are due.
+void load_session_step(load_session_t *session, int64_t now_us);
+
+void load_session_free(load_session_t *session);
+
+#endif  // OAI_LOAD_SESSION_H
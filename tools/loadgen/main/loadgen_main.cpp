@@ -0,0 +1,310 @@
+#include <esp_timer.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+
+#include "g711.h"
+#include "load_session.h"
+#include "ptime.h"
+#include "tool_report.h"
+
+// tools/loopback, which answers one session at a time: each offer closes the
+// session before it. Hence one session unless told otherwise.
+#define LOADGEN_DEFAULT_URL "http://127.0.0.1:8080/whip"
+#define LOADGEN_DEFAULT_SESSIONS 1
+#define LOADGEN_POLL_US 1000
+#define LOADGEN_MAX_SESSIONS 4096
+#define LOADGEN_MAX_THREADS 256
+#define LOADGEN_SAMPLE_RATE 8000
+
+// libpeer's select timeout on the ICE socket, see components/peer. A worker
+// runs many sessions in turn, so none of them may block it; the worker
+// sleeps once per pass instead.
+int peer_poll_timeout_ms = 0;
+
+// libpeer's RTP timestamp step, see components/peer. Process-wide, so every
+// session sends the same ptime.
+int peer_audio_ptime_ms = 20;
+
+typedef struct {
+  pthread_t thread;
+  load_session_t *sessions;  // Every `stride`-th session from `first`
+  uint32_t first;
+  uint32_t stride;
+  uint32_t count;
+} worker_t;
+
+static std::atomic<bool> running(true);
+
+// Raw 16-bit little-endian mono, or a WAV file of the same. Either way
+// 8kHz, as PCMA sends it; the recording is encoded once and shared.
+static uint8_t *load_audio(const char *path, size_t *samples) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  rewind(file);
+  uint8_t *data = (uint8_t *)malloc(size > 0 ? size : 1);
+  if (data == NULL || fread(data, 1, size, file) != (size_t)size) {
+    fclose(file);
+    free(data);
+    return NULL;
+  }
+  fclose(file);
+
+  const uint8_t *pcm = data;
+  size_t bytes = (size_t)size;
+  if (bytes >= 12 && memcmp(data, "RIFF", 4) == 0 &&
+      memcmp(data + 8, "WAVE", 4) == 0) {
+    bool format_ok = false;
+    pcm = NULL;
+    for (size_t at = 12; at + 8 <= bytes;) {
+      uint32_t chunk = data[at + 4] | (data[at + 5] << 8) |
+                       (data[at + 6] << 16) | ((uint32_t)data[at + 7] << 24);
+      const uint8_t *body = data + at + 8;
+      chunk = chunk < bytes - at - 8 ? chunk : bytes - at - 8;
+      if (memcmp(data + at, "fmt ", 4) == 0 && chunk >= 16) {
+        uint32_t rate = body[4] | (body[5] << 8) | (body[6] << 16) |
+                        ((uint32_t)body[7] << 24);
+        format_ok = body[0] == 1 && body[2] == 1 &&
+                    rate == LOADGEN_SAMPLE_RATE && body[14] == 16;
+      } else if (memcmp(data + at, "data", 4) == 0) {
+        pcm = body;
+        bytes = chunk;
+        break;
+      }
+      at += 8 + chunk + (chunk & 1);
+    }
+    if (!format_ok || pcm == NULL) {
+      printf("loadgen: %s is not 16-bit mono PCM at %d Hz\n", path,
+             LOADGEN_SAMPLE_RATE);
+      free(data);
+      return NULL;
+    }
+  }
+
+  *samples = bytes / 2;
+  int16_t *linear = (int16_t *)malloc(*samples * sizeof(int16_t) + 1);
+  uint8_t *alaw = (uint8_t *)malloc(*samples + 1);
+  if (linear != NULL && alaw != NULL) {
+    for (size_t i = 0; i < *samples; i++) {
+      linear[i] = (int16_t)(pcm[i * 2] | (pcm[i * 2 + 1] << 8));
+    }
+    g711_alaw_encode(linear, alaw, *samples);
+  } else {
+    free(alaw);
+    alaw = NULL;
+  }
+  free(linear);
+  free(data);
+  return alaw;
+}
+
+static void *worker_run(void *arg) {
+  worker_t *worker = (worker_t *)arg;
+  while (running.load(std::memory_order_relaxed)) {
+    for (uint32_t i = 0; i < worker->count; i++) {
+      load_session_step(
+          &worker->sessions[worker->first + i * worker->stride],
+          esp_timer_get_time());
+    }
+    usleep(LOADGEN_POLL_US);
+  }
+  return NULL;
+}
+
+typedef struct {
+  uint32_t started;  // Sessions past their ramp start
+  uint32_t up;
+  uint32_t offers;
+  uint32_t rejected;
+  uint32_t connected;
+  uint32_t failed;
+  uint32_t audio_tx;
+  uint32_t audio_rx;
+  uint32_t events_rx;
+} load_totals_t;
+
+static void sum_sessions(const load_session_t *sessions, uint32_t count,
+                         int64_t now_us, load_totals_t *totals) {
+  memset(totals, 0, sizeof(*totals));
+  for (uint32_t i = 0; i < count; i++) {
+    const load_stats_t *stats = &sessions[i].stats;
+    totals->started += now_us >= sessions[i].start_at_us;
+    totals->up += stats->up.load(std::memory_order_relaxed);
+    totals->offers += stats->offers.load(std::memory_order_relaxed);
+    totals->rejected += stats->rejected.load(std::memory_order_relaxed);
+    totals->connected += stats->connected.load(std::memory_order_relaxed);
+    totals->failed += stats->failed.load(std::memory_order_relaxed);
+    totals->audio_tx += stats->audio_tx.load(std::memory_order_relaxed);
+    totals->audio_rx += stats->audio_rx.load(std::memory_order_relaxed);
+    totals->events_rx += stats->events_rx.load(std::memory_order_relaxed);
+  }
+}
+
+// Rates cover the time since `last`; latencies cover the whole run.
+static void report_all(const load_session_t *sessions, uint32_t count,
+                       const load_totals_t *last, double seconds) {
+  load_totals_t totals;
+  sum_sessions(sessions, count, esp_timer_get_time(), &totals);
+  tool_report("loadgen", "sessions", totals.started, "sessions");
+  tool_report("loadgen", "up", totals.up, "sessions");
+  tool_report("loadgen", "offers", totals.offers - last->offers, "offers");
+  tool_report("loadgen", "rejected", totals.rejected - last->rejected,
+              "offers");
+  tool_report("loadgen", "failed", totals.failed - last->failed, "attempts");
+  tool_report("loadgen", "connect_rate",
+              (totals.connected - last->connected) / seconds, "sessions/s");
+  tool_report("loadgen", "audio_tx",
+              (totals.audio_tx - last->audio_tx) / seconds, "pkts/s");
+  tool_report("loadgen", "audio_rx",
+              (totals.audio_rx - last->audio_rx) / seconds, "pkts/s");
+  tool_report("loadgen", "events_rx", totals.events_rx - last->events_rx,
+              "events");
+
+  static latency_histogram_t merged[3];
+  for (size_t i = 0; i < 3; i++) {
+    latency_histogram_reset(&merged[i]);
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    latency_histogram_merge(&merged[0], &sessions[i].signaling_latency);
+    latency_histogram_merge(&merged[1], &sessions[i].connect_latency);
+    latency_histogram_merge(&merged[2], &sessions[i].reply_latency);
+  }
+  tool_report_histogram("loadgen", "signaling", &merged[0]);
+  tool_report_histogram("loadgen", "connect", &merged[1]);
+  tool_report_histogram("loadgen", "reply", &merged[2]);
+}
+
+// One line per session, so a slow outlier shows which session it was.
+static void report_sessions(const load_session_t *sessions, uint32_t count) {
+  char name[64];
+  for (uint32_t i = 0; i < count; i++) {
+    const load_session_t *session = &sessions[i];
+    snprintf(name, sizeof(name), "session.%lu.connect_p50",
+             (unsigned long)session->id);
+    tool_report("loadgen", name,
+                latency_histogram_percentile(&session->connect_latency, 50) /
+                    1000.0,
+                "ms");
+    snprintf(name, sizeof(name), "session.%lu.reply_p50",
+             (unsigned long)session->id);
+    tool_report("loadgen", name,
+                latency_histogram_percentile(&session->reply_latency, 50) /
+                    1000.0,
+                "ms");
+  }
+}
+
+int main(void) {
+  uint32_t count = tool_env_u32("LOADGEN_SESSIONS", LOADGEN_DEFAULT_SESSIONS);
+  uint32_t threads = tool_env_u32("LOADGEN_THREADS", 4);
+  uint32_t ramp_ms = tool_env_u32("LOADGEN_RAMP_MS", 100);
+  uint32_t duration_s = tool_env_u32("LOADGEN_DURATION_S", 60);
+  uint32_t report_ms = tool_env_u32("LOADGEN_REPORT_MS", 5000);
+  const char *audio_path = getenv("LOADGEN_AUDIO");
+
+  load_config_t config;
+  memset(&config, 0, sizeof(config));
+  config.url = tool_env_str("OPENAI_REALTIMEAPI", LOADGEN_DEFAULT_URL);
+  config.api_key = tool_env_str("OPENAI_API_KEY", "");
+  config.gap_ms = tool_env_u32("LOADGEN_GAP_MS", 2000);
+  config.ptime_ms = tool_env_u32("LOADGEN_PTIME_MS", 20);
+
+  if (count == 0 || count > LOADGEN_MAX_SESSIONS || threads == 0 ||
+      threads > LOADGEN_MAX_THREADS || !ptime_valid(config.ptime_ms)) {
+    printf("loadgen: LOADGEN_SESSIONS 1..%d, LOADGEN_THREADS 1..%d, "
+           "LOADGEN_PTIME_MS 10, 20, 40 or 60\n",
+           LOADGEN_MAX_SESSIONS, LOADGEN_MAX_THREADS);
+    return 1;
+  }
+  if (threads > count) {
+    threads = count;
+  }
+  if (count > 1 && strcmp(config.url, LOADGEN_DEFAULT_URL) == 0) {
+    printf("loadgen: tools/loopback serves one session at a time, each "
+           "offer ends the session before it\n");
+  }
+  peer_audio_ptime_ms = (int)config.ptime_ms;
+
+  g711_init();
+  if (audio_path == NULL ||
+      (config.alaw = load_audio(audio_path, &config.samples)) == NULL ||
+      config.samples == 0) {
+    printf("loadgen: set LOADGEN_AUDIO to a 16-bit mono 8kHz recording\n");
+    return 1;
+  }
+  printf("loadgen: %lu sessions on %lu threads against %s, %.1f s of audio\n",
+         (unsigned long)count, (unsigned long)threads, config.url,
+         (double)config.samples / LOADGEN_SAMPLE_RATE);
+
+  peer_init();
+  load_session_t *sessions =
+      (load_session_t *)calloc(count, sizeof(load_session_t));
+  if (sessions == NULL) {
+    return 1;
+  }
+  int64_t start = esp_timer_get_time();
+  for (uint32_t i = 0; i < count; i++) {
+    if (!load_session_init(&sessions[i], i, &config,
+                           start + i * ramp_ms * 1000LL)) {
+      printf("loadgen: cannot create signaling client %lu\n",
+             (unsigned long)i);
+      return 1;
+    }
+  }
+
+  // Session i runs on worker i % threads, so the ramp spreads over all of
+  // them from the start.
+  static worker_t workers[LOADGEN_MAX_THREADS];
+  for (uint32_t i = 0; i < threads; i++) {
+    workers[i].sessions = sessions;
+    workers[i].first = i;
+    workers[i].stride = threads;
+    workers[i].count = (count - i + threads - 1) / threads;
+    if (pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]) !=
+        0) {
+      printf("loadgen: cannot start worker %lu\n", (unsigned long)i);
+      return 1;
+    }
+  }
+
+  int64_t end = start + duration_s * 1000000LL;
+  int64_t last_report = start;
+  load_totals_t last;
+  memset(&last, 0, sizeof(last));
+  while (duration_s == 0 || esp_timer_get_time() < end) {
+    usleep(100 * 1000);
+    int64_t now = esp_timer_get_time();
+    if (report_ms > 0 && now - last_report >= report_ms * 1000LL) {
+      report_all(sessions, count, &last, (now - last_report) / 1e6);
+      sum_sessions(sessions, count, now, &last);
+      last_report = now;
+    }
+  }
+
+  running = false;
+  for (uint32_t i = 0; i < threads; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  load_totals_t zero;
+  memset(&zero, 0, sizeof(zero));
+  report_all(sessions, count, &zero, (esp_timer_get_time() - start) / 1e6);
+  report_sessions(sessions, count);
+
+  // A run in which some session never connected is a failed run.
+  bool ok = true;
+  for (uint32_t i = 0; i < count; i++) {
+    ok = ok && sessions[i].stats.connected > 0;
+    load_session_free(&sessions[i]);
+  }
+  free(sessions);
+  free((void *)config.alaw);
+  return ok ? 0 : 1;
+}
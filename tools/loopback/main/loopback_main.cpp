@@ -0,0 +1,105 @@
+#include <esp_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "loopback_peer.h"
+#include "tool_report.h"
+#include "whip_server.h"
+
+#define LOOPBACK_DEFAULT_PORT 8080
+#define LOOPBACK_POLL_MS 2
+
+static loopback_peer_t peer;
+static whip_server_t server;
+
+// libpeer's select timeout on the ICE socket, see components/peer. The
+// stand-in also polls its WHIP server every pass, so it keeps the poll short.
+int peer_poll_timeout_ms = 1;
+
+static void report_all(const loopback_stats_t *last, double seconds) {
+  const loopback_stats_t *stats = &peer.stats;
+  tool_report("loopback", "sessions", stats->sessions, "offers");
+  tool_report("loopback", "connected", stats->connected, "sessions");
+  tool_report_histogram("loopback", "connect", &peer.connect_latency);
+  tool_report("loopback", "audio_rx",
+              (stats->audio_rx - last->audio_rx) / seconds, "pkts/s");
+  tool_report("loopback", "audio_tx",
+              (stats->audio_tx - last->audio_tx) / seconds, "pkts/s");
+  tool_report("loopback", "events_rx", stats->events_rx - last->events_rx,
+              "events");
+  tool_report("loopback", "events_tx", stats->events_tx - last->events_tx,
+              "events");
+  if (peer.config.audio == LOOPBACK_AUDIO_PULSE) {
+    tool_report_histogram("loopback", "rtt", &peer.rtt_latency);
+    tool_report("loopback", "pulses_lost", stats->pulses_lost, "pulses");
+  }
+  if (server.secure) {
+    tool_report("loopback", "tls_handshakes", server.tls_stats.handshakes,
+                "handshakes");
+    tool_report("loopback", "tls_resumed", server.tls_stats.resumed,
+                "handshakes");
+  }
+}
+
+int main(void) {
+  loopback_config_t config;
+  memset(&config, 0, sizeof(config));
+  const char *audio = getenv("LOOPBACK_AUDIO");
+  config.audio = audio != NULL && strcmp(audio, "echo") == 0
+                     ? LOOPBACK_AUDIO_ECHO
+                     : LOOPBACK_AUDIO_PULSE;
+  const char *codec = getenv("LOOPBACK_CODEC");
+  config.opus = codec != NULL && strcmp(codec, "opus") == 0;
+  config.pulse_interval_ms = tool_env_u32("LOOPBACK_PULSE_MS", 1000);
+  config.latency_poll_ms = tool_env_u32("LOOPBACK_LATENCY_MS", 5000);
+  config.script_path = getenv("LOOPBACK_SCRIPT");
+  uint16_t port = tool_env_u32("LOOPBACK_PORT", LOOPBACK_DEFAULT_PORT);
+  uint32_t duration_s = tool_env_u32("LOOPBACK_DURATION_S", 0);
+  uint32_t report_ms = tool_env_u32("LOOPBACK_REPORT_MS", 5000);
+  const char *cert_path = getenv("LOOPBACK_TLS_CERT");
+  const char *key_path = getenv("LOOPBACK_TLS_KEY");
+
+  if (!loopback_peer_init(&peer, &config)) {
+    return 1;
+  }
+  peer_init();
+  if (!whip_server_open(&server, port, cert_path, key_path)) {
+    printf("loopback: cannot listen on 127.0.0.1:%u\n", port);
+    return 1;
+  }
+  printf("loopback: export OPENAI_REALTIMEAPI=%s://127.0.0.1:%u/whip\n",
+         server.secure ? "https" : "http", port);
+
+  int64_t start = esp_timer_get_time();
+  int64_t last_report = start;
+  loopback_stats_t last = peer.stats;
+  while (duration_s == 0 ||
+         esp_timer_get_time() - start < duration_s * 1000000LL) {
+    if (whip_server_poll(&server, LOOPBACK_POLL_MS)) {
+      whip_server_answer(&server,
+                         loopback_peer_answer(&peer, server.offer,
+                                              server.offer_us));
+    }
+    loopback_peer_step(&peer);
+
+    int64_t now = esp_timer_get_time();
+    if (report_ms > 0 && now - last_report >= report_ms * 1000LL) {
+      report_all(&last, (now - last_report) / 1e6);
+      last = peer.stats;
+      last_report = now;
+    }
+  }
+
+  loopback_stats_t zero;
+  memset(&zero, 0, sizeof(zero));
+  report_all(&zero, (esp_timer_get_time() - start) / 1e6);
+  whip_server_close(&server);
+
+  // A run that never got media through is a failed run.
+  bool ok = peer.stats.connected > 0 && peer.stats.audio_rx > 0;
+  if (config.audio == LOOPBACK_AUDIO_PULSE) {
+    ok = ok && peer.rtt_latency.count > 0;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,289 @@
+#include "loopback_peer.h"
+
+#include <esp_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "g711.h"
+#include "ptime.h"
+
+#define LOOPBACK_ANSWER_TIMEOUT_US (5 * 1000 * 1000)
+#define LOOPBACK_PULSE_AMPLITUDE 16000
+#define LOOPBACK_PULSE_THRESHOLD 4000  // Well above comfort noise
+#define LOOPBACK_LATENCY_GET "{\"type\":\"oai.latency.get\"}"
+#define LOOPBACK_LATENCY_REPORT "\"oai.latency.report\""
+
+// libpeer's RTP timestamp step, see components/peer. Follows the ptime of
+// the session being answered.
+int peer_audio_ptime_ms = LOOPBACK_DEFAULT_PTIME_MS;
+
+static void on_audio(uint8_t *data, size_t size, void *user_data) {
+  loopback_peer_t *peer = (loopback_peer_t *)user_data;
+  peer->stats.audio_rx++;
+
+  if (peer->config.audio == LOOPBACK_AUDIO_ECHO) {
+    if (peer_connection_send_audio(peer->pc, data, size) >= 0) {
+      peer->stats.audio_tx++;
+    }
+    return;
+  }
+
+  int16_t pcm[LOOPBACK_MAX_FRAME_SAMPLES];
+  size_t count =
+      size < LOOPBACK_MAX_FRAME_SAMPLES ? size : LOOPBACK_MAX_FRAME_SAMPLES;
+  g711_alaw_decode(data, pcm, count);
+  int peak = 0;
+  for (size_t i = 0; i < count; i++) {
+    int level = abs(pcm[i]);
+    if (level > peak) {
+      peak = level;
+    }
+  }
+
+  // Only the rising edge counts; the pulse may span two frames on the way
+  // back because the device frames it on its own clock.
+  bool loud = peak >= LOOPBACK_PULSE_THRESHOLD;
+  if (loud && !peer->pulse_heard && peer->pulse_sent_us != 0) {
+    latency_histogram_record(&peer->rtt_latency,
+                             esp_timer_get_time() - peer->pulse_sent_us);
+    peer->pulse_sent_us = 0;
+  }
+  peer->pulse_heard = loud;
+}
+
+static void on_state(PeerConnectionState state, void *user_data) {
+  loopback_peer_t *peer = (loopback_peer_t *)user_data;
+  printf("loopback state: %s\n", peer_connection_state_to_string(state));
+  if (state == PEER_CONNECTION_CONNECTED) {
+    peer->stats.connected++;
+    latency_histogram_record(&peer->connect_latency,
+                             esp_timer_get_time() - peer->offer_us);
+  } else if (state == PEER_CONNECTION_FAILED ||
+             state == PEER_CONNECTION_CLOSED ||
+             state == PEER_CONNECTION_DISCONNECTED) {
+    peer->lost = true;
+  }
+}
+
+static void on_local_description(char *description, void *user_data) {
+  loopback_peer_t *peer = (loopback_peer_t *)user_data;
+  snprintf(peer->answer, sizeof(peer->answer), "%s", description);
+  peer->answer_ready = true;
+}
+
+static void on_message(char *msg, size_t len, void *user_data, uint16_t sid) {
+  loopback_peer_t *peer = (loopback_peer_t *)user_data;
+  peer->stats.events_rx++;
+  if (!peer->channel_ready) {
+    // The device opens the channel and greets right away; from here on it
+    // can take our events.
+    peer->channel_ready = true;
+    peer->script_next = 0;
+    peer->script_due_us = esp_timer_get_time();
+  }
+  if (memmem(msg, len, LOOPBACK_LATENCY_REPORT,
+             strlen(LOOPBACK_LATENCY_REPORT)) != NULL) {
+    printf("loopback device: %.*s\n", (int)len, msg);
+  }
+}
+
+static void on_channel_open(void *user_data) {}
+
+static void on_channel_close(void *user_data) {}
+
+static bool send_event(loopback_peer_t *peer, const char *json) {
+  if (peer_connection_datachannel_send(peer->pc, (char *)json, strlen(json)) <
+      0) {
+    return false;
+  }
+  peer->stats.events_tx++;
+  return true;
+}
+
+// Lines are `[delay_ms] {json}`. Blank lines and lines starting with # are
+// skipped. The text stays allocated for the life of the peer.
+static bool load_script(loopback_peer_t *peer, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  rewind(file);
+  peer->script_text = (char *)malloc(size + 1);
+  if (peer->script_text == NULL ||
+      fread(peer->script_text, 1, size, file) != (size_t)size) {
+    fclose(file);
+    return false;
+  }
+  fclose(file);
+  peer->script_text[size] = '\0';
+
+  char *save = NULL;
+  for (char *line = strtok_r(peer->script_text, "\r\n", &save);
+       line != NULL && peer->script_len < LOOPBACK_MAX_SCRIPT;
+       line = strtok_r(NULL, "\r\n", &save)) {
+    char *json = line;
+    uint32_t delay_ms = strtoul(line, &json, 10);
+    while (*json == ' ' || *json == '\t') {
+      json++;
+    }
+    if (*json == '\0' || *json == '#') {
+      continue;
+    }
+    peer->script[peer->script_len].delay_ms = delay_ms;
+    peer->script[peer->script_len].json = json;
+    peer->script_len++;
+  }
+  return true;
+}
+
+bool loopback_peer_init(loopback_peer_t *peer, const loopback_config_t *config) {
+  peer->config = *config;
+  peer->pc = NULL;
+  peer->lost = false;
+  peer->channel_ready = false;
+  peer->script_text = NULL;
+  peer->script_len = 0;
+  memset(&peer->stats, 0, sizeof(peer->stats));
+  latency_histogram_reset(&peer->connect_latency);
+  latency_histogram_reset(&peer->rtt_latency);
+  if (config->opus && config->audio != LOOPBACK_AUDIO_ECHO) {
+    printf("loopback: Opus answers only echo, switching audio to echo\n");
+    peer->config.audio = LOOPBACK_AUDIO_ECHO;
+  }
+  if (config->script_path != NULL && !load_script(peer, config->script_path)) {
+    printf("loopback: failed to read script %s\n", config->script_path);
+    return false;
+  }
+  g711_init();
+  return true;
+}
+
+static void session_close(loopback_peer_t *peer) {
+  if (peer->pc != NULL) {
+    peer_connection_destroy(peer->pc);
+    peer->pc = NULL;
+  }
+  peer->lost = false;
+  peer->channel_ready = false;
+  peer->pulse_sent_us = 0;
+  peer->pulse_heard = false;
+}
+
+const char *loopback_peer_answer(loopback_peer_t *peer, const char *offer,
+                                 int64_t offer_us) {
+  session_close(peer);
+
+  // Answers in kind, so pulses are framed the way the device frames its
+  // uplink.
+  peer->ptime_ms = ptime_from_sdp(offer);
+  if (!ptime_valid(peer->ptime_ms)) {
+    peer->ptime_ms = LOOPBACK_DEFAULT_PTIME_MS;
+  }
+  peer_audio_ptime_ms = (int)peer->ptime_ms;
+
+  PeerConfiguration config;
+  memset(&config, 0, sizeof(config));
+  config.audio_codec = peer->config.opus ? CODEC_OPUS : CODEC_PCMA;
+  config.video_codec = CODEC_NONE;
+  config.datachannel = DATA_CHANNEL_STRING;
+  config.onaudiotrack = on_audio;
+  config.user_data = peer;
+
+  peer->pc = peer_connection_create(&config);
+  if (peer->pc == NULL) {
+    return NULL;
+  }
+  peer->stats.sessions++;
+  peer->offer_us = offer_us;
+  peer->answer_ready = false;
+  peer_connection_oniceconnectionstatechange(peer->pc, on_state);
+  peer_connection_onicecandidate(peer->pc, on_local_description);
+  peer_connection_ondatachannel(peer->pc, on_message, on_channel_open,
+                                on_channel_close);
+
+  peer_connection_set_remote_description(peer->pc, offer);
+  peer_connection_create_answer(peer->pc);
+  // Candidates are host-only, so gathering finishes within a few loops.
+  int64_t deadline = esp_timer_get_time() + LOOPBACK_ANSWER_TIMEOUT_US;
+  while (!peer->answer_ready && esp_timer_get_time() < deadline) {
+    peer_connection_loop(peer->pc);
+  }
+  if (!peer->answer_ready) {
+    session_close(peer);
+    return NULL;
+  }
+  int64_t now = esp_timer_get_time();
+  peer->next_frame_us = now;
+  peer->last_pulse_us = now;
+  peer->next_latency_poll_us = now + peer->config.latency_poll_ms * 1000LL;
+  return peer->answer;
+}
+
+static void send_pulse_frame(loopback_peer_t *peer, int64_t now) {
+  int16_t pcm[LOOPBACK_MAX_FRAME_SAMPLES];
+  uint8_t alaw[LOOPBACK_MAX_FRAME_SAMPLES];
+  size_t samples = peer->ptime_ms * 8;
+
+  bool pulse =
+      now - peer->last_pulse_us >= peer->config.pulse_interval_ms * 1000LL;
+  for (size_t i = 0; i < samples; i++) {
+    // 1kHz square wave, eight samples per cycle
+    pcm[i] = pulse ? ((i & 4) ? LOOPBACK_PULSE_AMPLITUDE
+                              : -LOOPBACK_PULSE_AMPLITUDE)
+                   : 0;
+  }
+  g711_alaw_encode(pcm, alaw, samples);
+  if (peer_connection_send_audio(peer->pc, alaw, samples) < 0) {
+    return;
+  }
+  peer->stats.audio_tx++;
+  if (pulse) {
+    if (peer->pulse_sent_us != 0) {
+      peer->stats.pulses_lost++;
+    }
+    peer->pulse_sent_us = now;
+    peer->last_pulse_us = now;
+  }
+}
+
+void loopback_peer_step(loopback_peer_t *peer) {
+  if (peer->pc == NULL) {
+    return;
+  }
+  peer_connection_loop(peer->pc);
+  if (peer->lost) {
+    session_close(peer);
+    return;
+  }
+  if (peer_connection_get_state(peer->pc) != PEER_CONNECTION_CONNECTED) {
+    return;
+  }
+
+  int64_t now = esp_timer_get_time();
+  if (peer->config.audio == LOOPBACK_AUDIO_PULSE) {
+    while (now >= peer->next_frame_us) {
+      send_pulse_frame(peer, now);
+      peer->next_frame_us += peer->ptime_ms * 1000LL;
+    }
+  }
+
+  if (!peer->channel_ready) {
+    return;
+  }
+  while (peer->script_next < peer->script_len) {
+    const loopback_script_line_t *line = &peer->script[peer->script_next];
+    int64_t due = peer->script_due_us + line->delay_ms * 1000LL;
+    if (now < due || !send_event(peer, line->json)) {
+      break;
+    }
+    peer->script_due_us = due;
+    peer->script_next++;
+  }
+  if (peer->config.latency_poll_ms > 0 && now >= peer->next_latency_poll_us &&
+      send_event(peer, LOOPBACK_LATENCY_GET)) {
+    peer->next_latency_poll_us = now + peer->config.latency_poll_ms * 1000LL;
+  }
+}
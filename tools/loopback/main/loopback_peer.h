@@ -0,0 +1,87 @@
+#ifndef OAI_LOOPBACK_PEER_H
+#define OAI_LOOPBACK_PEER_H
+
+#include <peer.h>
+
+#include "latency.h"
+
+#define LOOPBACK_DEFAULT_PTIME_MS 20  // When the offer has no a=ptime
+#define LOOPBACK_MAX_FRAME_SAMPLES 480  // 60ms of PCMA, the longest ptime
+#define LOOPBACK_MAX_ANSWER (16 * 1024)
+#define LOOPBACK_MAX_SCRIPT 256
+
+typedef enum {
+  // Silence with a loud one-packet pulse every `pulse_interval_ms`; the device
+  // plays it and, with OAI_AUDIO_INPUT=loopback, sends it back, which gives
+  // the round-trip audio latency.
+  LOOPBACK_AUDIO_PULSE,
+  // Sends every packet the device sends straight back. Codec agnostic.
+  LOOPBACK_AUDIO_ECHO,
+} loopback_audio_mode_t;
+
+typedef struct {
+  loopback_audio_mode_t audio;
+  bool opus;  // Answer with Opus instead of PCMA, echo only
+  uint32_t pulse_interval_ms;
+  uint32_t latency_poll_ms;  // How often to ask for oai.latency.get, 0 never
+  const char *script_path;   // Data channel events to play, NULL for none
+} loopback_config_t;
+
+// One scripted data channel event, sent `delay_ms` after the previous one.
+typedef struct {
+  uint32_t delay_ms;
+  const char *json;
+} loopback_script_line_t;
+
+typedef struct {
+  uint32_t sessions;       // Offers answered
+  uint32_t connected;      // Sessions that reached CONNECTED
+  uint32_t audio_rx;       // Packets from the device
+  uint32_t audio_tx;       // Packets to the device
+  uint32_t events_rx;
+  uint32_t events_tx;
+  uint32_t pulses_lost;    // Pulses not heard back before the next one
+} loopback_stats_t;
+
+// The answering side of a session, standing in for the Realtime API. All of
+// it runs on the caller's thread: libpeer's callbacks fire from inside
+// loopback_peer_step.
+typedef struct {
+  loopback_config_t config;
+  PeerConnection *pc;
+  bool lost;
+
+  char answer[LOOPBACK_MAX_ANSWER];
+  bool answer_ready;
+  int64_t offer_us;
+
+  uint32_t ptime_ms;   // The device's offered ptime, which pulses use too
+  bool channel_ready;  // The device has sent its first event
+  int64_t next_frame_us;
+  int64_t next_latency_poll_us;
+  int64_t last_pulse_us;
+  int64_t pulse_sent_us;  // Pulse waiting to come back, 0 if none
+  bool pulse_heard;       // Last received frame was loud
+
+  char *script_text;
+  loopback_script_line_t script[LOOPBACK_MAX_SCRIPT];
+  size_t script_len;
+  size_t script_next;
+  int64_t script_due_us;
+
+  loopback_stats_t stats;
+  latency_histogram_t connect_latency;  // Offer received to CONNECTED
+  latency_histogram_t rtt_latency;      // Pulse sent to pulse received
+} loopback_peer_t;
+
+bool loopback_peer_init(loopback_peer_t *peer, const loopback_config_t *config);
+
+// Replaces any running session with one for `offer` and returns the answer
+// SDP, or NULL if libpeer did not produce one.
+const char *loopback_peer_answer(loopback_peer_t *peer, const char *offer,
+                                 int64_t offer_us);
+
+// Runs libpeer once and sends whatever audio and events are due.
+void loopback_peer_step(loopback_peer_t *peer);
+
+#endif  // OAI_LOOPBACK_PEER_H
@@ -0,0 +1,316 @@
+#include "whip_server.h"
+
+#include <arpa/inet.h>
+#include <esp_timer.h>
+#include <mbedtls/net_sockets.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define WHIP_SERVER_HEADER_MAX 4096
+#define WHIP_SERVER_READ_TIMEOUT_S 2
+#define WHIP_SERVER_TICKET_LIFETIME_S 86400
+
+// Counts the tickets that parse: each one is a resumed handshake.
+static int ticket_parse(void *user_data, mbedtls_ssl_session *session,
+                        unsigned char *buf, size_t len) {
+  whip_server_t *server = (whip_server_t *)user_data;
+  int ret = mbedtls_ssl_ticket_parse(&server->tls.ticket, session, buf, len);
+  if (ret == 0) {
+    server->tls_stats.resumed++;
+  }
+  return ret;
+}
+
+static int ticket_write(void *user_data, const mbedtls_ssl_session *session,
+                        unsigned char *start, const unsigned char *end,
+                        size_t *len, uint32_t *lifetime) {
+  whip_server_t *server = (whip_server_t *)user_data;
+  return mbedtls_ssl_ticket_write(&server->tls.ticket, session, start, end,
+                                  len, lifetime);
+}
+
+// Like mbedtls_net_send, but a peer that went away must not raise SIGPIPE.
+static int bio_send(void *user_data, const unsigned char *buf, size_t len) {
+  ssize_t sent = send(*(int *)user_data, buf, len, MSG_NOSIGNAL);
+  return sent >= 0 ? (int)sent : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+// Reads time out with SO_RCVTIMEO, which ends the connection.
+static int bio_recv(void *user_data, unsigned char *buf, size_t len) {
+  ssize_t got = recv(*(int *)user_data, buf, len, 0);
+  return got >= 0 ? (int)got : MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+static bool tls_open(whip_server_t *server, const char *cert_path,
+                     const char *key_path) {
+  whip_tls_t *tls = &server->tls;
+  mbedtls_entropy_init(&tls->entropy);
+  mbedtls_ctr_drbg_init(&tls->drbg);
+  mbedtls_x509_crt_init(&tls->cert);
+  mbedtls_pk_init(&tls->key);
+  mbedtls_ssl_ticket_init(&tls->ticket);
+  mbedtls_ssl_config_init(&tls->config);
+  mbedtls_ssl_init(&tls->ssl);
+  tls->fd = -1;
+  server->secure = true;
+  if (cert_path == NULL || key_path == NULL) {
+    return false;
+  }
+
+  if (mbedtls_ctr_drbg_seed(&tls->drbg, mbedtls_entropy_func, &tls->entropy,
+                            NULL, 0) != 0) {
+    return false;
+  }
+  if (mbedtls_x509_crt_parse_file(&tls->cert, cert_path) != 0 ||
+      mbedtls_pk_parse_keyfile(&tls->key, key_path, NULL,
+                               mbedtls_ctr_drbg_random, &tls->drbg) != 0) {
+    printf("loopback: cannot load %s and %s\n", cert_path, key_path);
+    return false;
+  }
+  if (mbedtls_ssl_config_defaults(&tls->config, MBEDTLS_SSL_IS_SERVER,
+                                  MBEDTLS_SSL_TRANSPORT_STREAM,
+                                  MBEDTLS_SSL_PRESET_DEFAULT) != 0 ||
+      mbedtls_ssl_conf_own_cert(&tls->config, &tls->cert, &tls->key) != 0 ||
+      mbedtls_ssl_ticket_setup(&tls->ticket, mbedtls_ctr_drbg_random,
+                               &tls->drbg, MBEDTLS_CIPHER_AES_256_GCM,
+                               WHIP_SERVER_TICKET_LIFETIME_S) != 0) {
+    return false;
+  }
+  mbedtls_ssl_conf_rng(&tls->config, mbedtls_ctr_drbg_random, &tls->drbg);
+  mbedtls_ssl_conf_session_tickets_cb(&tls->config, ticket_write,
+                                      ticket_parse, server);
+  return mbedtls_ssl_setup(&tls->ssl, &tls->config) == 0;
+}
+
+static void tls_close(whip_server_t *server) {
+  whip_tls_t *tls = &server->tls;
+  mbedtls_ssl_free(&tls->ssl);
+  mbedtls_ssl_config_free(&tls->config);
+  mbedtls_ssl_ticket_free(&tls->ticket);
+  mbedtls_pk_free(&tls->key);
+  mbedtls_x509_crt_free(&tls->cert);
+  mbedtls_ctr_drbg_free(&tls->drbg);
+  mbedtls_entropy_free(&tls->entropy);
+  server->secure = false;
+}
+
+// Runs the handshake on a freshly accepted connection.
+static bool tls_accept(whip_server_t *server, int fd) {
+  whip_tls_t *tls = &server->tls;
+  mbedtls_ssl_session_reset(&tls->ssl);
+  tls->fd = fd;
+  mbedtls_ssl_set_bio(&tls->ssl, &tls->fd, bio_send, bio_recv, NULL);
+  int ret;
+  do {
+    ret = mbedtls_ssl_handshake(&tls->ssl);
+  } while (ret == MBEDTLS_ERR_SSL_WANT_READ ||
+           ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+  if (ret != 0) {
+    return false;
+  }
+  server->tls_stats.handshakes++;
+  return true;
+}
+
+static ssize_t conn_recv(whip_server_t *server, int fd, char *buffer,
+                         size_t len) {
+  if (!server->secure) {
+    return recv(fd, buffer, len, 0);
+  }
+  int ret;
+  do {
+    ret = mbedtls_ssl_read(&server->tls.ssl, (unsigned char *)buffer, len);
+  } while (ret == MBEDTLS_ERR_SSL_WANT_READ ||
+           ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+  return ret;
+}
+
+static void conn_send(whip_server_t *server, int fd, const char *data,
+                      size_t len) {
+  if (!server->secure) {
+    send(fd, data, len, MSG_NOSIGNAL);
+    return;
+  }
+  while (len > 0) {
+    int ret =
+        mbedtls_ssl_write(&server->tls.ssl, (const unsigned char *)data, len);
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ ||
+        ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+      continue;
+    }
+    if (ret <= 0) {
+      return;
+    }
+    data += ret;
+    len -= ret;
+  }
+}
+
+static void conn_close(whip_server_t *server, int fd) {
+  if (server->secure) {
+    mbedtls_ssl_close_notify(&server->tls.ssl);
+  }
+  close(fd);
+}
+
+bool whip_server_open(whip_server_t *server, uint16_t port,
+                      const char *cert_path, const char *key_path) {
+  server->client_fd = -1;
+  server->secure = false;
+  memset(&server->tls_stats, 0, sizeof(server->tls_stats));
+  if ((cert_path != NULL || key_path != NULL) &&
+      !tls_open(server, cert_path, key_path)) {
+    tls_close(server);
+    return false;
+  }
+  server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (server->listen_fd < 0) {
+    return false;
+  }
+  int on = 1;
+  setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(server->listen_fd, 4) != 0) {
+    close(server->listen_fd);
+    server->listen_fd = -1;
+    return false;
+  }
+  return true;
+}
+
+static void reply(whip_server_t *server, int fd, const char *status,
+                  const char *type, const char *body) {
+  char header[256];
+  size_t body_len = body != NULL ? strlen(body) : 0;
+  int len = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %s\r\nContent-Type: %s\r\n"
+                     "Content-Length: %zu\r\nLocation: /session\r\n"
+                     "Connection: close\r\n\r\n",
+                     status, type, body_len);
+  conn_send(server, fd, header, len);
+  if (body_len > 0) {
+    conn_send(server, fd, body, body_len);
+  }
+}
+
+// Reads up to the end of the headers; whatever body bytes came along are
+// left in `buffer` after them.
+static int read_headers(whip_server_t *server, int fd, char *buffer,
+                        size_t size, char **body) {
+  size_t len = 0;
+  while (len < size - 1) {
+    ssize_t got = conn_recv(server, fd, buffer + len, size - 1 - len);
+    if (got <= 0) {
+      return -1;
+    }
+    len += got;
+    buffer[len] = '\0';
+    char *end = strstr(buffer, "\r\n\r\n");
+    if (end != NULL) {
+      *body = end + 4;
+      return (int)len;
+    }
+  }
+  return -1;
+}
+
+static long content_length(const char *headers) {
+  for (const char *line = strstr(headers, "\r\n"); line != NULL;
+       line = strstr(line + 2, "\r\n")) {
+    if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+      return strtol(line + 2 + 15, NULL, 10);
+    }
+  }
+  return -1;
+}
+
+bool whip_server_poll(whip_server_t *server, uint32_t timeout_ms) {
+  struct pollfd pfd = {server->listen_fd, POLLIN, 0};
+  if (poll(&pfd, 1, (int)timeout_ms) <= 0) {
+    return false;
+  }
+  int fd = accept(server->listen_fd, NULL, NULL);
+  if (fd < 0) {
+    return false;
+  }
+  struct timeval timeout = {WHIP_SERVER_READ_TIMEOUT_S, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  if (server->secure && !tls_accept(server, fd)) {
+    close(fd);
+    return false;
+  }
+
+  char headers[WHIP_SERVER_HEADER_MAX];
+  char *body = NULL;
+  int len = read_headers(server, fd, headers, sizeof(headers), &body);
+  if (len < 0) {
+    conn_close(server, fd);
+    return false;
+  }
+  if (strncmp(headers, "POST ", 5) != 0) {
+    reply(server, fd, "405 Method Not Allowed", "text/plain", NULL);
+    conn_close(server, fd);
+    return false;
+  }
+  long length = content_length(headers);
+  if (length <= 0 || length >= (long)sizeof(server->offer)) {
+    reply(server, fd, "400 Bad Request", "text/plain", NULL);
+    conn_close(server, fd);
+    return false;
+  }
+
+  size_t have = headers + len - body;
+  memcpy(server->offer, body, have);
+  while (have < (size_t)length) {
+    ssize_t got =
+        conn_recv(server, fd, server->offer + have, length - have);
+    if (got <= 0) {
+      conn_close(server, fd);
+      return false;
+    }
+    have += got;
+  }
+  server->offer[length] = '\0';
+  server->offer_len = length;
+  server->offer_us = esp_timer_get_time();
+  server->client_fd = fd;
+  return true;
+}
+
+void whip_server_answer(whip_server_t *server, const char *answer) {
+  if (server->client_fd < 0) {
+    return;
+  }
+  if (answer != NULL) {
+    reply(server, server->client_fd, "201 Created", "application/sdp",
+          answer);
+  } else {
+    reply(server, server->client_fd, "503 Service Unavailable", "text/plain",
+          NULL);
+  }
+  conn_close(server, server->client_fd);
+  server->client_fd = -1;
+}
+
+void whip_server_close(whip_server_t *server) {
+  whip_server_answer(server, NULL);
+  if (server->listen_fd >= 0) {
+    close(server->listen_fd);
+    server->listen_fd = -1;
+  }
+  if (server->secure) {
+    tls_close(server);
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef OAI_WHIP_SERVER_H
+#define OAI_WHIP_SERVER_H
+
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/ssl_ticket.h>
+#include <mbedtls/x509_crt.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define WHIP_SERVER_MAX_OFFER (16 * 1024)
+
+// TLS with session tickets, so the device's signaling client resumes its
+// session on the next connection as it would against the real API.
+typedef struct {
+  mbedtls_entropy_context entropy;
+  mbedtls_ctr_drbg_context drbg;
+  mbedtls_x509_crt cert;
+  mbedtls_pk_context key;
+  mbedtls_ssl_ticket_context ticket;
+  mbedtls_ssl_config config;
+  mbedtls_ssl_context ssl;
+  int fd;  // The connection `ssl` runs over
+} whip_tls_t;
+
+typedef struct {
+  uint32_t handshakes;
+  uint32_t resumed;  // Handshakes that took a session ticket
+} whip_tls_stats_t;
+
+// Just enough HTTP/1.1 to answer a WHIP POST on localhost: one request per
+// connection, Content-Length bodies only. The device's signaling client is
+// pointed at it with OPENAI_REALTIMEAPI=http://127.0.0.1:<port>/, or https
+// if the server was opened with a certificate.
+typedef struct {
+  int listen_fd;
+  int client_fd;  // Connection waiting for its answer, -1 if none
+  char offer[WHIP_SERVER_MAX_OFFER];
+  size_t offer_len;
+  int64_t offer_us;  // When the offer was read
+  bool secure;
+  whip_tls_t tls;
+  whip_tls_stats_t tls_stats;
+} whip_server_t;
+
+// Serves https with the PEM certificate and key at `cert_path` and
+// `key_path`, plain http if both are NULL.
+bool whip_server_open(whip_server_t *server, uint16_t port,
+                      const char *cert_path, const char *key_path);
+
+// Waits up to `timeout_ms` for a POST and reads its body into `offer`.
+// Returns true with the connection held open for whip_server_answer.
+bool whip_server_poll(whip_server_t *server, uint32_t timeout_ms);
+
+// Replies 201 with the answer SDP, or 503 if `answer` is NULL, and closes
+// the connection.
+void whip_server_answer(whip_server_t *server, const char *answer);
+
+void whip_server_close(whip_server_t *server);
+
+#endif  // OAI_WHIP_SERVER_H
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""Decodes a binary trace dump (see src/trace.h) into a timeline.
+
+    tools/trace_decode.py trace.bin             # OAI_TRACE_OUTPUT on linux
+    tools/trace_decode.py console.log           # "trace" on the device UART
+    tools/trace_decode.py trace.bin --summary   # per-event counts and ranges
+
+A console log may hold several dumps; the last complete one is decoded.
+Event names and the meaning of `a` and `b` come from the trace_event_t enum
+in src/trace.h, so the tool follows the firmware it sits next to. Records
+overwritten while the device copied them are dropped and counted.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+DEFAULT_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                              "..", "src", "trace.h")
+RECORD = struct.Struct("<IHHII")
+
+
+def load_events(path):
+    """Returns [(name, argument comment)] indexed by event id."""
+    with open(path) as f:
+        text = f.read()
+    body = re.search(r"typedef enum \{(.*?)\} trace_event_t;", text, re.S)
+    if body is None:
+        sys.exit("%s: no trace_event_t enum" % path)
+    events = []
+    for line in body.group(1).splitlines():
+        match = re.match(r"\s*TRACE_(\w+)(?:\s*=\s*\d+)?,\s*(?://\s*(.*))?",
+                         line)
+        if match:
+            events.append((match.group(1), match.group(2) or ""))
+    return events
+
+
+def read_dump(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data.startswith(b"OAIT"):
+        return data
+    # Console log: hex payload of "trace: " lines between begin and end.
+    dumps, current = [], None
+    for line in data.decode("utf-8", "replace").splitlines():
+        match = re.search(r"trace: (\S+)", line)
+        if match is None:
+            continue
+        word = match.group(1)
+        if word == "begin":
+            current = []
+        elif word == "end" and current is not None:
+            dumps.append(bytes.fromhex("".join(current)))
+            current = None
+        elif current is not None:
+            current.append(word)
+    if not dumps:
+        sys.exit("%s: no trace dump found" % path)
+    return dumps[-1]
+
+
+def parse(data):
+    """Returns (records as (time_us, core, event, a, b), dropped count)."""
+    magic, version, size, cores = struct.unpack_from("<4sHHI", data, 0)
+    if magic != b"OAIT" or version != 1 or size != RECORD.size:
+        sys.exit("unsupported trace dump (version %d, %d-byte records)" %
+                 (version, size))
+    offset, records, dropped = 12, [], 0
+    for _ in range(cores):
+        core, first, count = struct.unpack_from("<III", data, offset)
+        offset += 12
+        last, wraps = None, 0
+        for i in range(count):
+            time_us, event, seq, a, b = RECORD.unpack_from(data, offset)
+            offset += RECORD.size
+            if seq != (first + i) & 0xFFFF:
+                dropped += 1
+                continue
+            # 32-bit microseconds wrap every 71 minutes; records of one core
+            # are in order, so a big step back is a wrap.
+            if last is not None and last - time_us > 1 << 31:
+                wraps += 1
+            last = time_us
+            records.append((time_us + (wraps << 32), core, event, a, b))
+    records.sort(key=lambda record: record[0])  # Stable: keeps core order
+    return records, dropped
+
+
+def name_of(events, event):
+    return events[event][0] if event < len(events) else "EVENT_%d" % event
+
+
+def print_timeline(records, events):
+    start = records[0][0]
+    for time_us, core, event, a, b in records:
+        print("%12.6f  core%d  %-22s a=%-10d b=%d" %
+              ((time_us - start) / 1e6, core, name_of(events, event), a, b))
+
+
+def print_summary(records, events):
+    seconds = max((records[-1][0] - records[0][0]) / 1e6, 1e-6)
+    by_event = {}
+    for _, _, event, a, b in records:
+        by_event.setdefault(event, []).append((a, b))
+    print("%.3f s traced" % seconds)
+    for event in sorted(by_event):
+        values = by_event[event]
+        a_values = [v[0] for v in values]
+        b_values = [v[1] for v in values]
+        meaning = events[event][1] if event < len(events) else ""
+        print("%-22s %7d  %8.1f/s  a %d..%d  b %d..%d  (%s)" %
+              (name_of(events, event), len(values), len(values) / seconds,
+               min(a_values), max(a_values), min(b_values), max(b_values),
+               meaning))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dump", help="binary dump or console log")
+    parser.add_argument("--header", default=DEFAULT_HEADER,
+                        help="trace.h the dump was built with")
+    parser.add_argument("--summary", action="store_true",
+                        help="counts, rates and argument ranges per event")
+    args = parser.parse_args()
+
+    events = load_events(args.header)
+    records, dropped = parse(read_dump(args.dump))
+    if not records:
+        print("no records")
+        return 0
+    if args.summary:
+        print_summary(records, events)
+    else:
+        print_timeline(records, events)
+    if dropped:
+        print("%d records overwritten while dumped, dropped" % dropped,
+              file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())